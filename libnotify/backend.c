@@ -0,0 +1,420 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/*
+ * The fdo and portal backends talk to a server over D-Bus, sharing the
+ * same code; which one is used depends on the proxy that could be made.
+ * The log and null backends don't connect to any bus: they show and close
+ * the notifications locally, so only the ::closed signal of the
+ * notifications closed by the application is emitted.
+ */
+
+static gint   _backend_type = -1; /* Unset, from the environment */
+static char  *_log_file_path = NULL;
+static FILE  *_log_file = NULL;
+
+static const NotifyBackend fdo_backend = {
+        "fdo",
+        TRUE,
+        _notify_dbus_show,
+        _notify_dbus_close,
+        _notify_dbus_get_server_caps,
+        _notify_dbus_get_server_info,
+};
+
+static const NotifyBackend portal_backend = {
+        "portal",
+        TRUE,
+        _notify_dbus_show,
+        _notify_dbus_close,
+        _notify_dbus_get_server_caps,
+        _notify_dbus_get_server_info,
+};
+
+static gboolean
+local_close (NotifyNotification  *notification,
+             GError             **error)
+{
+        _notify_notification_local_close (notification);
+
+        return TRUE;
+}
+
+static GList *
+local_get_server_caps (void)
+{
+        return g_list_prepend (NULL, g_strdup ("body"));
+}
+
+static gboolean
+null_show (NotifyNotification  *notification,
+           GError             **error)
+{
+        _notify_notification_local_show (notification);
+
+        return TRUE;
+}
+
+static gboolean
+null_get_server_info (char    **ret_name,
+                      char    **ret_vendor,
+                      char    **ret_version,
+                      char    **ret_spec_version,
+                      GError  **error)
+{
+        if (ret_name) {
+                *ret_name = g_strdup ("Null");
+        }
+
+        if (ret_vendor) {
+                *ret_vendor = g_strdup ("libnotify");
+        }
+
+        if (ret_version) {
+                *ret_version = g_strdup (VERSION);
+        }
+
+        if (ret_spec_version) {
+                *ret_spec_version = g_strdup ("1.2");
+        }
+
+        return TRUE;
+}
+
+static const NotifyBackend null_backend = {
+        "null",
+        FALSE,
+        null_show,
+        local_close,
+        local_get_server_caps,
+        null_get_server_info,
+};
+
+static void
+append_json_string (GString    *json,
+                    const char *key,
+                    const char *value)
+{
+        g_string_append_printf (json, ",\"%s\":\"", key);
+
+        for (const char *p = value ? value : ""; *p != '\0'; ++p) {
+                switch (*p) {
+                case '"':
+                        g_string_append (json, "\\\"");
+                        break;
+                case '\\':
+                        g_string_append (json, "\\\\");
+                        break;
+                case '\n':
+                        g_string_append (json, "\\n");
+                        break;
+                default:
+                        if ((guchar) *p < 0x20) {
+                                g_string_append_printf (json, "\\u%04x", *p);
+                        } else {
+                                g_string_append_c (json, *p);
+                        }
+                }
+        }
+
+        g_string_append_c (json, '"');
+}
+
+static void
+write_json_line (FILE       *file,
+                 const char *event,
+                 guint32     id,
+                 const char *summary,
+                 const char *body,
+                 const char *icon_name,
+                 const char *urgency,
+                 const char *category)
+{
+        GDateTime *now = g_date_time_new_now_utc ();
+        char *time = g_date_time_format_iso8601 (now);
+        GString *json = g_string_new (NULL);
+
+        g_string_append_printf (json, "{\"id\":%u", id);
+        append_json_string (json, "time", time);
+        append_json_string (json, "event", event);
+        append_json_string (json, "app", notify_get_app_name ());
+        append_json_string (json, "summary", summary);
+        append_json_string (json, "body", body);
+        append_json_string (json, "icon", icon_name);
+        append_json_string (json, "urgency", urgency);
+        append_json_string (json, "category", category);
+        g_string_append (json, "}\n");
+
+        fputs (json->str, file);
+        fflush (file);
+
+        g_string_free (json, TRUE);
+        g_free (time);
+        g_date_time_unref (now);
+}
+
+static void
+log_notification (NotifyNotification *notification,
+                  const char         *event)
+{
+        static const char *urgencies[] = { "low", "normal", "critical" };
+        char *summary, *body, *icon_name, *id_string;
+        const char *urgency, *category, *path;
+        gint id;
+
+        g_object_get (notification,
+                      "id", &id,
+                      "summary", &summary,
+                      "body", &body,
+                      "icon-name", &icon_name,
+                      NULL);
+        urgency = urgencies[_notify_notification_get_urgency (notification)];
+        category = _notify_notification_get_category (notification);
+
+        path = _log_file_path ? _log_file_path : g_getenv ("NOTIFY_LOG_FILE");
+
+        if (path != NULL && *path != '\0' && _log_file == NULL) {
+                _log_file = g_fopen (path, "ae");
+                if (_log_file == NULL) {
+                        g_warning ("Failed to open the notifications log %s",
+                                   path);
+                }
+        }
+
+        id_string = g_strdup_printf ("%d", id);
+
+        if (_log_file != NULL) {
+                write_json_line (_log_file, event, id, summary, body,
+                                 icon_name, urgency, category);
+        } else {
+                const GLogField fields[] = {
+                        { "MESSAGE", summary ? summary : "", -1 },
+                        { "GLIB_DOMAIN", G_LOG_DOMAIN, -1 },
+                        { "NOTIFY_EVENT", event, -1 },
+                        { "NOTIFY_ID", id_string, -1 },
+                        { "NOTIFY_APP_NAME", notify_get_app_name (), -1 },
+                        { "NOTIFY_BODY", body ? body : "", -1 },
+                        { "NOTIFY_ICON", icon_name ? icon_name : "", -1 },
+                        { "NOTIFY_URGENCY", urgency, -1 },
+                        { "NOTIFY_CATEGORY", category ? category : "", -1 },
+                };
+
+                /* Without journald, the JSON lines go to the standard error */
+                if (g_log_writer_journald (G_LOG_LEVEL_INFO, fields,
+                                           G_N_ELEMENTS (fields),
+                                           NULL) != G_LOG_WRITER_HANDLED) {
+                        write_json_line (stderr, event, id, summary, body,
+                                         icon_name, urgency, category);
+                }
+        }
+
+        g_free (id_string);
+        g_free (summary);
+        g_free (body);
+        g_free (icon_name);
+}
+
+static gboolean
+log_show (NotifyNotification  *notification,
+          GError             **error)
+{
+        _notify_notification_local_show (notification);
+        log_notification (notification, "show");
+
+        return TRUE;
+}
+
+static gboolean
+log_close (NotifyNotification  *notification,
+           GError             **error)
+{
+        log_notification (notification, "close");
+        _notify_notification_local_close (notification);
+
+        return TRUE;
+}
+
+static gboolean
+log_get_server_info (char    **ret_name,
+                     char    **ret_vendor,
+                     char    **ret_version,
+                     char    **ret_spec_version,
+                     GError  **error)
+{
+        null_get_server_info (ret_name, ret_vendor, ret_version,
+                              ret_spec_version, error);
+
+        if (ret_name) {
+                g_free (*ret_name);
+                *ret_name = g_strdup ("Log");
+        }
+
+        return TRUE;
+}
+
+static const NotifyBackend log_backend = {
+        "log",
+        FALSE,
+        log_show,
+        log_close,
+        local_get_server_caps,
+        log_get_server_info,
+};
+
+/*
+ * _notify_get_backend_type:
+ *
+ * Returns: The backend set with notify_set_backend(), or from the
+ *   `NOTIFY_BACKEND` environment variable.
+ */
+NotifyBackendType
+_notify_get_backend_type (void)
+{
+        if (_backend_type < 0) {
+                const char *name = g_getenv ("NOTIFY_BACKEND");
+
+                _backend_type = NOTIFY_BACKEND_AUTO;
+
+                if (g_strcmp0 (name, "fdo") == 0) {
+                        _backend_type = NOTIFY_BACKEND_FDO;
+                } else if (g_strcmp0 (name, "portal") == 0) {
+                        _backend_type = NOTIFY_BACKEND_PORTAL;
+                } else if (g_strcmp0 (name, "log") == 0) {
+                        _backend_type = NOTIFY_BACKEND_LOG;
+                } else if (g_strcmp0 (name, "null") == 0) {
+                        _backend_type = NOTIFY_BACKEND_NULL;
+                } else if (name != NULL && g_strcmp0 (name, "auto") != 0) {
+                        g_warning ("Unknown notification backend '%s'", name);
+                }
+        }
+
+        return _backend_type;
+}
+
+/*
+ * _notify_get_backend:
+ *
+ * Returns: (transfer none): The backend delivering the notifications.
+ */
+const NotifyBackend *
+_notify_get_backend (void)
+{
+        switch (_notify_get_backend_type ()) {
+        case NOTIFY_BACKEND_LOG:
+                return &log_backend;
+        case NOTIFY_BACKEND_NULL:
+                return &null_backend;
+        case NOTIFY_BACKEND_PORTAL:
+                return &portal_backend;
+        case NOTIFY_BACKEND_FDO:
+                return &fdo_backend;
+        case NOTIFY_BACKEND_AUTO:
+        default:
+                return _notify_uses_portal_notifications () ? &portal_backend
+                                                            : &fdo_backend;
+        }
+}
+
+/*
+ * _notify_notification_get_backend:
+ * @notification: A notification.
+ *
+ * Returns: (transfer none): The backend delivering @notification: the
+ *   notifications of the clients other than the default one always go to
+ *   their notification server.
+ */
+const NotifyBackend *
+_notify_notification_get_backend (NotifyNotification *notification)
+{
+        if (!_notify_client_is_default (_notify_notification_get_client (notification))) {
+                return &fdo_backend;
+        }
+
+        return _notify_get_backend ();
+}
+
+/*
+ * _notify_backend_clear:
+ *
+ * Releases the resources of the backends.
+ */
+void
+_notify_backend_clear (void)
+{
+        g_clear_pointer (&_log_file, fclose);
+}
+
+/**
+ * notify_set_backend:
+ * @backend: The backend to use.
+ *
+ * Sets how the notifications are delivered. It must be called before
+ * [func@init].
+ *
+ * With %NOTIFY_BACKEND_AUTO, the default, the notifications are sent to
+ * the XDG Desktop Notification Portal in a sandbox and to the
+ * notification server otherwise. %NOTIFY_BACKEND_LOG writes them to the
+ * file set with [func@set_log_file], or to the journal, and
+ * %NOTIFY_BACKEND_NULL drops them, so that no bus is needed at all.
+ *
+ * The default can also be set with the `NOTIFY_BACKEND` environment
+ * variable, to one of `auto`, `fdo`, `portal`, `log` or `null`.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_backend (NotifyBackendType backend)
+{
+        g_return_if_fail (!notify_is_initted ());
+        g_return_if_fail (backend >= NOTIFY_BACKEND_AUTO &&
+                          backend <= NOTIFY_BACKEND_NULL);
+
+        _backend_type = backend;
+}
+
+/**
+ * notify_set_log_file:
+ * @path: (nullable) (type filename): The file to append to, or %NULL.
+ *
+ * Sets the file where the %NOTIFY_BACKEND_LOG backend appends the
+ * notifications, one JSON object per line.
+ *
+ * By default, or if @path is %NULL, they are sent to the journal, or
+ * written to the standard error if it's not available. The default can
+ * also be set with the `NOTIFY_LOG_FILE` environment variable.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_log_file (const char *path)
+{
+        g_clear_pointer (&_log_file, fclose);
+        g_free (_log_file_path);
+        _log_file_path = g_strdup (path);
+}
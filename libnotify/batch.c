@@ -0,0 +1,502 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+typedef enum
+{
+        BATCH_OP_SHOW,
+        BATCH_OP_CLOSE,
+} BatchOp;
+
+typedef struct
+{
+        BatchOp             op;
+        NotifyNotification *notification;
+        GError             *error;
+} BatchItem;
+
+typedef struct
+{
+        NotifyBatch *batch;
+        GTask       *task;
+        guint        index;
+        gint64       start_time;
+        const char  *method;
+        guint64      content_hash;
+} BatchCall;
+
+struct _NotifyBatch
+{
+        GObject         parent_instance;
+
+        GArray         *items;
+        /* The client of all the notifications, or NULL for the default */
+        NotifyClient   *client;
+        GTask          *task;
+        guint           pending;
+        guint           failed;
+        gboolean        submitted;
+};
+
+G_DEFINE_TYPE (NotifyBatch, notify_batch, G_TYPE_OBJECT)
+
+static void
+batch_item_clear (BatchItem *item)
+{
+        g_clear_object (&item->notification);
+        g_clear_error (&item->error);
+}
+
+static void
+notify_batch_finalize (GObject *object)
+{
+        NotifyBatch *batch = NOTIFY_BATCH (object);
+
+        g_clear_pointer (&batch->items, g_array_unref);
+
+        G_OBJECT_CLASS (notify_batch_parent_class)->finalize (object);
+}
+
+static void
+notify_batch_class_init (NotifyBatchClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = notify_batch_finalize;
+}
+
+static void
+notify_batch_init (NotifyBatch *batch)
+{
+        batch->items = g_array_new (FALSE, TRUE, sizeof (BatchItem));
+        g_array_set_clear_func (batch->items, (GDestroyNotify) batch_item_clear);
+}
+
+/**
+ * notify_batch_new:
+ *
+ * Creates a new empty #NotifyBatch.
+ *
+ * Returns: (transfer full): The new #NotifyBatch.
+ *
+ * Since: 0.8.8
+ */
+NotifyBatch *
+notify_batch_new (void)
+{
+        return g_object_new (NOTIFY_TYPE_BATCH, NULL);
+}
+
+static void
+notify_batch_add_item (NotifyBatch        *batch,
+                       BatchOp             op,
+                       NotifyNotification *notification)
+{
+        BatchItem item = { 0, };
+
+        item.op = op;
+        item.notification = g_object_ref (notification);
+        g_array_append_val (batch->items, item);
+
+        batch->client = _notify_notification_get_client (notification);
+}
+
+/**
+ * notify_batch_add_show:
+ * @batch: The batch.
+ * @notification: The notification to show.
+ *
+ * Adds an operation showing @notification to @batch.
+ *
+ * This is the batched equivalent of [method@Notification.show]. All the
+ * notifications of a batch must belong to the same [class@Client].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_batch_add_show (NotifyBatch        *batch,
+                       NotifyNotification *notification)
+{
+        g_return_if_fail (NOTIFY_IS_BATCH (batch));
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        g_return_if_fail (!batch->submitted);
+        g_return_if_fail (batch->items->len == 0 ||
+                          _notify_notification_get_client (notification) == batch->client);
+
+        notify_batch_add_item (batch, BATCH_OP_SHOW, notification);
+}
+
+/**
+ * notify_batch_add_close:
+ * @batch: The batch.
+ * @notification: The notification to close.
+ *
+ * Adds an operation closing @notification to @batch.
+ *
+ * This is the batched equivalent of [method@Notification.close]. All the
+ * notifications of a batch must belong to the same [class@Client].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_batch_add_close (NotifyBatch        *batch,
+                        NotifyNotification *notification)
+{
+        g_return_if_fail (NOTIFY_IS_BATCH (batch));
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        g_return_if_fail (!batch->submitted);
+        g_return_if_fail (batch->items->len == 0 ||
+                          _notify_notification_get_client (notification) == batch->client);
+
+        notify_batch_add_item (batch, BATCH_OP_CLOSE, notification);
+}
+
+/**
+ * notify_batch_get_n_items:
+ * @batch: The batch.
+ *
+ * Gets the number of operations added to @batch.
+ *
+ * Returns: The number of operations.
+ *
+ * Since: 0.8.8
+ */
+guint
+notify_batch_get_n_items (NotifyBatch *batch)
+{
+        g_return_val_if_fail (NOTIFY_IS_BATCH (batch), 0);
+
+        return batch->items->len;
+}
+
+/**
+ * notify_batch_get_notification:
+ * @batch: The batch.
+ * @index: The index of the operation, in the order it was added.
+ *
+ * Gets the notification of the operation at @index.
+ *
+ * Returns: (transfer none): The notification.
+ *
+ * Since: 0.8.8
+ */
+NotifyNotification *
+notify_batch_get_notification (NotifyBatch *batch,
+                               guint        index)
+{
+        g_return_val_if_fail (NOTIFY_IS_BATCH (batch), NULL);
+        g_return_val_if_fail (index < batch->items->len, NULL);
+
+        return g_array_index (batch->items, BatchItem, index).notification;
+}
+
+/**
+ * notify_batch_get_error:
+ * @batch: The batch.
+ * @index: The index of the operation, in the order it was added.
+ *
+ * Gets the error of the operation at @index.
+ *
+ * This is only meaningful once the batch submission has completed.
+ *
+ * Returns: (nullable) (transfer none): The error of the operation, or
+ *   %NULL if it succeeded.
+ *
+ * Since: 0.8.8
+ */
+const GError *
+notify_batch_get_error (NotifyBatch *batch,
+                        guint        index)
+{
+        g_return_val_if_fail (NOTIFY_IS_BATCH (batch), NULL);
+        g_return_val_if_fail (index < batch->items->len, NULL);
+
+        return g_array_index (batch->items, BatchItem, index).error;
+}
+
+static void
+notify_batch_item_done (NotifyBatch *batch)
+{
+        g_assert (batch->pending > 0);
+
+        if (--batch->pending > 0) {
+                return;
+        }
+
+        if (batch->failed > 0) {
+                g_task_return_new_error (batch->task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_FAILED,
+                                         "%u of %u notification operations failed",
+                                         batch->failed,
+                                         batch->items->len);
+        } else {
+                g_task_return_boolean (batch->task, TRUE);
+        }
+
+        g_clear_object (&batch->task);
+}
+
+static void
+on_batch_call_done (GObject      *source,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+        BatchCall *call = user_data;
+        NotifyBatch *batch = call->batch;
+        BatchItem *item = &g_array_index (batch->items, BatchItem, call->index);
+        GVariant *result;
+        gboolean success;
+
+        result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res,
+                                           &item->error);
+        if (_notify_client_is_default (batch->client)) {
+                _notify_breaker_record (call->start_time, item->error);
+        }
+        _notify_stats_record_call (call->method, call->start_time, item->error);
+
+        if (item->op == BATCH_OP_SHOW) {
+                success = _notify_notification_end_show (item->notification,
+                                                         result,
+                                                         call->content_hash,
+                                                         item->error ? NULL : &item->error);
+        } else {
+                success = _notify_notification_finish_close (item->notification,
+                                                             result);
+        }
+
+        if (!success) {
+                batch->failed++;
+        }
+
+        g_clear_pointer (&result, g_variant_unref);
+
+        notify_batch_item_done (batch);
+
+        g_object_unref (call->task);
+        g_free (call);
+}
+
+/* Backends not using a server complete each operation right away */
+static void
+notify_batch_submit_local (NotifyBatch *batch)
+{
+        const NotifyBackend *backend = _notify_get_backend ();
+
+        batch->pending = 1;
+
+        for (guint i = 0; i < batch->items->len; ++i) {
+                BatchItem *item = &g_array_index (batch->items, BatchItem, i);
+                gboolean success;
+
+                if (item->op == BATCH_OP_SHOW) {
+                        _notify_notification_request_show (item->notification);
+                        success = backend->show (item->notification,
+                                                 &item->error);
+                } else {
+                        success = backend->close (item->notification,
+                                                  &item->error);
+                }
+
+                if (!success) {
+                        batch->failed++;
+                }
+        }
+
+        notify_batch_item_done (batch);
+}
+
+/**
+ * notify_batch_submit:
+ * @batch: The batch.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @callback: (scope async): The callback to call when all the operations
+ *   completed.
+ * @user_data: User data to pass to @callback.
+ *
+ * Asynchronously submits all the operations of @batch.
+ *
+ * All the requests are sent without waiting for the replies of the
+ * previous ones. Once all the replies have been received @callback is
+ * called, and [method@Batch.submit_finish] can be used to know whether
+ * all of them succeeded, while [method@Batch.get_error] gives the result
+ * of each single operation.
+ *
+ * A batch can only be submitted once.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_batch_submit (NotifyBatch         *batch,
+                     GCancellable        *cancellable,
+                     GAsyncReadyCallback  callback,
+                     gpointer             user_data)
+{
+        GDBusProxy *proxy;
+        GError *error = NULL;
+        gboolean is_default;
+
+        g_return_if_fail (NOTIFY_IS_BATCH (batch));
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+        g_return_if_fail (!batch->submitted);
+
+        /* The process-wide policies only apply to the default client */
+        is_default = _notify_client_is_default (batch->client);
+
+        if (is_default && !notify_is_initted ()) {
+                g_warning ("you must call notify_init() before showing");
+                g_assert_not_reached ();
+        }
+
+        batch->submitted = TRUE;
+        batch->task = g_task_new (batch, cancellable, callback, user_data);
+        g_task_set_source_tag (batch->task, notify_batch_submit);
+
+        if (is_default && !_notify_get_backend ()->uses_dbus) {
+                notify_batch_submit_local (batch);
+                return;
+        }
+
+        proxy = _notify_client_get_proxy (batch->client, &error);
+        if (proxy == NULL) {
+                g_task_return_error (batch->task, error);
+                g_clear_object (&batch->task);
+                return;
+        }
+
+        /* Hold a pending reference until all the calls have been sent, so
+         * that the task can't complete while we're still adding items. */
+        batch->pending = 1;
+
+        for (guint i = 0; i < batch->items->len; ++i) {
+                BatchItem *item = &g_array_index (batch->items, BatchItem, i);
+                GVariant *parameters;
+                const char *method;
+                guint64 content_hash = 0;
+                BatchCall *call;
+
+                if (item->op == BATCH_OP_CLOSE) {
+                        if (is_default && _notify_spool_should_queue (proxy)) {
+                                _notify_spool_remove (item->notification);
+                                continue;
+                        }
+
+                        if (is_default && _notify_breaker_is_open ()) {
+                                _notify_breaker_set_error (&item->error);
+                                batch->failed++;
+                                continue;
+                        }
+
+                        parameters = _notify_notification_prepare_close (item->notification,
+                                                                         proxy,
+                                                                         &method);
+                        if (parameters == NULL) {
+                                if (is_default) {
+                                        _notify_breaker_release ();
+                                }
+                                batch->failed++;
+                                continue;
+                        }
+                } else {
+                        _notify_notification_request_show (item->notification);
+
+                        /* Before the show leaves any trace */
+                        if (is_default && _notify_breaker_is_open ()) {
+                                if (!_notify_breaker_fallback (item->notification,
+                                                               &item->error)) {
+                                        batch->failed++;
+                                }
+                                continue;
+                        }
+
+                        /* Like notify_notification_show(), deduplication,
+                         * grouping, skipping unchanged notifications and
+                         * the spool can leave nothing to send */
+                        if (!_notify_notification_begin_show (item->notification,
+                                                              proxy,
+                                                              &parameters,
+                                                              &method,
+                                                              &content_hash,
+                                                              &item->error)) {
+                                if (is_default) {
+                                        _notify_breaker_release ();
+                                }
+                                batch->failed++;
+                                continue;
+                        }
+
+                        if (parameters == NULL) {
+                                if (is_default) {
+                                        _notify_breaker_release ();
+                                }
+                                continue;
+                        }
+                }
+
+                call = g_new0 (BatchCall, 1);
+                call->batch = batch;
+                call->task = g_object_ref (batch->task);
+                call->index = i;
+                call->start_time = g_get_monotonic_time ();
+                call->method = method;
+                call->content_hash = content_hash;
+
+                batch->pending++;
+                g_dbus_proxy_call (proxy,
+                                   method,
+                                   parameters,
+                                   _notify_get_call_flags (),
+                                   -1,
+                                   cancellable,
+                                   on_batch_call_done,
+                                   call);
+        }
+
+        notify_batch_item_done (batch);
+}
+
+/**
+ * notify_batch_submit_finish:
+ * @batch: The batch.
+ * @result: The #GAsyncResult passed to the callback.
+ * @error: The returned error information.
+ *
+ * Finishes an operation started with [method@Batch.submit].
+ *
+ * Returns: %TRUE if all the operations succeeded. Otherwise %FALSE is
+ *   returned and @error is set, the failing operations can then be
+ *   inspected using [method@Batch.get_error].
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_batch_submit_finish (NotifyBatch   *batch,
+                            GAsyncResult  *result,
+                            GError       **error)
+{
+        g_return_val_if_fail (NOTIFY_IS_BATCH (batch), FALSE);
+        g_return_val_if_fail (g_task_is_valid (result, batch), FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
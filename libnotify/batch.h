@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <libnotify/notification.h>
+
+G_BEGIN_DECLS
+
+#define NOTIFY_TYPE_BATCH                (notify_batch_get_type ())
+
+G_DECLARE_FINAL_TYPE (NotifyBatch, notify_batch, NOTIFY, BATCH, GObject);
+
+/**
+ * NotifyBatch:
+ *
+ * A set of notification operations submitted in a single pass.
+ *
+ * #NotifyBatch collects many [method@Notification.show] and
+ * [method@Notification.close] operations and sends all their requests
+ * back-to-back to the notification server, without waiting for each reply
+ * before sending the next one. The replies are collected in whatever order
+ * they arrive and the completion is reported once all of them are received.
+ *
+ * Since: 0.8.8
+ */
+
+NotifyBatch        *notify_batch_new                (void);
+
+void                notify_batch_add_show           (NotifyBatch         *batch,
+                                                     NotifyNotification  *notification);
+
+void                notify_batch_add_close          (NotifyBatch         *batch,
+                                                     NotifyNotification  *notification);
+
+guint               notify_batch_get_n_items        (NotifyBatch         *batch);
+
+NotifyNotification *notify_batch_get_notification   (NotifyBatch         *batch,
+                                                     guint                index);
+
+const GError       *notify_batch_get_error          (NotifyBatch         *batch,
+                                                     guint                index);
+
+void                notify_batch_submit             (NotifyBatch         *batch,
+                                                     GCancellable        *cancellable,
+                                                     GAsyncReadyCallback  callback,
+                                                     gpointer             user_data);
+
+gboolean            notify_batch_submit_finish      (NotifyBatch         *batch,
+                                                     GAsyncResult        *result,
+                                                     GError             **error);
+
+G_END_DECLS
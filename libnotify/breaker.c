@@ -0,0 +1,389 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/*
+ * Without a notification server, each call either activates one or waits
+ * for the D-Bus timeout. The circuit breaker counts the consecutive calls
+ * that failed that way or were too slow, and past the limit it opens: the
+ * notifications are handed to the fallback sink, or fail right away,
+ * until the cool-down period elapses. A single call then probes the
+ * server, closing the circuit if it succeeds.
+ *
+ * Creating the proxy and querying the server information and
+ * capabilities can block as long as showing a notification, so they are
+ * gated and accounted the same way. So is closing a notification, which
+ * can't fall back to anything and fails right away.
+ */
+
+typedef enum
+{
+        BREAKER_CLOSED,
+        BREAKER_OPEN,
+        BREAKER_HALF_OPEN,
+} BreakerState;
+
+static gint          _auto_start = -1; /* Unset, from the environment */
+
+static BreakerState  _state = BREAKER_CLOSED;
+static guint         _max_failures = 0;
+static guint         _slow_call_threshold = 0;
+static guint         _cooldown = 0;
+static guint         _failures = 0;
+static gint64        _open_until = 0;
+static gint64        _probe_time = 0;
+
+static NotifyFallbackFunc _fallback_func = NULL;
+static gpointer           _fallback_data = NULL;
+static GDestroyNotify     _fallback_destroy = NULL;
+
+static gboolean
+get_auto_start (void)
+{
+        if (_auto_start < 0) {
+                const char *no_autostart = g_getenv ("NOTIFY_NO_AUTOSTART");
+
+                _auto_start = no_autostart == NULL ||
+                              g_str_equal (no_autostart, "") ||
+                              g_str_equal (no_autostart, "0");
+        }
+
+        return _auto_start;
+}
+
+/*
+ * _notify_get_auto_start:
+ *
+ * Returns: Whether the notification server may be started through D-Bus
+ *   activation.
+ */
+gboolean
+_notify_get_auto_start (void)
+{
+        return get_auto_start ();
+}
+
+/*
+ * Whether the calls must not activate the server themselves. When the
+ * spool is enabled the notifications are queued while the name has no
+ * owner, and the spool asks for the activation without blocking on it.
+ */
+static gboolean
+calls_skip_auto_start (void)
+{
+        return !get_auto_start () || _notify_spool_is_enabled ();
+}
+
+/*
+ * _notify_get_call_flags:
+ *
+ * Returns: The flags of the calls to the notification server.
+ */
+GDBusCallFlags
+_notify_get_call_flags (void)
+{
+        return calls_skip_auto_start () ? G_DBUS_CALL_FLAGS_NO_AUTO_START
+                                        : G_DBUS_CALL_FLAGS_NONE;
+}
+
+/*
+ * _notify_get_message_flags:
+ *
+ * Returns: The flags of the messages sent without expecting a reply.
+ */
+GDBusMessageFlags
+_notify_get_message_flags (void)
+{
+        GDBusMessageFlags flags = G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED;
+
+        if (calls_skip_auto_start ()) {
+                flags |= G_DBUS_MESSAGE_FLAGS_NO_AUTO_START;
+        }
+
+        return flags;
+}
+
+static gboolean
+error_means_unavailable (const GError *error)
+{
+        return g_error_matches (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT) ||
+               g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NO_REPLY) ||
+               g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_TIMEOUT) ||
+               g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_TIMED_OUT) ||
+               g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN) ||
+               g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NAME_HAS_NO_OWNER);
+}
+
+/*
+ * _notify_breaker_is_open:
+ *
+ * Gets whether the calls to the notification server must be skipped.
+ *
+ * Once the cool-down period elapsed, the first caller gets %FALSE and
+ * must report the result of its call with _notify_breaker_record().
+ *
+ * Returns: %TRUE if the server must not be called.
+ */
+gboolean
+_notify_breaker_is_open (void)
+{
+        switch (_state) {
+        case BREAKER_CLOSED:
+                return FALSE;
+
+        case BREAKER_OPEN:
+                if (g_get_monotonic_time () < _open_until) {
+                        return TRUE;
+                }
+                break;
+
+        case BREAKER_HALF_OPEN:
+        default:
+                /* Unless the probe was lost, it's still in flight */
+                if (g_get_monotonic_time () - _probe_time <
+                    _cooldown * G_TIME_SPAN_MILLISECOND) {
+                        return TRUE;
+                }
+                break;
+        }
+
+        _state = BREAKER_HALF_OPEN;
+        _probe_time = g_get_monotonic_time ();
+
+        return FALSE;
+}
+
+/*
+ * _notify_breaker_is_blocking:
+ *
+ * Gets whether the circuit is open and cooling down, without claiming the
+ * probe like _notify_breaker_is_open() does once it cooled down.
+ *
+ * Returns: %TRUE if the server must not be called yet.
+ */
+gboolean
+_notify_breaker_is_blocking (void)
+{
+        return _state == BREAKER_OPEN &&
+               g_get_monotonic_time () < _open_until;
+}
+
+/*
+ * _notify_breaker_release:
+ *
+ * Gives up the probe claimed by _notify_breaker_is_open() when nothing
+ * was sent to the server after all, so that the next call probes it.
+ */
+void
+_notify_breaker_release (void)
+{
+        if (_state == BREAKER_HALF_OPEN) {
+                _probe_time = 0;
+        }
+}
+
+/*
+ * _notify_breaker_set_error:
+ * @error: The returned error information.
+ *
+ * Sets the error of the calls skipped because the circuit is open.
+ */
+void
+_notify_breaker_set_error (GError **error)
+{
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                             "The notification server is unavailable");
+}
+
+/*
+ * _notify_breaker_should_fall_back:
+ * @error: The error getting the proxy of the notification server.
+ *
+ * Gets whether a notification whose proxy couldn't be created must be
+ * handed to the fallback sink, since the circuit is or just got open.
+ *
+ * Returns: %TRUE to call _notify_breaker_fallback().
+ */
+gboolean
+_notify_breaker_should_fall_back (const GError *error)
+{
+        return _notify_breaker_is_blocking () ||
+               g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED);
+}
+
+/*
+ * _notify_breaker_record:
+ * @start_time: The monotonic time when the call was made.
+ * @error: (nullable): The error of the call, or %NULL if it succeeded.
+ *
+ * Accounts the result of a call to the notification server.
+ */
+void
+_notify_breaker_record (gint64        start_time,
+                        const GError *error)
+{
+        gint64 duration = g_get_monotonic_time () - start_time;
+        gboolean failed;
+
+        if (_max_failures == 0) {
+                return;
+        }
+
+        if (error != NULL) {
+                failed = error_means_unavailable (error);
+        } else {
+                failed = _slow_call_threshold > 0 &&
+                         duration > _slow_call_threshold * G_TIME_SPAN_MILLISECOND;
+        }
+
+        if (!failed) {
+                /* Other errors tell nothing about the server availability */
+                if (error == NULL || _state == BREAKER_HALF_OPEN) {
+                        _failures = 0;
+                        _state = BREAKER_CLOSED;
+                }
+                return;
+        }
+
+        if (_state == BREAKER_HALF_OPEN || ++_failures >= _max_failures) {
+                g_debug ("The notification server is unavailable, "
+                         "not calling it for %u ms", _cooldown);
+                _state = BREAKER_OPEN;
+                _open_until = g_get_monotonic_time () +
+                              _cooldown * G_TIME_SPAN_MILLISECOND;
+        }
+}
+
+/*
+ * _notify_breaker_fallback:
+ * @notification: The notification that couldn't be shown.
+ * @error: The returned error information.
+ *
+ * Hands @notification to the fallback sink, since the circuit is open.
+ *
+ * Returns: %TRUE if the fallback sink took @notification, otherwise
+ *   @error is set.
+ */
+gboolean
+_notify_breaker_fallback (NotifyNotification  *notification,
+                          GError             **error)
+{
+        if (_fallback_func != NULL) {
+                _fallback_func (notification, _fallback_data);
+                return TRUE;
+        }
+
+        _notify_breaker_set_error (error);
+
+        return FALSE;
+}
+
+/**
+ * notify_set_auto_start:
+ * @auto_start: Whether calls can start the notification server.
+ *
+ * Sets whether the calls to the notification server can start it through
+ * D-Bus activation. Disabling it makes the notifications fail right away
+ * when no server is running, rather than waiting for an activation that
+ * may time out, for instance on headless systems.
+ *
+ * By default the server is started, unless the `NOTIFY_NO_AUTOSTART`
+ * environment variable is set.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_auto_start (gboolean auto_start)
+{
+        _auto_start = !!auto_start;
+}
+
+/**
+ * notify_set_circuit_breaker:
+ * @max_failures: The number of consecutive failed calls opening the
+ *   circuit, or 0 to disable the circuit breaker.
+ * @slow_call_threshold: The duration, in milliseconds, above which a
+ *   successful call counts as failed, or 0.
+ * @cooldown: How long, in milliseconds, the notification server isn't
+ *   called once the circuit is open.
+ *
+ * Stops calling the notification server for @cooldown once
+ * @max_failures calls in a row timed out, failed because no server is
+ * available, or took longer than @slow_call_threshold. Meanwhile, showing
+ * a notification hands it to the function set with
+ * [func@set_fallback_sink], or fails with %G_IO_ERROR_NOT_CONNECTED.
+ *
+ * After @cooldown, the next notification is sent to probe the server,
+ * and the circuit closes if that call succeeds.
+ *
+ * Connecting to the server and querying its information and capabilities
+ * are accounted and skipped the same way, and closing a notification
+ * fails with %G_IO_ERROR_NOT_CONNECTED while the circuit is open. This
+ * only applies to the default client, not to the ones created with
+ * [ctor@Client.new].
+ *
+ * The circuit breaker is disabled by default.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_circuit_breaker (guint max_failures,
+                            guint slow_call_threshold,
+                            guint cooldown)
+{
+        _max_failures = max_failures;
+        _slow_call_threshold = slow_call_threshold;
+        _cooldown = cooldown;
+
+        _failures = 0;
+        _state = BREAKER_CLOSED;
+}
+
+/**
+ * notify_set_fallback_sink:
+ * @func: (nullable) (scope notified) (closure user_data): The function to
+ *   call with the notifications that can't be shown, or %NULL.
+ * @user_data: User data to pass to @func.
+ * @destroy: (nullable): Destroy notifier for @user_data.
+ *
+ * Sets the function the notifications are handed to while the circuit
+ * breaker set with [func@set_circuit_breaker] is open, for instance to
+ * log them. Showing them then succeeds.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_fallback_sink (NotifyFallbackFunc func,
+                          gpointer           user_data,
+                          GDestroyNotify     destroy)
+{
+        if (_fallback_destroy != NULL) {
+                _fallback_destroy (_fallback_data);
+        }
+
+        _fallback_func = func;
+        _fallback_data = user_data;
+        _fallback_destroy = destroy;
+}
@@ -0,0 +1,512 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/*
+ * Each session is delivered to from a thread of its own, so that a slow
+ * or unresponsive bus only holds its own slot: connecting to a bus and
+ * querying its notification server are blocking steps of a client. The
+ * threads only read the copy of the notification made when the broadcast
+ * was created, and each of them uses a client of its own.
+ */
+
+#define BROADCAST_RUNTIME_DIR  "/run/user"
+#define DEFAULT_MAX_CONCURRENT 8
+
+typedef struct
+{
+        guint               uid;
+        char               *address;
+        NotifyNotification *notification;
+        GError             *error;
+} BroadcastSession;
+
+struct _NotifyBroadcast
+{
+        GObject             parent_instance;
+
+        /* The content to deliver, never changed once copied */
+        NotifyNotification *content;
+        char               *app_name;
+        GArray             *sessions;
+        GTask              *task;
+        guint               max_concurrent;
+        guint               next;
+        guint               running;
+        guint               failed;
+        gboolean            submitted;
+};
+
+G_DEFINE_TYPE (NotifyBroadcast, notify_broadcast, G_TYPE_OBJECT)
+
+static void
+broadcast_session_clear (BroadcastSession *session)
+{
+        g_clear_pointer (&session->address, g_free);
+        g_clear_object (&session->notification);
+        g_clear_error (&session->error);
+}
+
+static void
+notify_broadcast_finalize (GObject *object)
+{
+        NotifyBroadcast *broadcast = NOTIFY_BROADCAST (object);
+
+        g_clear_object (&broadcast->content);
+        g_clear_pointer (&broadcast->app_name, g_free);
+        g_clear_pointer (&broadcast->sessions, g_array_unref);
+
+        G_OBJECT_CLASS (notify_broadcast_parent_class)->finalize (object);
+}
+
+static void
+notify_broadcast_class_init (NotifyBroadcastClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = notify_broadcast_finalize;
+}
+
+static void
+notify_broadcast_init (NotifyBroadcast *broadcast)
+{
+        broadcast->sessions = g_array_new (FALSE, TRUE, sizeof (BroadcastSession));
+        g_array_set_clear_func (broadcast->sessions,
+                                (GDestroyNotify) broadcast_session_clear);
+        broadcast->max_concurrent = DEFAULT_MAX_CONCURRENT;
+}
+
+/**
+ * notify_broadcast_new:
+ * @notification: The notification to deliver.
+ *
+ * Creates a new #NotifyBroadcast delivering the content of @notification:
+ * its text, icons, timeout and hints, but not its actions.
+ *
+ * The content is copied, so later changes to @notification don't affect
+ * the broadcast, and @notification itself is never shown.
+ *
+ * Returns: (transfer full): The new #NotifyBroadcast.
+ *
+ * Since: 0.8.8
+ */
+NotifyBroadcast *
+notify_broadcast_new (NotifyNotification *notification)
+{
+        NotifyBroadcast *broadcast;
+
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), NULL);
+
+        broadcast = g_object_new (NOTIFY_TYPE_BROADCAST, NULL);
+        broadcast->content = _notify_notification_copy (notification, NULL);
+        broadcast->app_name = g_strdup (notify_is_initted () ?
+                                        notify_get_app_name () :
+                                        g_get_prgname ());
+
+        return broadcast;
+}
+
+/**
+ * notify_broadcast_set_max_concurrent:
+ * @broadcast: The broadcast.
+ * @max_concurrent: The maximum number of sessions delivered to at once.
+ *
+ * Sets how many sessions can be delivered to at once. By default, up to
+ * 8 sessions are.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_broadcast_set_max_concurrent (NotifyBroadcast *broadcast,
+                                     guint            max_concurrent)
+{
+        g_return_if_fail (NOTIFY_IS_BROADCAST (broadcast));
+        g_return_if_fail (max_concurrent > 0);
+        g_return_if_fail (!broadcast->submitted);
+
+        broadcast->max_concurrent = max_concurrent;
+}
+
+/**
+ * notify_broadcast_get_n_sessions:
+ * @broadcast: The broadcast.
+ *
+ * Gets the number of sessions found when @broadcast was submitted.
+ *
+ * Returns: The number of sessions.
+ *
+ * Since: 0.8.8
+ */
+guint
+notify_broadcast_get_n_sessions (NotifyBroadcast *broadcast)
+{
+        g_return_val_if_fail (NOTIFY_IS_BROADCAST (broadcast), 0);
+
+        return broadcast->sessions->len;
+}
+
+/**
+ * notify_broadcast_get_uid:
+ * @broadcast: The broadcast.
+ * @index: The index of the session, sorted by user id.
+ *
+ * Gets the id of the user owning the session at @index.
+ *
+ * Returns: The user id.
+ *
+ * Since: 0.8.8
+ */
+guint
+notify_broadcast_get_uid (NotifyBroadcast *broadcast,
+                          guint            index)
+{
+        g_return_val_if_fail (NOTIFY_IS_BROADCAST (broadcast), 0);
+        g_return_val_if_fail (index < broadcast->sessions->len, 0);
+
+        return g_array_index (broadcast->sessions, BroadcastSession, index).uid;
+}
+
+/**
+ * notify_broadcast_get_address:
+ * @broadcast: The broadcast.
+ * @index: The index of the session, sorted by user id.
+ *
+ * Gets the D-Bus address of the session bus at @index.
+ *
+ * Returns: (transfer none): The address.
+ *
+ * Since: 0.8.8
+ */
+const char *
+notify_broadcast_get_address (NotifyBroadcast *broadcast,
+                              guint            index)
+{
+        g_return_val_if_fail (NOTIFY_IS_BROADCAST (broadcast), NULL);
+        g_return_val_if_fail (index < broadcast->sessions->len, NULL);
+
+        return g_array_index (broadcast->sessions, BroadcastSession, index).address;
+}
+
+/**
+ * notify_broadcast_get_notification:
+ * @broadcast: The broadcast.
+ * @index: The index of the session, sorted by user id.
+ *
+ * Gets the copy of the notification shown in the session at @index,
+ * bound to a [class@Client] connected to its bus, for instance to close
+ * it later. The connection is kept open as long as the notification is
+ * alive.
+ *
+ * This is only meaningful once the broadcast submission has completed.
+ *
+ * Returns: (nullable) (transfer none): The notification, or %NULL if the
+ *   session bus couldn't be connected to.
+ *
+ * Since: 0.8.8
+ */
+NotifyNotification *
+notify_broadcast_get_notification (NotifyBroadcast *broadcast,
+                                   guint            index)
+{
+        g_return_val_if_fail (NOTIFY_IS_BROADCAST (broadcast), NULL);
+        g_return_val_if_fail (index < broadcast->sessions->len, NULL);
+
+        return g_array_index (broadcast->sessions, BroadcastSession, index).notification;
+}
+
+/**
+ * notify_broadcast_get_error:
+ * @broadcast: The broadcast.
+ * @index: The index of the session, sorted by user id.
+ *
+ * Gets the error of the delivery to the session at @index.
+ *
+ * This is only meaningful once the broadcast submission has completed.
+ *
+ * Returns: (nullable) (transfer none): The error of the delivery, or
+ *   %NULL if it succeeded.
+ *
+ * Since: 0.8.8
+ */
+const GError *
+notify_broadcast_get_error (NotifyBroadcast *broadcast,
+                            guint            index)
+{
+        g_return_val_if_fail (NOTIFY_IS_BROADCAST (broadcast), NULL);
+        g_return_val_if_fail (index < broadcast->sessions->len, NULL);
+
+        return g_array_index (broadcast->sessions, BroadcastSession, index).error;
+}
+
+static gint
+broadcast_session_compare (gconstpointer a,
+                           gconstpointer b)
+{
+        const BroadcastSession *session_a = a;
+        const BroadcastSession *session_b = b;
+
+        if (session_a->uid == session_b->uid) {
+                return 0;
+        }
+
+        return session_a->uid < session_b->uid ? -1 : 1;
+}
+
+/*
+ * Adds the sessions whose bus socket the process has the permissions to
+ * connect to. Whether the bus accepts the process is only known once
+ * connected.
+ */
+static gboolean
+broadcast_find_sessions (NotifyBroadcast  *broadcast,
+                         GError          **error)
+{
+        const char *name;
+        GDir *dir;
+
+        dir = g_dir_open (BROADCAST_RUNTIME_DIR, 0, error);
+        if (dir == NULL) {
+                return FALSE;
+        }
+
+        while ((name = g_dir_read_name (dir)) != NULL) {
+                BroadcastSession session = { 0, };
+                g_autofree char *path = NULL;
+                g_autofree char *escaped = NULL;
+                GStatBuf st;
+                guint64 uid;
+
+                if (!g_ascii_string_to_unsigned (name, 10, 0, G_MAXUINT32,
+                                                 &uid, NULL)) {
+                        continue;
+                }
+
+                path = g_build_filename (BROADCAST_RUNTIME_DIR, name, "bus", NULL);
+                if (g_stat (path, &st) != 0 || !S_ISSOCK (st.st_mode) ||
+                    g_access (path, R_OK | W_OK) != 0) {
+                        continue;
+                }
+
+                escaped = g_dbus_address_escape_value (path);
+                session.uid = uid;
+                session.address = g_strconcat ("unix:path=", escaped, NULL);
+                g_array_append_val (broadcast->sessions, session);
+        }
+
+        g_dir_close (dir);
+
+        g_array_sort (broadcast->sessions, broadcast_session_compare);
+
+        return TRUE;
+}
+
+static void
+broadcast_session_deliver (GTask        *task,
+                           gpointer      source_object,
+                           gpointer      task_data,
+                           GCancellable *cancellable)
+{
+        NotifyBroadcast *broadcast = source_object;
+        BroadcastSession *session = task_data;
+        GDBusConnection *connection;
+        NotifyClient *client;
+        GError *error = NULL;
+
+        connection = g_dbus_connection_new_for_address_sync (session->address,
+                                                             G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                             NULL,
+                                                             cancellable,
+                                                             &error);
+        if (connection == NULL) {
+                g_task_return_error (task, error);
+                return;
+        }
+
+        client = notify_client_new (broadcast->app_name, connection);
+        session->notification = _notify_notification_copy (broadcast->content,
+                                                           client);
+        g_object_unref (client);
+        g_object_unref (connection);
+
+        if (!notify_notification_show (session->notification, &error)) {
+                g_task_return_error (task, error);
+                return;
+        }
+
+        g_task_return_boolean (task, TRUE);
+}
+
+static void broadcast_deliver_next (NotifyBroadcast *broadcast);
+
+static void
+on_session_delivered (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+        NotifyBroadcast *broadcast = NOTIFY_BROADCAST (source);
+        BroadcastSession *session = g_task_get_task_data (G_TASK (result));
+
+        if (!g_task_propagate_boolean (G_TASK (result), &session->error)) {
+                g_debug ("Failed to deliver to the session of user %u: %s",
+                         session->uid, session->error->message);
+                broadcast->failed++;
+        }
+
+        broadcast->running--;
+        broadcast_deliver_next (broadcast);
+}
+
+/*
+ * Starts delivering to the next sessions while there are free slots, and
+ * completes the submission once all the sessions are done.
+ */
+static void
+broadcast_deliver_next (NotifyBroadcast *broadcast)
+{
+        GCancellable *cancellable = g_task_get_cancellable (broadcast->task);
+
+        while (broadcast->running < broadcast->max_concurrent &&
+               broadcast->next < broadcast->sessions->len) {
+                BroadcastSession *session = &g_array_index (broadcast->sessions,
+                                                            BroadcastSession,
+                                                            broadcast->next++);
+                GTask *task;
+
+                if (g_cancellable_set_error_if_cancelled (cancellable,
+                                                          &session->error)) {
+                        broadcast->failed++;
+                        continue;
+                }
+
+                task = g_task_new (broadcast, cancellable,
+                                   on_session_delivered, NULL);
+                g_task_set_source_tag (task, broadcast_deliver_next);
+                g_task_set_task_data (task, session, NULL);
+                g_task_run_in_thread (task, broadcast_session_deliver);
+                g_object_unref (task);
+
+                broadcast->running++;
+        }
+
+        if (broadcast->running > 0) {
+                return;
+        }
+
+        if (broadcast->failed == 0) {
+                g_task_return_boolean (broadcast->task, TRUE);
+        } else if (!g_task_return_error_if_cancelled (broadcast->task)) {
+                g_task_return_new_error (broadcast->task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_FAILED,
+                                         "%u of %u sessions could not be delivered to",
+                                         broadcast->failed,
+                                         broadcast->sessions->len);
+        }
+
+        g_clear_object (&broadcast->task);
+}
+
+/**
+ * notify_broadcast_submit:
+ * @broadcast: The broadcast.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @callback: (scope async): The callback to call when all the sessions
+ *   were delivered to.
+ * @user_data: User data to pass to @callback.
+ *
+ * Asynchronously finds the session buses under `/run/user` that the
+ * process may connect to, and shows the notification through each of
+ * them, delivering to up to the number of sessions set with
+ * [method@Broadcast.set_max_concurrent] at once.
+ *
+ * The notifications are sent as by a [class@Client] of their own, so the
+ * process-wide policies don't apply to them. Connecting to the bus of
+ * another user usually requires running as that user or as root, and the
+ * bus may still refuse the connection.
+ *
+ * Once all the sessions were delivered to @callback is called, and
+ * [method@Broadcast.submit_finish] can be used to know whether the
+ * delivery to all of them succeeded, while [method@Broadcast.get_error]
+ * gives the result of each session.
+ *
+ * A broadcast can only be submitted once.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_broadcast_submit (NotifyBroadcast     *broadcast,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+        GError *error = NULL;
+
+        g_return_if_fail (NOTIFY_IS_BROADCAST (broadcast));
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+        g_return_if_fail (!broadcast->submitted);
+
+        broadcast->submitted = TRUE;
+        broadcast->task = g_task_new (broadcast, cancellable, callback, user_data);
+        g_task_set_source_tag (broadcast->task, notify_broadcast_submit);
+
+        if (!broadcast_find_sessions (broadcast, &error)) {
+                g_task_return_error (broadcast->task, error);
+                g_clear_object (&broadcast->task);
+                return;
+        }
+
+        broadcast_deliver_next (broadcast);
+}
+
+/**
+ * notify_broadcast_submit_finish:
+ * @broadcast: The broadcast.
+ * @result: The #GAsyncResult passed to the callback.
+ * @error: The returned error information.
+ *
+ * Finishes an operation started with [method@Broadcast.submit].
+ *
+ * Returns: %TRUE if the notification was delivered to all the sessions
+ *   found, including when none was. Otherwise %FALSE is returned and
+ *   @error is set, the failing sessions can then be inspected using
+ *   [method@Broadcast.get_error].
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_broadcast_submit_finish (NotifyBroadcast  *broadcast,
+                                GAsyncResult     *result,
+                                GError          **error)
+{
+        g_return_val_if_fail (NOTIFY_IS_BROADCAST (broadcast), FALSE);
+        g_return_val_if_fail (g_task_is_valid (result, broadcast), FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -0,0 +1,73 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <libnotify/notification.h>
+
+G_BEGIN_DECLS
+
+#define NOTIFY_TYPE_BROADCAST            (notify_broadcast_get_type ())
+
+G_DECLARE_FINAL_TYPE (NotifyBroadcast, notify_broadcast, NOTIFY, BROADCAST, GObject);
+
+/**
+ * NotifyBroadcast:
+ *
+ * The delivery of a notification to every user session.
+ *
+ * #NotifyBroadcast finds the session buses the process can connect to
+ * under `/run/user`, and shows a copy of a notification through the
+ * notification server of each of them, delivering to several sessions
+ * at once. The result of the delivery to each session can be inspected
+ * once the submission has completed.
+ *
+ * Since: 0.8.8
+ */
+
+NotifyBroadcast    *notify_broadcast_new                (NotifyNotification  *notification);
+
+void                notify_broadcast_set_max_concurrent (NotifyBroadcast     *broadcast,
+                                                         guint                max_concurrent);
+
+guint               notify_broadcast_get_n_sessions     (NotifyBroadcast     *broadcast);
+
+guint               notify_broadcast_get_uid            (NotifyBroadcast     *broadcast,
+                                                         guint                index);
+
+const char         *notify_broadcast_get_address        (NotifyBroadcast     *broadcast,
+                                                         guint                index);
+
+NotifyNotification *notify_broadcast_get_notification   (NotifyBroadcast     *broadcast,
+                                                         guint                index);
+
+const GError       *notify_broadcast_get_error          (NotifyBroadcast     *broadcast,
+                                                         guint                index);
+
+void                notify_broadcast_submit             (NotifyBroadcast     *broadcast,
+                                                         GCancellable        *cancellable,
+                                                         GAsyncReadyCallback  callback,
+                                                         gpointer             user_data);
+
+gboolean            notify_broadcast_submit_finish      (NotifyBroadcast     *broadcast,
+                                                         GAsyncResult        *result,
+                                                         GError             **error);
+
+G_END_DECLS
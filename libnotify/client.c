@@ -0,0 +1,652 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+struct _NotifyClient
+{
+        GObject          parent_instance;
+
+        char            *app_name;
+        GDBusConnection *connection;
+        GDBusProxy      *proxy;
+
+        guint            name_owner_serial;
+        int              spec_version_major;
+        int              spec_version_minor;
+        /* The capabilities of the server, if known */
+        char           **server_caps;
+
+        /* The notifications bound to the client, which keep it alive */
+        GMutex           lock;
+        GList           *notifications;
+        NotifyRoutes    *routes;
+
+        /* Whether the client stands for the global state */
+        gboolean         is_default;
+};
+
+enum
+{
+        PROP_0,
+        PROP_APP_NAME,
+        PROP_CONNECTION,
+        NUM_PROPERTIES,
+};
+
+static GParamSpec *properties[NUM_PROPERTIES] = { 0 };
+
+G_DEFINE_TYPE (NotifyClient, notify_client, G_TYPE_OBJECT)
+
+static void
+notify_client_finalize (GObject *object)
+{
+        NotifyClient *client = NOTIFY_CLIENT (object);
+
+        g_assert (client->notifications == NULL);
+
+        _notify_routes_free (client->routes);
+
+        if (client->proxy != NULL) {
+                g_signal_handlers_disconnect_by_data (client->proxy, client);
+                g_object_unref (client->proxy);
+        }
+
+        g_clear_object (&client->connection);
+        g_clear_pointer (&client->server_caps, g_strfreev);
+        g_free (client->app_name);
+        g_mutex_clear (&client->lock);
+
+        G_OBJECT_CLASS (notify_client_parent_class)->finalize (object);
+}
+
+static void
+notify_client_set_property (GObject      *object,
+                            guint         prop_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+        NotifyClient *client = NOTIFY_CLIENT (object);
+
+        switch (prop_id) {
+        case PROP_APP_NAME:
+                client->app_name = g_value_dup_string (value);
+                break;
+
+        case PROP_CONNECTION:
+                client->connection = g_value_dup_object (value);
+                break;
+
+        default:
+                G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+                break;
+        }
+}
+
+static void
+notify_client_get_property (GObject    *object,
+                            guint       prop_id,
+                            GValue     *value,
+                            GParamSpec *pspec)
+{
+        NotifyClient *client = NOTIFY_CLIENT (object);
+
+        switch (prop_id) {
+        case PROP_APP_NAME:
+                g_value_set_string (value, notify_client_get_app_name (client));
+                break;
+
+        case PROP_CONNECTION:
+                g_value_set_object (value, client->connection);
+                break;
+
+        default:
+                G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+                break;
+        }
+}
+
+static void
+notify_client_class_init (NotifyClientClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->get_property = notify_client_get_property;
+        object_class->set_property = notify_client_set_property;
+        object_class->finalize = notify_client_finalize;
+
+        /**
+         * NotifyClient:app-name:
+         *
+         * The name of the application the notifications of the client are
+         * sent for.
+         *
+         * Since: 0.8.8
+         */
+        properties[PROP_APP_NAME] = g_param_spec_string ("app-name",
+                                                         "Application name",
+                                                         "The application name of the notifications",
+                                                         NULL,
+                                                         G_PARAM_READWRITE
+                                                         | G_PARAM_CONSTRUCT_ONLY
+                                                         | G_PARAM_STATIC_STRINGS);
+
+        /**
+         * NotifyClient:connection:
+         *
+         * The connection to the notification server, or %NULL to use the
+         * session bus.
+         *
+         * Since: 0.8.8
+         */
+        properties[PROP_CONNECTION] = g_param_spec_object ("connection",
+                                                           "Connection",
+                                                           "The connection to the notification server",
+                                                           G_TYPE_DBUS_CONNECTION,
+                                                           G_PARAM_READWRITE
+                                                           | G_PARAM_CONSTRUCT_ONLY
+                                                           | G_PARAM_STATIC_STRINGS);
+
+        g_object_class_install_properties (object_class, NUM_PROPERTIES, properties);
+}
+
+static void
+notify_client_init (NotifyClient *client)
+{
+        g_mutex_init (&client->lock);
+        client->routes = _notify_routes_new ();
+}
+
+static void
+on_name_owner_changed (GDBusProxy   *proxy,
+                       GParamSpec   *pspec,
+                       NotifyClient *client)
+{
+        /* The information is queried again from the new server, if any */
+        client->name_owner_serial++;
+        g_clear_pointer (&client->server_caps, g_strfreev);
+        client->spec_version_major = 0;
+        client->spec_version_minor = 0;
+}
+
+static gboolean
+client_update_spec_version (NotifyClient  *client,
+                            GError       **error)
+{
+        char *spec_version;
+
+        if (!_notify_proxy_get_server_info (client->proxy, NULL, NULL, NULL,
+                                            &spec_version, error)) {
+                return FALSE;
+        }
+
+        _notify_parse_spec_version (spec_version,
+                                    &client->spec_version_major,
+                                    &client->spec_version_minor);
+        g_free (spec_version);
+
+        return TRUE;
+}
+
+/*
+ * _notify_client_is_default:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: %TRUE if @client is the default client, using the global state.
+ */
+gboolean
+_notify_client_is_default (NotifyClient *client)
+{
+        return client == NULL || client->is_default;
+}
+
+/*
+ * _notify_client_get_proxy:
+ * @client: (nullable): A client, or %NULL for the default client.
+ * @error: (nullable): a location to store a #GError, or %NULL
+ *
+ * Gets the proxy for the notification server of @client, creating it and
+ * querying the version of the server if needed.
+ *
+ * Returns: (nullable) (transfer none): The proxy, or %NULL on error.
+ */
+GDBusProxy *
+_notify_client_get_proxy (NotifyClient  *client,
+                          GError       **error)
+{
+        if (_notify_client_is_default (client)) {
+                return _notify_get_proxy (error);
+        }
+
+        if (client->proxy == NULL) {
+                GDBusConnection *connection;
+
+                connection = notify_client_get_connection (client, error);
+                if (connection == NULL) {
+                        return NULL;
+                }
+
+                client->proxy = _notify_proxy_new (connection, error);
+                if (client->proxy == NULL) {
+                        return NULL;
+                }
+
+                g_signal_connect (client->proxy, "notify::name-owner",
+                                  G_CALLBACK (on_name_owner_changed), client);
+        }
+
+        if (client->spec_version_major == 0 &&
+            !client_update_spec_version (client, error)) {
+                return NULL;
+        }
+
+        return client->proxy;
+}
+
+/*
+ * _notify_client_get_name_owner_serial:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: A number changing whenever the server of @client changes.
+ */
+guint
+_notify_client_get_name_owner_serial (NotifyClient *client)
+{
+        if (_notify_client_is_default (client)) {
+                return _notify_get_name_owner_serial ();
+        }
+
+        return client->name_owner_serial;
+}
+
+/*
+ * _notify_client_has_spec_version:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: %TRUE if the specification version of the server is known.
+ */
+gboolean
+_notify_client_has_spec_version (NotifyClient *client)
+{
+        if (_notify_client_is_default (client)) {
+                return _notify_has_spec_version ();
+        }
+
+        return client->spec_version_major > 0;
+}
+
+/*
+ * _notify_client_check_spec_version:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: %TRUE if the server implements at least the version
+ *   @major.@minor of the specification.
+ */
+gboolean
+_notify_client_check_spec_version (NotifyClient *client,
+                                   int           major,
+                                   int           minor)
+{
+        if (_notify_client_is_default (client)) {
+                return _notify_check_spec_version (major, minor);
+        }
+
+        return _notify_spec_version_is_at_least (client->spec_version_major,
+                                                 client->spec_version_minor,
+                                                 major, minor);
+}
+
+/*
+ * _notify_client_get_app_name:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: (nullable): The application name of the notifications.
+ */
+const char *
+_notify_client_get_app_name (NotifyClient *client)
+{
+        if (_notify_client_is_default (client)) {
+                return notify_get_app_name ();
+        }
+
+        return client->app_name;
+}
+
+/*
+ * _notify_client_get_app_icon:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: (nullable): The application icon of the notifications.
+ */
+const char *
+_notify_client_get_app_icon (NotifyClient *client)
+{
+        if (_notify_client_is_default (client)) {
+                return notify_get_app_icon ();
+        }
+
+        return NULL;
+}
+
+/*
+ * _notify_client_uses_portal:
+ * @client: (nullable): A client, or %NULL for the default client.
+ *
+ * Returns: %TRUE if the notifications of @client are sent to the portal.
+ */
+gboolean
+_notify_client_uses_portal (NotifyClient *client)
+{
+        return _notify_client_is_default (client) &&
+               _notify_uses_portal_notifications ();
+}
+
+/*
+ * _notify_client_get_routes:
+ * @client: A client, other than the default one.
+ *
+ * Returns: (transfer none): The routes of the server signals to the
+ *   notifications of @client.
+ */
+NotifyRoutes *
+_notify_client_get_routes (NotifyClient *client)
+{
+        g_assert (!_notify_client_is_default (client));
+
+        return client->routes;
+}
+
+/*
+ * _notify_client_add_notification:
+ * @client: (nullable): A client, or %NULL for the default client.
+ * @n: A notification bound to @client.
+ */
+void
+_notify_client_add_notification (NotifyClient       *client,
+                                 NotifyNotification *n)
+{
+        if (_notify_client_is_default (client)) {
+                _notify_cache_add_notification (n);
+                return;
+        }
+
+        g_mutex_lock (&client->lock);
+        client->notifications = g_list_prepend (client->notifications, n);
+        g_mutex_unlock (&client->lock);
+}
+
+/*
+ * _notify_client_remove_notification:
+ * @client: (nullable): A client, or %NULL for the default client.
+ * @n: A notification bound to @client, being finalized.
+ */
+void
+_notify_client_remove_notification (NotifyClient       *client,
+                                    NotifyNotification *n)
+{
+        if (_notify_client_is_default (client)) {
+                _notify_cache_remove_notification (n);
+                return;
+        }
+
+        /* The last reference may be dropped from a dispatch thread */
+        g_mutex_lock (&client->lock);
+        client->notifications = g_list_remove (client->notifications, n);
+        g_mutex_unlock (&client->lock);
+}
+
+/**
+ * notify_client_new:
+ * @app_name: The name of the application.
+ * @connection: (nullable): The connection to the notification server, or
+ *   %NULL to use the session bus.
+ *
+ * Creates a client talking to the notification server over @connection,
+ * which can be a message bus connection or a peer-to-peer connection to
+ * the server itself.
+ *
+ * The connection is only used once a notification of the client is
+ * shown, or the server is queried.
+ *
+ * Returns: (transfer full): The new client.
+ *
+ * Since: 0.8.8
+ */
+NotifyClient *
+notify_client_new (const char      *app_name,
+                   GDBusConnection *connection)
+{
+        g_return_val_if_fail (app_name != NULL && *app_name != '\0', NULL);
+        g_return_val_if_fail (connection == NULL ||
+                              G_IS_DBUS_CONNECTION (connection), NULL);
+
+        return g_object_new (NOTIFY_TYPE_CLIENT,
+                             "app-name", app_name,
+                             "connection", connection,
+                             NULL);
+}
+
+/**
+ * notify_client_get_default:
+ *
+ * Gets the client the global functions, such as [func@init] or
+ * [func@get_server_caps], work on.
+ *
+ * Returns: (transfer none): The default client.
+ *
+ * Since: 0.8.8
+ */
+NotifyClient *
+notify_client_get_default (void)
+{
+        static NotifyClient *default_client = NULL;
+
+        if (g_once_init_enter (&default_client)) {
+                NotifyClient *client = g_object_new (NOTIFY_TYPE_CLIENT, NULL);
+
+                client->is_default = TRUE;
+                g_once_init_leave (&default_client, client);
+        }
+
+        return default_client;
+}
+
+/**
+ * notify_client_get_app_name:
+ * @client: The client.
+ *
+ * Gets the name of the application the notifications of @client are sent
+ * for, unless they have their own [property@Notification:app-name].
+ *
+ * Returns: (nullable): The application name.
+ *
+ * Since: 0.8.8
+ */
+const char *
+notify_client_get_app_name (NotifyClient *client)
+{
+        g_return_val_if_fail (NOTIFY_IS_CLIENT (client), NULL);
+
+        if (client->is_default) {
+                return notify_get_app_name ();
+        }
+
+        return client->app_name;
+}
+
+/**
+ * notify_client_get_connection:
+ * @client: The client.
+ * @error: The returned error information.
+ *
+ * Gets the connection to the notification server, connecting to the
+ * session bus if @client was created without a connection.
+ *
+ * Returns: (transfer none) (nullable): The connection, or %NULL on error.
+ *
+ * Since: 0.8.8
+ */
+GDBusConnection *
+notify_client_get_connection (NotifyClient  *client,
+                              GError       **error)
+{
+        GDBusProxy *proxy;
+
+        g_return_val_if_fail (NOTIFY_IS_CLIENT (client), NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        if (client->is_default) {
+                proxy = _notify_get_proxy (error);
+
+                return proxy ? g_dbus_proxy_get_connection (proxy) : NULL;
+        }
+
+        if (client->connection == NULL) {
+                client->connection = g_bus_get_sync (G_BUS_TYPE_SESSION,
+                                                     NULL, error);
+        }
+
+        return client->connection;
+}
+
+/**
+ * notify_client_new_notification:
+ * @client: The client.
+ * @summary: The required summary text.
+ * @body: (nullable): The optional body text.
+ * @icon: (nullable): The optional icon theme icon name or filename.
+ *
+ * Creates a new notification bound to @client, like
+ * [ctor@Notification.new] does for the default client.
+ *
+ * Returns: (transfer full): The new notification.
+ *
+ * Since: 0.8.8
+ */
+NotifyNotification *
+notify_client_new_notification (NotifyClient *client,
+                                const char   *summary,
+                                const char   *body,
+                                const char   *icon)
+{
+        g_return_val_if_fail (NOTIFY_IS_CLIENT (client), NULL);
+
+        return g_object_new (NOTIFY_TYPE_NOTIFICATION,
+                             "client", client,
+                             "summary", summary,
+                             "body", body,
+                             "icon-name", icon,
+                             NULL);
+}
+
+/**
+ * notify_client_get_server_caps:
+ * @client: The client.
+ *
+ * Queries the capabilities of the notification server of @client, like
+ * [func@get_server_caps] does for the default client.
+ *
+ * Returns: (transfer full) (element-type utf8): a list of server
+ *   capability strings.
+ *
+ * Since: 0.8.8
+ */
+GList *
+notify_client_get_server_caps (NotifyClient *client)
+{
+        GDBusProxy *proxy;
+        GList      *list = NULL;
+
+        g_return_val_if_fail (NOTIFY_IS_CLIENT (client), NULL);
+
+        if (client->is_default) {
+                return notify_get_server_caps ();
+        }
+
+        proxy = _notify_client_get_proxy (client, NULL);
+        if (proxy == NULL) {
+                return NULL;
+        }
+
+        if (client->server_caps == NULL) {
+                client->server_caps = _notify_proxy_get_server_caps (proxy, NULL);
+                if (client->server_caps == NULL) {
+                        return NULL;
+                }
+        }
+
+        for (char **cap = client->server_caps; *cap != NULL; cap++) {
+                list = g_list_prepend (list, g_strdup (*cap));
+        }
+
+        return g_list_reverse (list);
+}
+
+/**
+ * notify_client_get_server_info:
+ * @client: The client.
+ * @ret_name: (out) (optional) (transfer full): a location to store the server name, or %NULL
+ * @ret_vendor: (out) (optional) (transfer full): a location to store the server vendor, or %NULL
+ * @ret_version: (out) (optional) (transfer full): a location to store the server version, or %NULL
+ * @ret_spec_version: (out) (optional) (transfer full): a location to store the version the service is compliant with, or %NULL
+ * @error: The returned error information.
+ *
+ * Queries the notification server of @client for its information, like
+ * [func@get_server_info] does for the default client.
+ *
+ * Returns: %TRUE if successful, and the variables passed will be set,
+ *   %FALSE on error.
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_client_get_server_info (NotifyClient  *client,
+                               char         **ret_name,
+                               char         **ret_vendor,
+                               char         **ret_version,
+                               char         **ret_spec_version,
+                               GError       **error)
+{
+        GDBusProxy *proxy;
+
+        g_return_val_if_fail (NOTIFY_IS_CLIENT (client), FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        if (client->is_default) {
+                return _notify_get_backend ()->get_server_info (ret_name,
+                                                                ret_vendor,
+                                                                ret_version,
+                                                                ret_spec_version,
+                                                                error);
+        }
+
+        proxy = _notify_client_get_proxy (client, error);
+        if (proxy == NULL) {
+                return FALSE;
+        }
+
+        return _notify_proxy_get_server_info (proxy, ret_name, ret_vendor,
+                                              ret_version, ret_spec_version,
+                                              error);
+}
@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <libnotify/notification.h>
+
+G_BEGIN_DECLS
+
+#define NOTIFY_TYPE_CLIENT               (notify_client_get_type ())
+
+G_DECLARE_FINAL_TYPE (NotifyClient, notify_client, NOTIFY, CLIENT, GObject);
+
+/**
+ * NotifyClient:
+ *
+ * A connection to a notification server.
+ *
+ * Each #NotifyClient has its own connection, server capabilities and
+ * specification version, and its own set of notifications, bound to it
+ * with [ctor@Client.new_notification]. A process can so talk to several
+ * notification servers, for instance the ones of the sessions of
+ * different users.
+ *
+ * The global functions such as [func@init] work on the default client,
+ * returned by [func@Client.get_default], and the notifications not bound
+ * to a client belong to it.
+ *
+ * The notifications of the other clients are always sent to a server
+ * implementing the Desktop Notifications specification over D-Bus, and
+ * they aren't subject to the process-wide policies: grouping,
+ * deduplication, offline spooling, live notification quotas and the
+ * circuit breaker only apply to the default client. A client must be used
+ * from a single thread at a time, but different clients can be used from
+ * different threads at once.
+ *
+ * Since: 0.8.8
+ */
+
+NotifyClient       *notify_notification_get_client        (NotifyNotification  *notification);
+
+NotifyClient       *notify_client_new                     (const char          *app_name,
+                                                           GDBusConnection     *connection);
+
+NotifyClient       *notify_client_get_default             (void);
+
+const char         *notify_client_get_app_name            (NotifyClient        *client);
+
+GDBusConnection    *notify_client_get_connection          (NotifyClient        *client,
+                                                           GError             **error);
+
+NotifyNotification *notify_client_new_notification        (NotifyClient        *client,
+                                                           const char          *summary,
+                                                           const char          *body,
+                                                           const char          *icon);
+
+GList              *notify_client_get_server_caps         (NotifyClient        *client);
+
+gboolean            notify_client_get_server_info         (NotifyClient        *client,
+                                                           char               **ret_name,
+                                                           char               **ret_vendor,
+                                                           char               **ret_version,
+                                                           char               **ret_spec_version,
+                                                           GError             **error);
+
+G_END_DECLS
@@ -0,0 +1,304 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+#define DEFAULT_DEDUP_WINDOW 60000
+#define REPEAT_COUNT_HINT "x-libnotify-repeat-count"
+
+/* Number of remembered notifications above which expired ones are pruned */
+#define DEDUP_PRUNE_THRESHOLD 64
+
+typedef struct
+{
+        guint64 hash;
+        gint64  first_shown;
+        guint32 id;
+        guint   repeat_count;
+} DedupEntry;
+
+static GHashTable      *_dedup_entries = NULL;
+static NotifyDedupMode  _dedup_mode = NOTIFY_DEDUP_NONE;
+static guint            _dedup_window = DEFAULT_DEDUP_WINDOW;
+static guint64          _dedup_hits = 0;
+static guint64          _dedup_misses = 0;
+
+static gboolean
+dedup_entry_is_expired (DedupEntry *entry,
+                        gint64      now)
+{
+        return now - entry->first_shown >= (gint64) _dedup_window * G_TIME_SPAN_MILLISECOND;
+}
+
+static void
+dedup_prune (gint64 now)
+{
+        GHashTableIter iter;
+        DedupEntry *entry;
+
+        g_hash_table_iter_init (&iter, _dedup_entries);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+                if (dedup_entry_is_expired (entry, now)) {
+                        g_hash_table_iter_remove (&iter);
+                }
+        }
+}
+
+/*
+ * _notify_dedup_handle_show:
+ * @notification: The notification being shown.
+ * @out_hash: (out): Where to store the content hash of @notification, to
+ *   be passed to _notify_dedup_shown(), or 0 if deduplication is disabled.
+ * @out_repeat_count: (out): Where to store the number of times the same
+ *   content was shown before, when @notification must update the
+ *   notification showing it.
+ *
+ * Looks for a notification with the same content as @notification that
+ * was shown during the deduplication window.
+ *
+ * If there's one, @notification takes its id, so that it updates it
+ * rather than creating a new one.
+ *
+ * Returns: %TRUE if @notification is a duplicate that must not be shown.
+ */
+gboolean
+_notify_dedup_handle_show (NotifyNotification *notification,
+                           guint64            *out_hash,
+                           guint              *out_repeat_count)
+{
+        DedupEntry *entry;
+        guint64 hash;
+        gint64 now;
+
+        *out_hash = 0;
+        *out_repeat_count = 0;
+
+        if (_dedup_mode == NOTIFY_DEDUP_NONE ||
+            _notify_uses_portal_notifications ()) {
+                return FALSE;
+        }
+
+        if (_dedup_entries == NULL) {
+                _dedup_entries = g_hash_table_new_full (g_int64_hash,
+                                                        g_int64_equal,
+                                                        NULL, g_free);
+        }
+
+        hash = _notify_notification_get_content_hash (notification);
+        now = g_get_monotonic_time ();
+        *out_hash = hash;
+
+        entry = g_hash_table_lookup (_dedup_entries, &hash);
+        if (entry != NULL && dedup_entry_is_expired (entry, now)) {
+                g_hash_table_remove (_dedup_entries, &hash);
+                entry = NULL;
+        }
+
+        if (entry == NULL) {
+                _dedup_misses++;
+
+                if (g_hash_table_size (_dedup_entries) >= DEDUP_PRUNE_THRESHOLD) {
+                        dedup_prune (now);
+                }
+
+                entry = g_new0 (DedupEntry, 1);
+                entry->hash = hash;
+                entry->first_shown = now;
+                g_hash_table_insert (_dedup_entries, &entry->hash, entry);
+
+                return FALSE;
+        }
+
+        _dedup_hits++;
+        entry->repeat_count++;
+
+        if (entry->id != 0) {
+                g_object_set (notification, "id", (gint) entry->id, NULL);
+        }
+
+        if (_dedup_mode == NOTIFY_DEDUP_SUPPRESS) {
+                return TRUE;
+        }
+
+        *out_repeat_count = entry->repeat_count;
+
+        return FALSE;
+}
+
+/*
+ * _notify_dedup_shown:
+ * @hash: The content hash returned by _notify_dedup_handle_show().
+ * @id: The id of the shown notification.
+ *
+ * Remembers the id of the notification showing the content with @hash.
+ */
+void
+_notify_dedup_shown (guint64 hash,
+                     guint32 id)
+{
+        DedupEntry *entry;
+
+        if (hash == 0 || _dedup_entries == NULL) {
+                return;
+        }
+
+        entry = g_hash_table_lookup (_dedup_entries, &hash);
+        if (entry != NULL) {
+                entry->id = id;
+        }
+}
+
+/*
+ * _notify_dedup_forget:
+ * @hash: The content hash returned by _notify_dedup_handle_show().
+ *
+ * Forgets the content with @hash when showing it didn't go out, unless a
+ * notification already shows it: the next notification with the same
+ * content is then shown rather than suppressed or left without an id to
+ * update.
+ */
+void
+_notify_dedup_forget (guint64 hash)
+{
+        DedupEntry *entry;
+
+        if (hash == 0 || _dedup_entries == NULL) {
+                return;
+        }
+
+        entry = g_hash_table_lookup (_dedup_entries, &hash);
+        if (entry != NULL && entry->id == 0) {
+                g_hash_table_remove (_dedup_entries, &hash);
+        }
+}
+
+/*
+ * _notify_dedup_add_repeat_hint:
+ * @parameters: (transfer floating): The parameters of a Notify call.
+ * @repeat_count: The number of repetitions of the notification.
+ *
+ * Returns: (transfer floating): @parameters, with the repeat count hint.
+ */
+GVariant *
+_notify_dedup_add_repeat_hint (GVariant *parameters,
+                               guint     repeat_count)
+{
+        const char *app_name, *app_icon, *summary, *body;
+        GVariantBuilder hints_builder;
+        GVariantIter iter;
+        guint32 replaces_id;
+        gint32 timeout;
+        GVariant *actions;
+        GVariant *hints;
+        GVariant *value;
+        GVariant *ret;
+        const char *key;
+
+        g_variant_ref_sink (parameters);
+        g_variant_get (parameters, "(&su&s&s&s@as@a{sv}i)",
+                       &app_name, &replaces_id, &app_icon, &summary, &body,
+                       &actions, &hints, &timeout);
+
+        g_variant_builder_init (&hints_builder, G_VARIANT_TYPE ("a{sv}"));
+        g_variant_iter_init (&iter, hints);
+        while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+                g_variant_builder_add (&hints_builder, "{sv}", key, value);
+        }
+        g_variant_builder_add (&hints_builder, "{sv}", REPEAT_COUNT_HINT,
+                               g_variant_new_int32 (repeat_count));
+
+        ret = g_variant_new ("(susss@asa{sv}i)",
+                             app_name,
+                             replaces_id,
+                             app_icon,
+                             summary,
+                             body,
+                             actions,
+                             &hints_builder,
+                             timeout);
+
+        g_variant_unref (actions);
+        g_variant_unref (hints);
+        g_variant_unref (parameters);
+
+        return ret;
+}
+
+/**
+ * notify_set_deduplication:
+ * @mode: How duplicated notifications are handled.
+ * @window: The deduplication window, in milliseconds, or 0 for the
+ *   default of one minute.
+ *
+ * Sets how notifications shown with [method@Notification.show] having the
+ * same content (summary, body, icon, hints and actions) as a notification
+ * shown less than @window before are handled.
+ *
+ * With %NOTIFY_DEDUP_SUPPRESS they are not shown at all. With
+ * %NOTIFY_DEDUP_UPDATE they update the notification first shown, setting
+ * the `x-libnotify-repeat-count` integer hint to the number of
+ * repetitions. In both cases the duplicate notification takes the id of
+ * the original one.
+ *
+ * The window starts when the content is first shown, so a notification
+ * repeated for longer than @window is shown again once per window.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_deduplication (NotifyDedupMode mode,
+                          guint           window)
+{
+        _dedup_mode = mode;
+        _dedup_window = window > 0 ? window : DEFAULT_DEDUP_WINDOW;
+
+        if (mode == NOTIFY_DEDUP_NONE) {
+                g_clear_pointer (&_dedup_entries, g_hash_table_destroy);
+        }
+}
+
+/**
+ * notify_get_deduplication_stats:
+ * @hits: (out) (optional): Return location for the number of duplicated
+ *   notifications.
+ * @misses: (out) (optional): Return location for the number of
+ *   notifications with a new content.
+ *
+ * Gets the statistics of the deduplication enabled with
+ * [func@set_deduplication].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_get_deduplication_stats (guint64 *hits,
+                                guint64 *misses)
+{
+        if (hits) {
+                *hits = _dedup_hits;
+        }
+
+        if (misses) {
+                *misses = _dedup_misses;
+        }
+}
@@ -0,0 +1,233 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/*
+ * The action callbacks and the closed signal of the notifications are
+ * delivered from the context where the server signals are received, unless
+ * a dispatch target is set: the per-notification context first, then the
+ * global thread pool, then the global context.
+ *
+ * The data of the callbacks is always released from the context that
+ * dispatched them, since dropping the last reference on a notification
+ * changes the state shared by the notifications, that is not protected
+ * against concurrent access.
+ */
+
+typedef struct
+{
+        NotifyDispatchFunc func;
+        gpointer           data;
+        GDestroyNotify     destroy;
+        /* The thread-default context of the dispatcher */
+        GMainContext      *owner;
+} DispatchJob;
+
+static GMainContext *_dispatch_context = NULL;
+static GThreadPool  *_dispatch_pool = NULL;
+
+static void
+dispatch_job_free (DispatchJob *job)
+{
+        if (job->destroy != NULL) {
+                job->destroy (job->data);
+        }
+
+        g_main_context_unref (job->owner);
+        g_free (job);
+}
+
+static gboolean
+dispatch_job_free_source (gpointer user_data)
+{
+        dispatch_job_free (user_data);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * Frees @job from the context that dispatched it. Unlike
+ * g_main_context_invoke(), this never runs it from the calling thread
+ * unless it owns that context.
+ */
+static void
+dispatch_job_release (DispatchJob *job)
+{
+        GSource *source;
+
+        if (g_main_context_is_owner (job->owner)) {
+                dispatch_job_free (job);
+                return;
+        }
+
+        source = g_idle_source_new ();
+        g_source_set_priority (source, G_PRIORITY_DEFAULT);
+        g_source_set_callback (source, dispatch_job_free_source, job, NULL);
+        g_source_attach (source, job->owner);
+        g_source_unref (source);
+}
+
+static gboolean
+dispatch_job_run (gpointer user_data)
+{
+        DispatchJob *job = user_data;
+
+        job->func (job->data);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+dispatch_job_run_in_pool (gpointer data,
+                          gpointer user_data)
+{
+        DispatchJob *job = data;
+
+        dispatch_job_run (job);
+        dispatch_job_release (job);
+}
+
+/*
+ * _notify_dispatch:
+ * @context: (nullable): The dispatch context of the notification, if any.
+ * @func: The function to run.
+ * @data: Data to pass to @func, holding its own references.
+ * @destroy: (nullable): Destroy notifier for @data.
+ *
+ * Runs @func on the dispatch target, or right away if there's none.
+ */
+void
+_notify_dispatch (GMainContext       *context,
+                  NotifyDispatchFunc  func,
+                  gpointer            data,
+                  GDestroyNotify      destroy)
+{
+        DispatchJob *job;
+
+        job = g_new0 (DispatchJob, 1);
+        job->func = func;
+        job->data = data;
+        job->destroy = destroy;
+        job->owner = g_main_context_ref_thread_default ();
+
+        if (context == NULL && _dispatch_pool != NULL) {
+                GError *error = NULL;
+
+                if (g_thread_pool_push (_dispatch_pool, job, &error)) {
+                        return;
+                }
+
+                g_debug ("Failed to dispatch to the thread pool: %s",
+                         error->message);
+                g_error_free (error);
+        }
+
+        if (context == NULL) {
+                context = _dispatch_context;
+        }
+
+        if (context == NULL) {
+                dispatch_job_run (job);
+                dispatch_job_free (job);
+                return;
+        }
+
+        /* Runs right away if @context is owned by this thread */
+        g_main_context_invoke_full (context,
+                                    G_PRIORITY_DEFAULT,
+                                    dispatch_job_run,
+                                    job,
+                                    (GDestroyNotify) dispatch_job_release);
+}
+
+/**
+ * notify_set_dispatch_context:
+ * @context: (nullable): The context to dispatch to, or %NULL.
+ *
+ * Sets the [struct@GLib.MainContext] where the action callbacks and the
+ * [signal@Notification::closed] signal of all the notifications are
+ * delivered, unless they have their own context set with
+ * [method@Notification.set_dispatch_context] or a thread pool is set with
+ * [func@set_dispatch_thread_pool].
+ *
+ * By default, or if @context is %NULL, they are delivered from the context
+ * where the signals of the notification server are received, that is the
+ * thread-default context when libnotify was initialized.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_dispatch_context (GMainContext *context)
+{
+        if (context != NULL) {
+                g_main_context_ref (context);
+        }
+
+        g_clear_pointer (&_dispatch_context, g_main_context_unref);
+        _dispatch_context = context;
+}
+
+/**
+ * notify_set_dispatch_thread_pool:
+ * @max_threads: The maximum number of threads, -1 for no limit, or 0 to
+ *   stop using a thread pool.
+ *
+ * Makes the action callbacks and the [signal@Notification::closed] signal
+ * of the notifications without their own dispatch context be delivered
+ * from a pool of up to @max_threads threads, so that slow action handlers
+ * don't block the main loop and run concurrently.
+ *
+ * The notification is kept alive while its callbacks run, but it's
+ * otherwise not thread-safe: the handlers must not change it, and must
+ * not call [method@Notification.get_activation_token] or
+ * [method@Notification.get_activation_app_launch_context] from any other
+ * thread. The callbacks of a notification may run concurrently, and in a
+ * different order than the events were received.
+ *
+ * Stopping the thread pool waits for the pending callbacks to complete.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_dispatch_thread_pool (gint max_threads)
+{
+        g_return_if_fail (max_threads >= -1);
+
+        if (max_threads == 0) {
+                if (_dispatch_pool != NULL) {
+                        g_thread_pool_free (g_steal_pointer (&_dispatch_pool),
+                                            FALSE, TRUE);
+                }
+                return;
+        }
+
+        if (_dispatch_pool != NULL) {
+                g_thread_pool_set_max_threads (_dispatch_pool, max_threads, NULL);
+                return;
+        }
+
+        _dispatch_pool = g_thread_pool_new (dispatch_job_run_in_pool, NULL,
+                                            max_threads, FALSE, NULL);
+}
@@ -0,0 +1,320 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#include <glib-unix.h>
+#endif
+
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+struct _NotifyEventChannel
+{
+        GObject         parent_instance;
+
+        GAsyncQueue    *queue;
+
+        /* Both ends are the same eventfd, if available */
+        int             read_fd;
+        int             write_fd;
+};
+
+G_DEFINE_TYPE (NotifyEventChannel, notify_event_channel, G_TYPE_OBJECT)
+
+G_LOCK_DEFINE_STATIC (default_channel);
+static GWeakRef _default_channel;
+
+static void
+notify_event_free (NotifyEvent *event)
+{
+        notify_event_clear (event);
+        g_free (event);
+}
+
+static void
+notify_event_channel_finalize (GObject *object)
+{
+        NotifyEventChannel *channel = NOTIFY_EVENT_CHANNEL (object);
+
+        g_async_queue_unref (channel->queue);
+
+        if (channel->write_fd != channel->read_fd) {
+                close (channel->write_fd);
+        }
+        close (channel->read_fd);
+
+        G_OBJECT_CLASS (notify_event_channel_parent_class)->finalize (object);
+}
+
+static void
+notify_event_channel_class_init (NotifyEventChannelClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = notify_event_channel_finalize;
+}
+
+static void
+notify_event_channel_init (NotifyEventChannel *channel)
+{
+        channel->queue = g_async_queue_new_full ((GDestroyNotify) notify_event_free);
+
+#ifdef HAVE_SYS_EVENTFD_H
+        channel->read_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+        channel->write_fd = channel->read_fd;
+#else
+        {
+                int fds[2];
+
+                g_unix_open_pipe (fds, FD_CLOEXEC, NULL);
+                g_unix_set_fd_nonblocking (fds[0], TRUE, NULL);
+                g_unix_set_fd_nonblocking (fds[1], TRUE, NULL);
+                channel->read_fd = fds[0];
+                channel->write_fd = fds[1];
+        }
+#endif
+}
+
+/* Makes the file descriptor readable, if it isn't already */
+static void
+channel_signal (NotifyEventChannel *channel)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+        guint64 value = 1;
+#else
+        guchar value = 1;
+#endif
+        ssize_t written;
+
+        do {
+                written = write (channel->write_fd, &value, sizeof (value));
+        } while (written < 0 && errno == EINTR);
+}
+
+static void
+channel_acknowledge (NotifyEventChannel *channel)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+        guint64 value;
+#else
+        guchar value[64];
+#endif
+        ssize_t n_read;
+
+        do {
+                n_read = read (channel->read_fd, &value, sizeof (value));
+        } while (n_read > 0 || (n_read < 0 && errno == EINTR));
+}
+
+/*
+ * _notify_event_channel_is_active:
+ *
+ * Returns: %TRUE if the events of the notifications are reported to an
+ *   event channel.
+ */
+gboolean
+_notify_event_channel_is_active (void)
+{
+        NotifyEventChannel *channel = g_weak_ref_get (&_default_channel);
+
+        if (channel == NULL) {
+                return FALSE;
+        }
+
+        g_object_unref (channel);
+
+        return TRUE;
+}
+
+/*
+ * _notify_event_channel_push:
+ * @type: The type of the event.
+ * @notification: The notification of the event.
+ * @id: The id of @notification when the event occurred.
+ * @closed_reason: The reason why @notification was closed, if it was.
+ * @data: (nullable): The action or activation token of the event.
+ *
+ * Reports an event to the event channel, if any.
+ */
+void
+_notify_event_channel_push (NotifyEventType     type,
+                            NotifyNotification *notification,
+                            guint32             id,
+                            NotifyClosedReason  closed_reason,
+                            const char         *data)
+{
+        NotifyEventChannel *channel = g_weak_ref_get (&_default_channel);
+        NotifyEvent *event;
+
+        if (channel == NULL) {
+                return;
+        }
+
+        event = g_new0 (NotifyEvent, 1);
+        event->type = type;
+        event->id = id;
+        event->notification = g_object_ref (notification);
+        event->closed_reason = closed_reason;
+        event->data = g_strdup (data);
+
+        g_async_queue_push (channel->queue, event);
+        channel_signal (channel);
+
+        g_object_unref (channel);
+}
+
+/**
+ * notify_event_channel_get_default:
+ *
+ * Gets the event channel of the process, creating it if needed.
+ *
+ * The events of the notifications are reported as long as a reference on
+ * the channel is held, from the next time the notifications are shown.
+ * Notifications shown while the channel exists are always told about the
+ * server signals, even without handlers connected.
+ *
+ * Returns: (transfer full): The event channel.
+ *
+ * Since: 0.8.8
+ */
+NotifyEventChannel *
+notify_event_channel_get_default (void)
+{
+        NotifyEventChannel *channel;
+
+        G_LOCK (default_channel);
+
+        channel = g_weak_ref_get (&_default_channel);
+        if (channel == NULL) {
+                channel = g_object_new (NOTIFY_TYPE_EVENT_CHANNEL, NULL);
+                g_weak_ref_set (&_default_channel, channel);
+        }
+
+        G_UNLOCK (default_channel);
+
+        return channel;
+}
+
+/**
+ * notify_event_channel_get_fd:
+ * @channel: The event channel.
+ *
+ * Gets a file descriptor that is readable while events are pending, to be
+ * polled for instance with g_unix_fd_add() or epoll.
+ *
+ * The file descriptor is owned by @channel and must not be read from.
+ *
+ * Returns: The file descriptor.
+ *
+ * Since: 0.8.8
+ */
+int
+notify_event_channel_get_fd (NotifyEventChannel *channel)
+{
+        g_return_val_if_fail (NOTIFY_IS_EVENT_CHANNEL (channel), -1);
+
+        return channel->read_fd;
+}
+
+/**
+ * notify_event_channel_drain:
+ * @channel: The event channel.
+ * @events: (out caller-allocates) (array length=n_events): The array to fill
+ *   with the events.
+ * @n_events: The length of @events.
+ *
+ * Takes up to @n_events pending events, from the oldest one. Each filled
+ * event must be released with [func@event_clear].
+ *
+ * This function can be called from any thread, but the notifications are
+ * not thread-safe: when it's not called from the thread showing them,
+ * only the id and data of the events should be used, and the thread
+ * showing the notifications must keep a reference on them, so that
+ * releasing an event doesn't finalize its notification.
+ *
+ * The file descriptor stays readable if events are left pending.
+ *
+ * Returns: The number of events filled.
+ *
+ * Since: 0.8.8
+ */
+guint
+notify_event_channel_drain (NotifyEventChannel *channel,
+                            NotifyEvent        *events,
+                            guint               n_events)
+{
+        gboolean pending;
+        guint n_drained;
+
+        g_return_val_if_fail (NOTIFY_IS_EVENT_CHANNEL (channel), 0);
+        g_return_val_if_fail (events != NULL || n_events == 0, 0);
+
+        /* Events pushed from now on will signal again */
+        channel_acknowledge (channel);
+
+        g_async_queue_lock (channel->queue);
+
+        for (n_drained = 0; n_drained < n_events; ++n_drained) {
+                NotifyEvent *event = g_async_queue_try_pop_unlocked (channel->queue);
+
+                if (event == NULL) {
+                        break;
+                }
+
+                events[n_drained] = *event;
+                g_free (event);
+        }
+
+        pending = g_async_queue_length_unlocked (channel->queue) > 0;
+
+        g_async_queue_unlock (channel->queue);
+
+        if (pending) {
+                channel_signal (channel);
+        }
+
+        return n_drained;
+}
+
+/**
+ * notify_event_clear:
+ * @event: The event.
+ *
+ * Releases the resources of an event filled by
+ * [method@EventChannel.drain].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_event_clear (NotifyEvent *event)
+{
+        g_return_if_fail (event != NULL);
+
+        g_clear_object (&event->notification);
+        g_clear_pointer (&event->data, g_free);
+}
@@ -0,0 +1,97 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <libnotify/notification.h>
+
+G_BEGIN_DECLS
+
+#define NOTIFY_TYPE_EVENT_CHANNEL        (notify_event_channel_get_type ())
+
+G_DECLARE_FINAL_TYPE (NotifyEventChannel, notify_event_channel, NOTIFY, EVENT_CHANNEL, GObject);
+
+/**
+ * NotifyEventChannel:
+ *
+ * A queue of the events of all the notifications of the process.
+ *
+ * #NotifyEventChannel reports the closing, action invocations and
+ * activation tokens of the notifications as [struct@Event] structures,
+ * without connecting to the signals of each notification. The events can
+ * be drained in batches from any thread, when the file descriptor
+ * returned by [method@EventChannel.get_fd] is readable.
+ *
+ * Since: 0.8.8
+ */
+
+/**
+ * NotifyEventType:
+ * @NOTIFY_EVENT_CLOSED: The notification was closed.
+ * @NOTIFY_EVENT_ACTION_INVOKED: An action of the notification was invoked.
+ * @NOTIFY_EVENT_ACTIVATION_TOKEN: The server sent the activation token of
+ *   the next action invocation.
+ *
+ * The type of a [struct@Event].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_EVENT_CLOSED,
+        NOTIFY_EVENT_ACTION_INVOKED,
+        NOTIFY_EVENT_ACTIVATION_TOKEN,
+} NotifyEventType;
+
+/**
+ * NotifyEvent:
+ * @type: The type of the event.
+ * @id: The id of the notification when the event occurred.
+ * @notification: The notification.
+ * @closed_reason: The reason why the notification was closed, for
+ *   %NOTIFY_EVENT_CLOSED events.
+ * @data: The action for %NOTIFY_EVENT_ACTION_INVOKED events, or the
+ *   activation token for %NOTIFY_EVENT_ACTIVATION_TOKEN events.
+ *
+ * An event of a notification, filled by [method@EventChannel.drain] and
+ * released with [func@event_clear].
+ *
+ * Since: 0.8.8
+ */
+typedef struct
+{
+        NotifyEventType     type;
+        guint32             id;
+        NotifyNotification *notification;
+        NotifyClosedReason  closed_reason;
+        char               *data;
+} NotifyEvent;
+
+NotifyEventChannel *notify_event_channel_get_default      (void);
+
+int                 notify_event_channel_get_fd           (NotifyEventChannel  *channel);
+
+guint               notify_event_channel_drain            (NotifyEventChannel  *channel,
+                                                           NotifyEvent         *events,
+                                                           guint                n_events);
+
+void                notify_event_clear                    (NotifyEvent         *event);
+
+G_END_DECLS
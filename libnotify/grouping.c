@@ -0,0 +1,319 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+#define DEFAULT_GROUP_WINDOW 5000
+
+typedef struct
+{
+        char               *key;
+        /* The notification currently shown for the group */
+        NotifyNotification *leader;
+        /* The latest notification received during the window, if any */
+        NotifyNotification *latest;
+        guint               count;
+        guint               timeout_id;
+} NotifyGroup;
+
+static GHashTable    *_groups = NULL;
+static NotifyGroupBy  _group_by = NOTIFY_GROUP_BY_NONE;
+static guint          _group_window = DEFAULT_GROUP_WINDOW;
+
+static void
+notify_group_free (NotifyGroup *group)
+{
+        g_clear_handle_id (&group->timeout_id, g_source_remove);
+        g_clear_object (&group->leader);
+        g_clear_object (&group->latest);
+        g_free (group->key);
+        g_free (group);
+}
+
+static GVariant *
+build_digest_parameters (GVariant *parameters,
+                         guint     count)
+{
+        const char *app_name, *app_icon, *summary, *body;
+        guint32 replaces_id;
+        gint32 timeout;
+        GVariant *actions;
+        GVariant *hints;
+        GVariant *ret;
+        char *digest_summary;
+
+        g_variant_get (parameters, "(&su&s&s&s@as@a{sv}i)",
+                       &app_name, &replaces_id, &app_icon, &summary, &body,
+                       &actions, &hints, &timeout);
+
+        digest_summary = g_strdup_printf ("%s (%u)", summary, count);
+
+        ret = g_variant_new ("(susss@as@a{sv}i)",
+                             app_name,
+                             replaces_id,
+                             app_icon,
+                             digest_summary,
+                             body,
+                             actions,
+                             hints,
+                             timeout);
+
+        g_free (digest_summary);
+        g_variant_unref (actions);
+        g_variant_unref (hints);
+
+        return ret;
+}
+
+static void
+on_digest_shown (GObject      *source,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+        NotifyNotification *notification = user_data;
+        GError *error = NULL;
+        GVariant *result;
+
+        result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+
+        if (!_notify_notification_finish_show (notification, result,
+                                               error ? NULL : &error)) {
+                g_debug ("Failed to show the notifications digest: %s",
+                         error ? error->message : "unknown error");
+        }
+
+        g_clear_error (&error);
+        g_clear_pointer (&result, g_variant_unref);
+        g_object_unref (notification);
+}
+
+/*
+ * Shows the latest notification of @group in place of the current one,
+ * with the number of notifications of the group in its summary.
+ */
+static void
+notify_group_show_digest (NotifyGroup *group,
+                          gboolean     wait_reply)
+{
+        NotifyNotification *latest;
+        GDBusProxy *proxy;
+        GVariant *parameters;
+        GVariant *digest;
+        GError *error = NULL;
+        const char *method;
+        gint id;
+
+        latest = g_steal_pointer (&group->latest);
+
+        proxy = _notify_get_proxy (&error);
+        if (proxy == NULL) {
+                g_debug ("Failed to show the notifications digest: %s",
+                         error->message);
+                g_error_free (error);
+                g_object_unref (latest);
+                return;
+        }
+
+        g_object_get (group->leader, "id", &id, NULL);
+        g_object_set (latest, "id", id, NULL);
+        g_set_object (&group->leader, latest);
+
+        parameters = _notify_notification_prepare_show (latest, proxy,
+                                                        &method, &error);
+        if (parameters == NULL) {
+                g_debug ("Failed to show the notifications digest: %s",
+                         error->message);
+                g_error_free (error);
+                g_object_unref (latest);
+                return;
+        }
+
+        g_variant_ref_sink (parameters);
+        digest = build_digest_parameters (parameters, group->count);
+        g_variant_unref (parameters);
+
+        if (_notify_spool_should_queue (proxy)) {
+                _notify_spool_push (proxy, latest, digest);
+                g_object_unref (latest);
+        } else if (wait_reply) {
+                g_dbus_proxy_call (proxy,
+                                   method,
+                                   digest,
+                                   _notify_get_call_flags (),
+                                   -1,
+                                   NULL,
+                                   on_digest_shown,
+                                   latest);
+        } else {
+                if (!_notify_send_message_no_reply (proxy, method, digest, &error)) {
+                        g_debug ("Failed to show the notifications digest: %s",
+                                 error->message);
+                        g_error_free (error);
+                }
+                g_object_unref (latest);
+        }
+}
+
+static gboolean
+on_group_window_elapsed (gpointer user_data)
+{
+        NotifyGroup *group = user_data;
+
+        if (group->latest == NULL) {
+                /* Nothing happened during the last window, so the next
+                 * notification will be shown right away */
+                group->timeout_id = 0;
+                g_hash_table_remove (_groups, group->key);
+                return G_SOURCE_REMOVE;
+        }
+
+        notify_group_show_digest (group, TRUE);
+
+        return G_SOURCE_CONTINUE;
+}
+
+/*
+ * _notify_grouping_handle_show:
+ * @notification: The notification being shown.
+ *
+ * Adds @notification to its group, if grouping is enabled.
+ *
+ * The first notification of a group is shown right away, the following
+ * ones received within the grouping window are only accounted, and at the
+ * end of the window the latest one is shown in place of the first one,
+ * as a digest of the group.
+ *
+ * Returns: %TRUE if @notification was added to an existing group, and
+ *   thus must not be shown now.
+ */
+gboolean
+_notify_grouping_handle_show (NotifyNotification *notification)
+{
+        NotifyGroup *group;
+        const char *key;
+
+        if (_group_by == NOTIFY_GROUP_BY_NONE ||
+            _notify_uses_portal_notifications ()) {
+                return FALSE;
+        }
+
+        if (_notify_notification_get_urgency (notification) == NOTIFY_URGENCY_CRITICAL) {
+                return FALSE;
+        }
+
+        key = _notify_notification_get_group_key (notification, _group_by);
+        if (key == NULL) {
+                return FALSE;
+        }
+
+        if (_groups == NULL) {
+                _groups = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                 (GDestroyNotify) notify_group_free);
+        }
+
+        group = g_hash_table_lookup (_groups, key);
+        if (group == NULL) {
+                group = g_new0 (NotifyGroup, 1);
+                group->key = g_strdup (key);
+                group->leader = g_object_ref (notification);
+                group->count = 1;
+                group->timeout_id = g_timeout_add (_group_window,
+                                                   on_group_window_elapsed,
+                                                   group);
+                g_hash_table_insert (_groups, group->key, group);
+
+                return FALSE;
+        }
+
+        /* Updates of the shown notification are not grouped */
+        if (notification == group->leader) {
+                return FALSE;
+        }
+
+        group->count++;
+        g_set_object (&group->latest, notification);
+
+        return TRUE;
+}
+
+/*
+ * _notify_grouping_flush:
+ *
+ * Shows the digests of all the groups that have pending notifications,
+ * and forgets all the groups.
+ */
+void
+_notify_grouping_flush (void)
+{
+        GHashTableIter iter;
+        NotifyGroup *group;
+
+        if (_groups == NULL) {
+                return;
+        }
+
+        g_hash_table_iter_init (&iter, _groups);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &group)) {
+                if (group->latest != NULL) {
+                        notify_group_show_digest (group, FALSE);
+                }
+        }
+
+        g_clear_pointer (&_groups, g_hash_table_destroy);
+}
+
+/**
+ * notify_set_grouping:
+ * @group_by: How notifications are grouped.
+ * @window: The grouping window, in milliseconds, or 0 for the default.
+ *
+ * Sets how the notifications shown with [method@Notification.show] are
+ * grouped, in order to avoid flooding the user and the notification
+ * server during bursts.
+ *
+ * The first notification of a group is shown right away. The following
+ * ones, until no notification of the group is shown for @window, are not
+ * shown individually: instead, at the end of each window, the latest one
+ * replaces the notification shown for the group, with the number of
+ * notifications of the group appended to its summary.
+ *
+ * Notifications with critical urgency are never grouped. A notification
+ * with a key set with [method@Notification.set_group_key] is grouped by
+ * that key, unless grouping is disabled with %NOTIFY_GROUP_BY_NONE.
+ *
+ * Grouping requires a running main loop.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_grouping (NotifyGroupBy group_by,
+                     guint         window)
+{
+        if (group_by == NOTIFY_GROUP_BY_NONE) {
+                _notify_grouping_flush ();
+        }
+
+        _group_by = group_by;
+        _group_window = window > 0 ? window : DEFAULT_GROUP_WINDOW;
+}
@@ -32,13 +32,82 @@
 
 G_BEGIN_DECLS
 
+typedef struct _NotifyActionSet NotifyActionSet;
+typedef struct _NotifyRoutes NotifyRoutes;
+
+typedef struct
+{
+        const char *name;
+        gboolean    uses_dbus;
+
+        gboolean (*show)            (NotifyNotification  *n,
+                                     GError             **error);
+        gboolean (*close)           (NotifyNotification  *n,
+                                     GError             **error);
+        GList  * (*get_server_caps) (void);
+        gboolean (*get_server_info) (char               **ret_name,
+                                     char               **ret_vendor,
+                                     char               **ret_version,
+                                     char               **ret_spec_version,
+                                     GError             **error);
+} NotifyBackend;
+
 GDBusProxy      * _notify_get_proxy                         (GError **error);
+GDBusProxy      * _notify_proxy_new                         (GDBusConnection  *connection,
+                                                             GError          **error);
+gboolean        _notify_proxy_get_server_info               (GDBusProxy  *proxy,
+                                                             char       **ret_name,
+                                                             char       **ret_vendor,
+                                                             char       **ret_version,
+                                                             char       **ret_spec_version,
+                                                             GError     **error);
+char           ** _notify_proxy_get_server_caps             (GDBusProxy  *proxy,
+                                                             GError     **error);
 
 void            _notify_cache_add_notification              (NotifyNotification       *n);
 void            _notify_cache_remove_notification           (NotifyNotification       *n);
 gint            _notify_notification_get_timeout            (const NotifyNotification *n);
 gboolean        _notify_notification_has_nondefault_actions (const NotifyNotification *n);
+gboolean        _notify_has_spec_version                    (void);
 gboolean        _notify_check_spec_version                  (int major, int minor);
+void            _notify_parse_spec_version                  (const char *spec_version,
+                                                             int        *major,
+                                                             int        *minor);
+gboolean        _notify_spec_version_is_at_least            (int server_major,
+                                                             int server_minor,
+                                                             int major,
+                                                             int minor);
+const char     * _notify_get_hint_name                      (NotifyClient *client,
+                                                             const char   *hint);
+
+GVariant       * _notify_notification_get_notify_parameters (NotifyNotification  *n);
+GVariant       * _notify_translate_notify_parameters        (GVariant            *parameters);
+gboolean        _notify_send_message_no_reply               (GDBusProxy          *proxy,
+                                                             const char          *method,
+                                                             GVariant            *parameters,
+                                                             GError             **error);
+gboolean        _notify_notification_begin_show             (NotifyNotification  *n,
+                                                             GDBusProxy          *proxy,
+                                                             GVariant           **out_parameters,
+                                                             const char         **out_method,
+                                                             guint64             *out_content_hash,
+                                                             GError             **error);
+gboolean        _notify_notification_end_show               (NotifyNotification  *n,
+                                                             GVariant            *result,
+                                                             guint64              content_hash,
+                                                             GError             **error);
+GVariant       * _notify_notification_prepare_show          (NotifyNotification  *n,
+                                                             GDBusProxy          *proxy,
+                                                             const char         **out_method,
+                                                             GError             **error);
+gboolean        _notify_notification_finish_show            (NotifyNotification  *n,
+                                                             GVariant            *result,
+                                                             GError             **error);
+GVariant       * _notify_notification_prepare_close         (NotifyNotification  *n,
+                                                             GDBusProxy          *proxy,
+                                                             const char         **out_method);
+gboolean        _notify_notification_finish_close           (NotifyNotification  *n,
+                                                             GVariant            *result);
 
 const char     * _notify_get_snap_name                      (void);
 const char     * _notify_get_snap_path                      (void);
@@ -47,6 +116,147 @@ const char     * _notify_get_snap_app                       (void);
 const char     * _notify_get_flatpak_app                    (void);
 
 gboolean        _notify_uses_portal_notifications           (void);
+guint           _notify_get_name_owner_serial               (void);
+gboolean        _notify_is_refreshing_server_info           (void);
+void            _notify_wait_server_info                    (void);
+
+NotifyBackendType _notify_get_backend_type                 (void);
+const NotifyBackend * _notify_get_backend                   (void);
+const NotifyBackend * _notify_notification_get_backend      (NotifyNotification  *n);
+void            _notify_backend_clear                       (void);
+gboolean        _notify_dbus_show                           (NotifyNotification  *n,
+                                                             GError             **error);
+gboolean        _notify_dbus_close                          (NotifyNotification  *n,
+                                                             GError             **error);
+GList          * _notify_dbus_get_server_caps               (void);
+gboolean        _notify_dbus_get_server_info                (char               **ret_name,
+                                                             char               **ret_vendor,
+                                                             char               **ret_version,
+                                                             char               **ret_spec_version,
+                                                             GError             **error);
+void            _notify_notification_local_show             (NotifyNotification  *n);
+void            _notify_notification_local_close            (NotifyNotification  *n);
+void            _notify_notification_request_show           (NotifyNotification  *n);
+
+gboolean        _notify_get_auto_start                      (void);
+GDBusCallFlags  _notify_get_call_flags                      (void);
+GDBusMessageFlags _notify_get_message_flags                 (void);
+gboolean        _notify_breaker_is_open                     (void);
+gboolean        _notify_breaker_is_blocking                 (void);
+void            _notify_breaker_release                     (void);
+void            _notify_breaker_set_error                   (GError             **error);
+gboolean        _notify_breaker_should_fall_back            (const GError        *error);
+void            _notify_breaker_record                      (gint64               start_time,
+                                                             const GError        *error);
+gboolean        _notify_breaker_fallback                    (NotifyNotification  *n,
+                                                             GError             **error);
+
+void            _notify_stats_count                         (NotifyCounter        counter,
+                                                             guint64              value);
+void            _notify_stats_record_call                   (const char          *method,
+                                                             gint64               start_time,
+                                                             const GError        *error);
+void            _notify_stats_record_interval               (NotifyInterval       interval,
+                                                             gint64               duration);
+void            _notify_stats_dump                          (void);
+
+gboolean        _notify_spool_is_enabled                    (void);
+gboolean        _notify_spool_should_queue                  (GDBusProxy          *proxy);
+void            _notify_spool_push                          (GDBusProxy          *proxy,
+                                                             NotifyNotification  *n,
+                                                             GVariant            *parameters);
+gboolean        _notify_spool_remove                        (NotifyNotification  *n);
+void            _notify_spool_replay                        (GDBusProxy          *proxy);
+void            _notify_spool_clear                         (void);
+
+void            _notify_outbox_flush_once                   (GDBusProxy          *proxy);
+
+const char     * _notify_notification_get_group_key         (NotifyNotification  *n,
+                                                             NotifyGroupBy        group_by);
+NotifyUrgency   _notify_notification_get_urgency            (NotifyNotification  *n);
+const char     * _notify_notification_get_category          (NotifyNotification  *n);
+gboolean        _notify_notification_is_persistent          (NotifyNotification  *n);
+guint64         _notify_notification_get_content_hash       (NotifyNotification  *n);
+gboolean        _notify_grouping_handle_show                (NotifyNotification  *n);
+void            _notify_grouping_flush                      (void);
+
+gboolean        _notify_dedup_handle_show                   (NotifyNotification  *n,
+                                                             guint64             *out_hash,
+                                                             guint               *out_repeat_count);
+void            _notify_dedup_shown                         (guint64              hash,
+                                                             guint32              id);
+void            _notify_dedup_forget                        (guint64              hash);
+GVariant       * _notify_dedup_add_repeat_hint              (GVariant            *parameters,
+                                                             guint                repeat_count);
+
+void            _notify_scheduler_clear                     (void);
+void            _notify_scheduler_resume                    (void);
+
+GHashTable     * _notify_hints_set                          (GHashTable          *hints,
+                                                             const char          *key,
+                                                             GVariant            *value);
+GHashTable     * _notify_hints_copy                         (GHashTable          *hints);
+NotifyActionSet * _notify_action_set_add                    (NotifyActionSet     *set,
+                                                             const char          *id,
+                                                             const char          *label,
+                                                             NotifyActionCallback callback,
+                                                             gpointer             user_data,
+                                                             GFreeFunc            free_func);
+NotifyActionSet * _notify_action_set_copy                   (NotifyActionSet     *set);
+NotifyActionSet * _notify_action_set_ref                    (NotifyActionSet     *set);
+void            _notify_action_set_unref                    (NotifyActionSet     *set);
+void            _notify_notification_apply_template         (NotifyNotification  *n,
+                                                             const char          *summary,
+                                                             const char          *body,
+                                                             const char          *icon_name,
+                                                             char                *app_name,
+                                                             char                *app_icon,
+                                                             gint                 timeout,
+                                                             GHashTable          *hints,
+                                                             NotifyActionSet     *actions);
+NotifyNotification * _notify_notification_copy              (NotifyNotification  *n,
+                                                             NotifyClient        *client);
+
+gboolean        _notify_quota_is_active                     (void);
+void            _notify_quota_track                         (NotifyNotification  *n);
+void            _notify_quota_untrack                       (NotifyNotification  *n);
+GList          * _notify_quota_steal                        (void);
+
+gboolean        _notify_event_channel_is_active             (void);
+void            _notify_event_channel_push                  (NotifyEventType      type,
+                                                             NotifyNotification  *n,
+                                                             guint32              id,
+                                                             NotifyClosedReason   closed_reason,
+                                                             const char          *data);
+
+gboolean        _notify_client_is_default                   (NotifyClient        *client);
+GDBusProxy     * _notify_client_get_proxy                   (NotifyClient        *client,
+                                                             GError             **error);
+guint           _notify_client_get_name_owner_serial        (NotifyClient        *client);
+gboolean        _notify_client_has_spec_version             (NotifyClient        *client);
+gboolean        _notify_client_check_spec_version           (NotifyClient        *client,
+                                                             int                  major,
+                                                             int                  minor);
+const char     * _notify_client_get_app_name                (NotifyClient        *client);
+const char     * _notify_client_get_app_icon                (NotifyClient        *client);
+gboolean        _notify_client_uses_portal                  (NotifyClient        *client);
+NotifyRoutes   * _notify_client_get_routes                  (NotifyClient        *client);
+void            _notify_client_add_notification             (NotifyClient        *client,
+                                                             NotifyNotification  *n);
+void            _notify_client_remove_notification          (NotifyClient        *client,
+                                                             NotifyNotification  *n);
+NotifyClient   * _notify_notification_get_client            (NotifyNotification  *n);
+GDBusProxy     * _notify_notification_get_proxy             (NotifyNotification  *n,
+                                                             GError             **error);
+NotifyRoutes   * _notify_routes_new                         (void);
+void            _notify_routes_free                         (NotifyRoutes        *routes);
+
+typedef void (*NotifyDispatchFunc) (gpointer user_data);
+
+void            _notify_dispatch                            (GMainContext        *context,
+                                                             NotifyDispatchFunc   func,
+                                                             gpointer             data,
+                                                             GDestroyNotify       destroy);
 
 G_END_DECLS
 
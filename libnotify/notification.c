@@ -23,6 +23,9 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <gio/gio.h>
 
 #ifdef HAVE_GIO_DESKTOP_APP_INFO
@@ -32,6 +35,7 @@
 #include "notify.h"
 #include "internal.h"
 #include "launch-context.h"
+#include "trace.h"
 
 #if !defined(G_PARAM_STATIC_NAME) && !defined(G_PARAM_STATIC_NICK) && \
     !defined(G_PARAM_STATIC_BLURB)
@@ -60,6 +64,10 @@ static void     notify_notification_class_init (NotifyNotificationClass *klass);
 static void     notify_notification_init       (NotifyNotification *sp);
 static void     notify_notification_finalize   (GObject            *object);
 static void     notify_notification_dispose    (GObject            *object);
+static void     set_id                         (NotifyNotification *notification,
+                                                guint32             id);
+static void     stop_routing                   (NotifyNotification *notification);
+static void     route_remove                   (NotifyNotification *notification);
 
 typedef struct
 {
@@ -71,19 +79,65 @@ typedef struct
         gpointer             user_data;
 } ActionInfo;
 
+typedef struct
+{
+        NotifyNotification *notification;
+        ActionInfo         *action_info;
+        char               *action;
+        char               *activation_token;
+} ActionActivation;
+
+/* The activation whose callback runs in this thread, if any */
+static GPrivate _current_activation = G_PRIVATE_INIT (NULL);
+
+/* The notifications the signals of a server are routed to, by id */
+struct _NotifyRoutes
+{
+        GHashTable *table;
+        GDBusProxy *proxy;
+        gulong      handler;
+};
+
+/* The routes of the default client */
+static NotifyRoutes _default_routes = { NULL, NULL, 0 };
+
 typedef struct _NotifyNotificationPrivate
 {
-        guint32         id;
-        char           *app_name;
-        char           *app_icon;
+        /*
+         * The summary, body and icon name are usually set together, so
+         * they share the single allocation of text_block.
+         */
+        char           *text_block;
         char           *summary;
         char           *body;
-        char           *activation_token;
 
         /* NULL to use icon data. Anything else to have server lookup icon */
         char           *icon_name;
         GdkPixbuf      *icon_pixbuf;
 
+        char           *app_name;
+        char           *app_icon;
+        char           *activation_token;
+        char           *group_key;
+
+        /* Allocated on demand, and possibly shared */
+        NotifyActionSet *actions;
+        GHashTable     *hints;
+
+        /* Where the action callbacks and closed signal are delivered */
+        GMainContext   *dispatch_context;
+
+        /* The client the notification is bound to, or NULL for the default */
+        NotifyClient   *client;
+
+        /* Fingerprint of the content last sent to the server, or 0 */
+        guint64         sent_fingerprint;
+
+        /* Monotonic times of the lifecycle steps, or 0 */
+        gint64          timestamps[NOTIFY_TIMESTAMP_CLOSED + 1];
+
+        guint32         id;
+
         /*
          * -1   = use server default
          *  0   = never timeout
@@ -91,16 +145,15 @@ typedef struct _NotifyNotificationPrivate
          */
         gint            timeout;
         guint           portal_timeout_id;
+        gint            closed_reason;
 
-        GPtrArray      *actions;
-        GHashTable     *hints;
-
-        gboolean        has_nondefault_actions;
-        gboolean        activating;
-
-        gulong          proxy_signal_handler;
+        guint           skip_unchanged : 1;
+        /* Whether the server signals are routed to it */
+        guint           routed : 1;
 
-        gint            closed_reason;
+        /* Whether the hints and actions are shared with a template */
+        guint           hints_shared : 1;
+        guint           actions_shared : 1;
 } NotifyNotificationPrivate;
 
 enum
@@ -119,6 +172,8 @@ enum
         PROP_BODY,
         PROP_ICON_NAME,
         PROP_CLOSED_REASON,
+        PROP_SKIP_UNCHANGED,
+        PROP_CLIENT,
         NUM_PROPERTIES,
 };
 
@@ -147,7 +202,8 @@ notify_notification_constructor (GType                  type,
                                             n_construct_properties,
                                             construct_params);
 
-        _notify_cache_add_notification (NOTIFY_NOTIFICATION (object));
+        _notify_client_add_notification (_notify_notification_get_client (NOTIFY_NOTIFICATION (object)),
+                                         NOTIFY_NOTIFICATION (object));
 
         return object;
 }
@@ -176,6 +232,9 @@ notify_notification_class_init (NotifyNotificationClass *klass)
          *
          * NO signal will be emitted if the user or the daemon dismissed the
          * notification for any other reason.
+         *
+         * The signal is emitted from the dispatch target of the notification,
+         * see [method@Notification.set_dispatch_context].
          */
         signals[SIGNAL_CLOSED] =
                 g_signal_new ("closed",
@@ -300,6 +359,52 @@ notify_notification_class_init (NotifyNotificationClass *klass)
                                                            | G_PARAM_STATIC_NICK
                                                            | G_PARAM_STATIC_BLURB);
 
+        /**
+         * NotifyNotification:skip-unchanged:
+         *
+         * Whether showing the notification again while it's still shown,
+         * without any change since it was last shown, does nothing.
+         *
+         * This only applies to notifications whose closing is tracked,
+         * that is with actions or with handlers for
+         * [signal@Notification::closed] or
+         * [property@Notification:closed-reason]; other notifications are
+         * always sent again.
+         *
+         * It's disabled by default, as servers may show the notification
+         * again when it's updated, and applications can rely on that.
+         *
+         * Since: 0.8.8
+         */
+        properties[PROP_SKIP_UNCHANGED] = g_param_spec_boolean ("skip-unchanged",
+                                                                "Skip unchanged",
+                                                                "Whether showing the notification again without changes does nothing",
+                                                                FALSE,
+                                                                G_PARAM_READWRITE
+                                                                | G_PARAM_CONSTRUCT
+                                                                | G_PARAM_STATIC_NAME
+                                                                | G_PARAM_STATIC_NICK
+                                                                | G_PARAM_STATIC_BLURB);
+
+        /**
+         * NotifyNotification:client:
+         *
+         * The client the notification is sent through.
+         *
+         * See [ctor@Client.new_notification].
+         *
+         * Since: 0.8.8
+         */
+        properties[PROP_CLIENT] = g_param_spec_object ("client",
+                                                       "Client",
+                                                       "The client the notification is sent through",
+                                                       NOTIFY_TYPE_CLIENT,
+                                                       G_PARAM_READWRITE
+                                                       | G_PARAM_CONSTRUCT_ONLY
+                                                       | G_PARAM_STATIC_NAME
+                                                       | G_PARAM_STATIC_NICK
+                                                       | G_PARAM_STATIC_BLURB);
+
         g_object_class_install_properties (object_class, NUM_PROPERTIES, properties);
 }
 
@@ -308,6 +413,10 @@ notify_notification_update_internal (NotifyNotification *notification,
                                      const char         *summary,
                                      const char         *body,
                                      const char         *icon);
+static guint64  get_show_fingerprint (NotifyNotification *notification);
+static void     set_hint_take        (NotifyNotification *notification,
+                                      const char         *key,
+                                      GVariant           *value);
 
 static void
 notify_notification_set_property (GObject      *object,
@@ -321,7 +430,8 @@ notify_notification_set_property (GObject      *object,
 
         switch (prop_id) {
         case PROP_ID:
-                priv->id = g_value_get_int (value);
+                set_id (notification, g_value_get_int (value));
+                priv->sent_fingerprint = 0;
                 break;
 
         case PROP_APP_NAME:
@@ -355,6 +465,17 @@ notify_notification_set_property (GObject      *object,
                                                      g_value_get_string (value));
                 break;
 
+        case PROP_SKIP_UNCHANGED:
+                priv->skip_unchanged = g_value_get_boolean (value);
+                break;
+
+        case PROP_CLIENT:
+                /* The default client is the global state */
+                if (!_notify_client_is_default (g_value_get_object (value))) {
+                        priv->client = g_value_dup_object (value);
+                }
+                break;
+
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
                 break;
@@ -400,6 +521,14 @@ notify_notification_get_property (GObject    *object,
                 g_value_set_int (value, priv->closed_reason);
                 break;
 
+        case PROP_SKIP_UNCHANGED:
+                g_value_set_boolean (value, priv->skip_unchanged);
+                break;
+
+        case PROP_CLIENT:
+                g_value_set_object (value, notify_notification_get_client (notification));
+                break;
+
         default:
                 G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
                 break;
@@ -407,7 +536,7 @@ notify_notification_get_property (GObject    *object,
 }
 
 static void
-destroy_action_info (ActionInfo *action_info)
+action_info_clear (ActionInfo *action_info)
 {
         if (action_info->user_data != NULL && action_info->free_func != NULL) {
                 action_info->free_func (action_info->user_data);
@@ -415,36 +544,279 @@ destroy_action_info (ActionInfo *action_info)
 
         g_free (action_info->id);
         g_free (action_info->label);
-        g_free (action_info);
+}
+
+static void
+action_info_unref (ActionInfo *action_info)
+{
+        g_atomic_rc_box_release_full (action_info,
+                                      (GDestroyNotify) action_info_clear);
+}
+
+/* Number of actions from which they are looked up through an index */
+#define ACTION_INDEX_THRESHOLD 4
+
+/*
+ * The actions of a notification, in the order they were added. Sets are
+ * immutable once shared between notifications and templates, so what is
+ * derived from them is computed once and cached.
+ */
+struct _NotifyActionSet
+{
+        GPtrArray  *actions;
+        /* Case insensitive index of the actions, by ID, built on demand */
+        GHashTable *index;
+        /* The actions as sent to a notification server and to the portal */
+        GVariant   *fdo_actions;
+        GVariant   *portal_buttons;
+        gboolean    has_nondefault;
+};
+
+static guint
+action_id_hash (gconstpointer key)
+{
+        const char *p;
+        guint32 hash = 5381;
+
+        for (p = key; *p != '\0'; ++p) {
+                hash = (hash << 5) + hash + g_ascii_tolower (*p);
+        }
+
+        return hash;
+}
+
+static gboolean
+action_id_equal (gconstpointer a,
+                 gconstpointer b)
+{
+        return g_ascii_strcasecmp (a, b) == 0;
+}
+
+static void
+action_set_clear (NotifyActionSet *set)
+{
+        g_ptr_array_unref (set->actions);
+        g_clear_pointer (&set->index, g_hash_table_unref);
+        g_clear_pointer (&set->fdo_actions, g_variant_unref);
+        g_clear_pointer (&set->portal_buttons, g_variant_unref);
+}
+
+NotifyActionSet *
+_notify_action_set_ref (NotifyActionSet *set)
+{
+        return g_atomic_rc_box_acquire (set);
+}
+
+void
+_notify_action_set_unref (NotifyActionSet *set)
+{
+        g_atomic_rc_box_release_full (set, (GDestroyNotify) action_set_clear);
+}
+
+static NotifyActionSet *
+action_set_new (guint reserved_size)
+{
+        NotifyActionSet *set = g_atomic_rc_box_new0 (NotifyActionSet);
+
+        set->actions = g_ptr_array_new_full (reserved_size,
+                                             (GDestroyNotify) action_info_unref);
+
+        return set;
 }
 
 static ActionInfo *
-find_action_info (NotifyNotification *notification,
-                  const char         *id,
-                  guint              *out_idx)
+action_set_lookup (NotifyActionSet *set,
+                   const char      *id)
 {
-        NotifyNotificationPrivate *priv =
-                notify_notification_get_instance_private (notification);
+        if (set == NULL) {
+                return NULL;
+        }
+
+        if (set->actions->len < ACTION_INDEX_THRESHOLD) {
+                for (guint i = 0; i < set->actions->len; ++i) {
+                        ActionInfo *ai = g_ptr_array_index (set->actions, i);
+
+                        if (g_ascii_strcasecmp (ai->id, id) == 0) {
+                                return ai;
+                        }
+                }
 
-        if (!priv->actions) {
                 return NULL;
         }
 
-        for (guint i = 0; i < priv->actions->len; ++i) {
-                ActionInfo *ai = g_ptr_array_index (priv->actions, i);
+        if (set->index == NULL) {
+                set->index = g_hash_table_new (action_id_hash, action_id_equal);
 
-                if (strcasecmp (ai->id, id) != 0) {
-                        continue;
+                for (guint i = 0; i < set->actions->len; ++i) {
+                        ActionInfo *ai = g_ptr_array_index (set->actions, i);
+
+                        g_hash_table_insert (set->index, ai->id, ai);
                 }
+        }
+
+        return g_hash_table_lookup (set->index, id);
+}
+
+/*
+ * _notify_action_set_add:
+ * @set: (nullable) (transfer full): A set of actions that is not shared,
+ *   or %NULL.
+ * @id: The action ID.
+ * @label: The human-readable action label.
+ * @callback: The action's callback function.
+ * @user_data: Custom data to pass to @callback.
+ * @free_func: A function to free @user_data.
+ *
+ * Adds an action to @set, replacing the one with the same ID.
+ *
+ * Returns: (transfer full): @set, or a new set if it was %NULL.
+ */
+NotifyActionSet *
+_notify_action_set_add (NotifyActionSet     *set,
+                        const char          *id,
+                        const char          *label,
+                        NotifyActionCallback callback,
+                        gpointer             user_data,
+                        GFreeFunc            free_func)
+{
+        ActionInfo *action_info;
+        ActionInfo *old_action_info;
+
+        if (set == NULL) {
+                set = action_set_new (1);
+        }
 
-                if (out_idx) {
-                        *out_idx = i;
+        old_action_info = action_set_lookup (set, id);
+        if (old_action_info != NULL) {
+                if (set->index != NULL) {
+                        g_hash_table_remove (set->index, old_action_info->id);
                 }
+                g_ptr_array_remove (set->actions, old_action_info);
+        }
+
+        action_info = g_atomic_rc_box_new0 (ActionInfo);
+        action_info->id = g_strdup (id);
+        action_info->label = g_strdup (label);
+        action_info->cb = callback;
+        action_info->user_data = user_data;
+        action_info->free_func = free_func;
+        g_ptr_array_add (set->actions, action_info);
 
-                return ai;
+        if (set->index != NULL) {
+                g_hash_table_insert (set->index, action_info->id, action_info);
         }
 
-        return NULL;
+        if (g_ascii_strcasecmp (id, "default") != 0) {
+                set->has_nondefault = TRUE;
+        }
+
+        g_clear_pointer (&set->fdo_actions, g_variant_unref);
+        g_clear_pointer (&set->portal_buttons, g_variant_unref);
+
+        return set;
+}
+
+/*
+ * _notify_action_set_copy:
+ * @set: A set of actions.
+ *
+ * Returns: (transfer full): A new set with the actions of @set, which
+ *   can be changed.
+ */
+NotifyActionSet *
+_notify_action_set_copy (NotifyActionSet *set)
+{
+        NotifyActionSet *copy = action_set_new (set->actions->len + 1);
+
+        for (guint i = 0; i < set->actions->len; ++i) {
+                g_ptr_array_add (copy->actions,
+                                 g_atomic_rc_box_acquire (g_ptr_array_index (set->actions, i)));
+        }
+
+        copy->has_nondefault = set->has_nondefault;
+        copy->fdo_actions = set->fdo_actions ? g_variant_ref (set->fdo_actions) : NULL;
+        copy->portal_buttons = set->portal_buttons ? g_variant_ref (set->portal_buttons) : NULL;
+
+        return copy;
+}
+
+/* Returns: (transfer none): The actions as an `as` variant */
+static GVariant *
+action_set_get_fdo_actions (NotifyActionSet *set)
+{
+        GVariantBuilder builder;
+
+        if (set->fdo_actions != NULL) {
+                return set->fdo_actions;
+        }
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+        for (guint i = 0; i < set->actions->len; ++i) {
+                ActionInfo *ai = g_ptr_array_index (set->actions, i);
+
+                g_variant_builder_add (&builder, "s", ai->id);
+                g_variant_builder_add (&builder, "s", ai->label);
+        }
+
+        set->fdo_actions = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+        return set->fdo_actions;
+}
+
+/* Returns: (transfer none): The actions as portal buttons */
+static GVariant *
+action_set_get_portal_buttons (NotifyActionSet *set)
+{
+        GVariantBuilder buttons;
+
+        if (set->portal_buttons != NULL) {
+                return set->portal_buttons;
+        }
+
+        g_variant_builder_init (&buttons, G_VARIANT_TYPE ("aa{sv}"));
+
+        for (guint i = 0; i < set->actions->len; ++i) {
+                GVariantBuilder button;
+                ActionInfo *ai = g_ptr_array_index (set->actions, i);
+
+                g_variant_builder_init (&button, G_VARIANT_TYPE_VARDICT);
+
+                g_variant_builder_add (&button, "{sv}", "action",
+                                       g_variant_new_string (ai->id));
+                g_variant_builder_add (&button, "{sv}", "label",
+                                       g_variant_new_string (ai->label));
+
+                g_variant_builder_add (&buttons, "@a{sv}",
+                                       g_variant_builder_end (&button));
+        }
+
+        set->portal_buttons = g_variant_ref_sink (g_variant_builder_end (&buttons));
+
+        return set->portal_buttons;
+}
+
+static ActionInfo *
+find_action_info (NotifyNotification *notification,
+                  const char         *id)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        return action_set_lookup (priv->actions, id);
+}
+
+static GVariant *
+lookup_hint (NotifyNotification *notification,
+             const char         *key)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (priv->hints == NULL) {
+                return NULL;
+        }
+
+        return g_hash_table_lookup (priv->hints, key);
 }
 
 static void
@@ -455,10 +827,6 @@ notify_notification_init (NotifyNotification *notification)
 
         priv->timeout = NOTIFY_EXPIRES_DEFAULT;
         priv->closed_reason = NOTIFY_CLOSED_REASON_UNSET;
-        priv->hints = g_hash_table_new_full (g_str_hash,
-                                             g_str_equal,
-                                             g_free,
-                                             (GDestroyNotify) g_variant_unref);
 }
 
 static void
@@ -467,14 +835,9 @@ notify_notification_dispose (GObject *object)
         NotifyNotification        *notification = NOTIFY_NOTIFICATION (object);
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
-        GDBusProxy                *proxy;
 
         g_clear_handle_id (&priv->portal_timeout_id, g_source_remove);
-
-        proxy = _notify_get_proxy (NULL);
-        if (proxy != NULL) {
-                g_clear_signal_handler (&priv->proxy_signal_handler, proxy);
-        }
+        stop_routing (notification);
 
         G_OBJECT_CLASS (notify_notification_parent_class)->dispose (object);
 }
@@ -486,23 +849,45 @@ notify_notification_finalize (GObject *object)
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
 
-        _notify_cache_remove_notification (notification);
+        _notify_client_remove_notification (priv->client, notification);
+        g_clear_object (&priv->client);
 
-        g_free (priv->app_name);
-        g_free (priv->app_icon);
-        g_free (priv->summary);
-        g_free (priv->body);
-        g_free (priv->icon_name);
+        g_clear_pointer (&priv->app_name, g_ref_string_release);
+        g_clear_pointer (&priv->app_icon, g_ref_string_release);
+        g_free (priv->text_block);
         g_free (priv->activation_token);
+        g_free (priv->group_key);
         g_clear_object (&priv->icon_pixbuf);
-        g_clear_pointer (&priv->actions, g_ptr_array_unref);
+        g_clear_pointer (&priv->actions, _notify_action_set_unref);
 
-        if (priv->hints != NULL)
-                g_hash_table_destroy (priv->hints);
+        g_clear_pointer (&priv->hints, g_hash_table_unref);
+        g_clear_pointer (&priv->dispatch_context, g_main_context_unref);
 
         G_OBJECT_CLASS (notify_notification_parent_class)->finalize (object);
 }
 
+/*
+ * Whether @notification belongs to the default client, so that the
+ * process-wide policies apply to it.
+ */
+static gboolean
+is_default_client (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        return priv->client == NULL;
+}
+
+static gboolean
+uses_portal (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        return _notify_client_uses_portal (priv->client);
+}
+
 static gboolean
 maybe_warn_portal_unsupported_feature (const char *feature_name)
 {
@@ -640,6 +1025,48 @@ try_prepend_snap (NotifyNotification *notification,
 }
 
 
+/*
+ * Replaces the text fields of @priv with copies of @summary, @body and
+ * @icon_name, which may point to the current ones.
+ */
+static void
+set_text_fields (NotifyNotificationPrivate *priv,
+                 const char                *summary,
+                 const char                *body,
+                 const char                *icon_name)
+{
+        const char *fields[] = { summary, body, icon_name };
+        char **targets[] = { &priv->summary, &priv->body, &priv->icon_name };
+        gsize sizes[G_N_ELEMENTS (fields)];
+        gsize total = 0;
+        char *block = NULL;
+        char *p;
+
+        for (guint i = 0; i < G_N_ELEMENTS (fields); ++i) {
+                sizes[i] = fields[i] != NULL ? strlen (fields[i]) + 1 : 0;
+                total += sizes[i];
+        }
+
+        if (total > 0) {
+                block = g_malloc (total);
+        }
+
+        p = block;
+        for (guint i = 0; i < G_N_ELEMENTS (fields); ++i) {
+                if (fields[i] == NULL) {
+                        *targets[i] = NULL;
+                        continue;
+                }
+
+                memcpy (p, fields[i], sizes[i]);
+                *targets[i] = p;
+                p += sizes[i];
+        }
+
+        g_free (priv->text_block);
+        priv->text_block = block;
+}
+
 static void
 notify_notification_update_internal (NotifyNotification *notification,
                                      const char         *summary,
@@ -648,37 +1075,48 @@ notify_notification_update_internal (NotifyNotification *notification,
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
+        gboolean summary_changed = priv->summary != summary;
+        gboolean body_changed = priv->body != body;
+        gboolean icon_changed = priv->icon_name != icon;
+        gchar *snapped_icon = NULL;
 
-        if (priv->summary != summary) {
-                g_free (priv->summary);
-                priv->summary = g_strdup (summary);
-                g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_SUMMARY]);
+        if (!summary_changed && !body_changed && !icon_changed) {
+                return;
         }
 
-        if (priv->body != body) {
-                g_free (priv->body);
-                priv->body = (body != NULL && *body != '\0' ? g_strdup (body) : NULL);
-                g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_BODY]);
+        if (body != NULL && *body == '\0') {
+                body = NULL;
         }
 
-        if (priv->icon_name != icon) {
-                gchar *snapped_icon;
+        if (icon_changed) {
+                if (icon != NULL && *icon == '\0') {
+                        icon = NULL;
+                }
 
-                g_free (priv->icon_name);
-                priv->icon_name = (icon != NULL
-                                                 && *icon != '\0' ? g_strdup (icon) : NULL);
-                snapped_icon = try_prepend_snap (notification, priv->icon_name);
+                snapped_icon = try_prepend_snap (notification, icon);
                 if (snapped_icon != NULL) {
                         g_debug ("Icon updated in snap environment: '%s' -> '%s'\n",
-                                 priv->icon_name, snapped_icon);
-                        g_free (priv->icon_name);
-                        priv->icon_name = snapped_icon;
+                                 icon, snapped_icon);
+                        icon = snapped_icon;
                 }
+        }
 
-                notify_notification_set_hint (notification,
-                                              NOTIFY_NOTIFICATION_HINT_IMAGE_PATH,
-                                              priv->icon_name ?
-                                              g_variant_new_string (priv->icon_name) : NULL);
+        set_text_fields (priv, summary, body, icon);
+        g_free (snapped_icon);
+
+        if (summary_changed) {
+                g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_SUMMARY]);
+        }
+
+        if (body_changed) {
+                g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_BODY]);
+        }
+
+        if (icon_changed) {
+                set_hint_take (notification,
+                               NOTIFY_NOTIFICATION_HINT_IMAGE_PATH,
+                               priv->icon_name ?
+                               g_variant_ref_sink (g_variant_new_string (priv->icon_name)) : NULL);
 
                 g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_ICON_NAME]);
         }
@@ -707,253 +1145,919 @@ notify_notification_update (NotifyNotification *notification,
         g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
         g_return_val_if_fail (summary != NULL && *summary != '\0', FALSE);
 
+        g_object_freeze_notify (G_OBJECT (notification));
         notify_notification_update_internal (notification,
                                              summary, body, icon);
+        g_object_thaw_notify (G_OBJECT (notification));
 
         return TRUE;
 }
 
-static char *
-get_portal_notification_id (NotifyNotification *notification)
+/**
+ * notify_notification_update_full:
+ * @notification: The notification to update.
+ * @summary: The new required summary text.
+ * @body: (nullable): The optional body text.
+ * @icon: (nullable): The optional icon theme icon name or filename.
+ * @timeout: The timeout in milliseconds, see
+ *   [method@Notification.set_timeout].
+ * @urgency: The urgency level.
+ * @hints: (nullable): Hints to set, as a `a{sv}` dictionary, see
+ *   [method@Notification.set_hints].
+ *
+ * Updates the notification text, icon, timeout, urgency and hints at once.
+ *
+ * The property change notifications are emitted together once all the
+ * changes are applied. If @hints is floating, it is consumed.
+ *
+ * This won't send the update out and display it on the screen. For that, you
+ * will need to call [method@Notification.show].
+ *
+ * Returns: %TRUE, unless an invalid parameter was passed.
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_notification_update_full (NotifyNotification *notification,
+                                 const char         *summary,
+                                 const char         *body,
+                                 const char         *icon,
+                                 gint                timeout,
+                                 NotifyUrgency       urgency,
+                                 GVariant           *hints)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
-        char *app_id;
-        char *notification_id;
 
-        g_assert (_notify_uses_portal_notifications ());
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
+        g_return_val_if_fail (summary != NULL && *summary != '\0', FALSE);
+        g_return_val_if_fail (hints == NULL ||
+                              g_variant_is_of_type (hints, G_VARIANT_TYPE_VARDICT),
+                              FALSE);
 
-        if (_notify_get_snap_name ()) {
-                app_id = g_strdup_printf ("snap.%s_%s",
-                                          _notify_get_snap_name (),
-                                          _notify_get_snap_app ());
-        } else {
-                app_id = g_strdup_printf ("flatpak.%s",
-                                          _notify_get_flatpak_app ());
-        }
+        g_object_freeze_notify (G_OBJECT (notification));
+
+        notify_notification_update_internal (notification,
+                                             summary, body, icon);
+        priv->timeout = timeout;
+        set_hint_take (notification, NOTIFY_NOTIFICATION_HINT_URGENCY,
+                       g_variant_ref_sink (g_variant_new_byte (urgency)));
+
+        if (hints != NULL) {
+                notify_notification_set_hints (notification, hints);
+        }
+
+        g_object_thaw_notify (G_OBJECT (notification));
+
+        return TRUE;
+}
+
+static guint32 portal_notification_count = 0;
+
+static char *
+build_portal_notification_id (guint32 id)
+{
+        char *app_id;
+        char *notification_id;
+
+        g_assert (_notify_uses_portal_notifications ());
+
+        if (_notify_get_snap_name ()) {
+                app_id = g_strdup_printf ("snap.%s_%s",
+                                          _notify_get_snap_name (),
+                                          _notify_get_snap_app ());
+        } else {
+                app_id = g_strdup_printf ("flatpak.%s",
+                                          _notify_get_flatpak_app ());
+        }
 
         notification_id = g_strdup_printf ("libnotify-%s-%s-%u",
                                            app_id,
                                            notify_get_app_name (),
-                                           priv->id);
+                                           id);
 
         g_free (app_id);
 
         return notification_id;
 }
 
+static char *
+get_portal_notification_id (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        return build_portal_notification_id (priv->id);
+}
+
+static void
+action_activation_free (ActionActivation *activation)
+{
+        g_object_unref (activation->notification);
+        action_info_unref (activation->action_info);
+        g_free (activation->action);
+        g_free (activation->activation_token);
+        g_free (activation);
+}
+
+static void
+run_action_activation (gpointer user_data)
+{
+        ActionActivation *activation = user_data;
+        ActionInfo *action_info = activation->action_info;
+        gpointer previous;
+        gint64 trace_begin;
+
+        /* Callbacks may activate actions of other notifications */
+        previous = g_private_get (&_current_activation);
+        g_private_set (&_current_activation, activation);
+
+        NOTIFY_PROBE1 (action__begin, activation->action);
+        trace_begin = NOTIFY_TRACE_TIME ();
+
+        action_info->cb (activation->notification,
+                         activation->action,
+                         action_info->user_data);
+
+        NOTIFY_TRACE_MARK (trace_begin, "action", "%s", activation->action);
+        NOTIFY_PROBE1 (action__end, activation->action);
+
+        g_private_set (&_current_activation, previous);
+}
+
+/*
+ * Gets the activation whose callback is running in this thread for
+ * @notification, if any.
+ */
+static ActionActivation *
+get_current_activation (NotifyNotification *notification)
+{
+        ActionActivation *activation = g_private_get (&_current_activation);
+
+        if (activation == NULL || activation->notification != notification) {
+                return NULL;
+        }
+
+        return activation;
+}
+
 static gboolean
 activate_action (NotifyNotification *notification,
                  const gchar        *action)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
+        ActionActivation *activation;
         ActionInfo *action_info;
 
-        action_info = find_action_info (notification, action, NULL);
+        action_info = find_action_info (notification, action);
 
         if (!action_info) {
                 return FALSE;
         }
 
-        priv->activating = TRUE;
-        action_info->cb (notification, (char *) action, action_info->user_data);
-        priv->activating = FALSE;
-        g_clear_pointer (&priv->activation_token, g_free);
+        /* The action may be removed while the callback is pending */
+        activation = g_new0 (ActionActivation, 1);
+        activation->notification = g_object_ref (notification);
+        activation->action_info = g_atomic_rc_box_acquire (action_info);
+        activation->action = g_strdup (action);
+        activation->activation_token = g_steal_pointer (&priv->activation_token);
+
+        _notify_dispatch (priv->dispatch_context,
+                          run_action_activation,
+                          activation,
+                          (GDestroyNotify) action_activation_free);
 
         return TRUE;
 }
 
-static gboolean
-close_notification (NotifyNotification *notification,
-                    NotifyClosedReason  reason)
+typedef struct
+{
+        NotifyNotification *notification;
+        guint32             id;
+} ClosedEmission;
+
+static void
+emit_closed (gpointer user_data)
+{
+        ClosedEmission *emission = user_data;
+
+        g_signal_emit (emission->notification, signals[SIGNAL_CLOSED], 0);
+}
+
+/*
+ * Forgets the id of @notification once it was closed, its routes being
+ * removed already.
+ */
+static void
+forget_closed_id (NotifyNotification *notification)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
 
-        if (priv->closed_reason != NOTIFY_CLOSED_REASON_UNSET ||
-            reason == NOTIFY_CLOSED_REASON_UNSET) {
-                return FALSE;
+        if (priv->closed_reason != NOTIFY_CLOSED_REASON_UNSET) {
+                priv->id = 0;
         }
+}
 
-        g_object_ref (G_OBJECT (notification));
-        priv->closed_reason = reason;
-        g_signal_emit (notification, signals[SIGNAL_CLOSED], 0);
-        priv->id = 0;
-        g_object_unref (G_OBJECT (notification));
+/*
+ * Released from the context that closed the notification, after the
+ * closed signal handlers ran with the id of the notification.
+ */
+static void
+closed_emission_free (ClosedEmission *emission)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (emission->notification);
 
-        return TRUE;
+        /* Unless it was shown again meanwhile */
+        if (priv->id == emission->id) {
+                forget_closed_id (emission->notification);
+        }
+
+        g_object_unref (emission->notification);
+        g_free (emission);
 }
 
+/*
+ * Records the time of @timestamp, and the duration of @interval since
+ * @since if it happened.
+ */
 static void
-proxy_g_signal_cb (GDBusProxy *proxy,
-                   const char *sender_name,
-                   const char *signal_name,
-                   GVariant   *parameters,
-                   NotifyNotification *notification)
+record_timestamp (NotifyNotification *notification,
+                  NotifyTimestamp     timestamp,
+                  NotifyTimestamp     since,
+                  NotifyInterval      interval)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
+        gint64 now = g_get_monotonic_time ();
 
-        const char *interface;
+        priv->timestamps[timestamp] = now;
 
-        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        if (priv->timestamps[since] != 0) {
+                _notify_stats_record_interval (interval,
+                                               now - priv->timestamps[since]);
+        }
+}
 
-        interface = g_dbus_proxy_get_interface_name (proxy);
+/*
+ * Records that the server showed @notification, starting a new lifecycle.
+ */
+static void
+record_acknowledged (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
 
-        if (g_strcmp0 (signal_name, "NotificationClosed") == 0 &&
-            g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(uu)"))) {
-                guint32 id, reason;
+        priv->timestamps[NOTIFY_TIMESTAMP_ACTION_INVOKED] = 0;
+        priv->timestamps[NOTIFY_TIMESTAMP_CLOSED] = 0;
 
-                g_variant_get (parameters, "(uu)", &id, &reason);
-                if (id != priv->id)
-                        return;
+        record_timestamp (notification,
+                          NOTIFY_TIMESTAMP_ACKNOWLEDGED,
+                          NOTIFY_TIMESTAMP_SHOW_REQUESTED,
+                          NOTIFY_INTERVAL_ACKNOWLEDGE);
+}
 
-                close_notification (notification, reason);
-        } else if (g_strcmp0 (signal_name, "ActionInvoked") == 0 &&
-                   g_str_equal (interface, NOTIFY_DBUS_CORE_INTERFACE) &&
-                   g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(us)"))) {
-                guint32 id;
-                const char *action;
+/*
+ * Records the first action of the user on @notification since it was
+ * shown.
+ */
+static void
+record_action (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
 
-                g_variant_get (parameters, "(u&s)", &id, &action);
+        if (priv->timestamps[NOTIFY_TIMESTAMP_ACTION_INVOKED] != 0) {
+                return;
+        }
 
-                if (id != priv->id)
-                        return;
+        record_timestamp (notification,
+                          NOTIFY_TIMESTAMP_ACTION_INVOKED,
+                          NOTIFY_TIMESTAMP_ACKNOWLEDGED,
+                          NOTIFY_INTERVAL_ACTION);
+}
 
-                if (!activate_action (notification, action) &&
-                    g_ascii_strcasecmp (action, "default")) {
-                        g_warning ("Received unknown action %s", action);
-                }
-        } else if (g_strcmp0 (signal_name, "ActivationToken") == 0 &&
-                   g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(us)"))) {
-                guint32 id;
-                const char *activation_token;
+/*
+ * _notify_notification_request_show:
+ * @notification: The notification.
+ *
+ * Records that the application asked to show @notification, which the
+ * time to acknowledge is measured from.
+ */
+void
+_notify_notification_request_show (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
 
-                g_variant_get (parameters, "(u&s)", &id, &activation_token);
+        priv->timestamps[NOTIFY_TIMESTAMP_SHOW_REQUESTED] = g_get_monotonic_time ();
+}
 
-                if (id != priv->id)
-                        return;
+static gboolean
+close_notification (NotifyNotification *notification,
+                    NotifyClosedReason  reason)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        ClosedEmission *emission;
 
-                g_free (priv->activation_token);
-                priv->activation_token = g_strdup (activation_token);
-        } else if (g_str_equal (signal_name, "ActionInvoked") &&
-                   g_str_equal (interface, NOTIFY_PORTAL_DBUS_CORE_INTERFACE) &&
-                   g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(ssav)"))) {
-                char *notification_id;
-                const char *id;
-                const char *action;
-                GVariant *parameter;
+        if (priv->closed_reason != NOTIFY_CLOSED_REASON_UNSET ||
+            reason == NOTIFY_CLOSED_REASON_UNSET) {
+                return FALSE;
+        }
 
-                g_variant_get (parameters, "(&s&s@av)", &id, &action, &parameter);
-                g_variant_unref (parameter);
+        g_object_ref (G_OBJECT (notification));
+        if (is_default_client (notification)) {
+                _notify_quota_untrack (notification);
+        }
+        priv->closed_reason = reason;
+        priv->sent_fingerprint = 0;
+        record_timestamp (notification,
+                          NOTIFY_TIMESTAMP_CLOSED,
+                          NOTIFY_TIMESTAMP_ACKNOWLEDGED,
+                          NOTIFY_INTERVAL_CLOSE);
+        _notify_event_channel_push (NOTIFY_EVENT_CLOSED, notification,
+                                    priv->id, reason, NULL);
+
+        /* The id is kept until the handlers ran, but not routed anymore */
+        if (priv->routed) {
+                route_remove (notification);
+        }
 
-                notification_id = get_portal_notification_id (notification);
+        emission = g_new0 (ClosedEmission, 1);
+        emission->notification = g_object_ref (notification);
+        emission->id = priv->id;
+        _notify_dispatch (priv->dispatch_context,
+                          emit_closed,
+                          emission,
+                          (GDestroyNotify) closed_emission_free);
+        g_object_unref (G_OBJECT (notification));
 
-                if (!g_str_equal (notification_id, id)) {
-                        g_free (notification_id);
-                        return;
-                }
+        return TRUE;
+}
 
-                if (!activate_action (notification, action) &&
-                    !g_str_equal (action, "default-action")) {
-                        g_warning ("Received unknown action %s", action);
-                }
+/*
+ * Accounts @notification being shown, and the size of its hints.
+ */
+static void
+count_show (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        guint64 hint_bytes = 0;
+        guint64 image_bytes = 0;
+        GHashTableIter iter;
+        GVariant *value;
 
-                close_notification (notification, NOTIFY_CLOSED_REASON_DISMISSED);
+        _notify_stats_count (priv->id != 0 ? NOTIFY_COUNTER_UPDATES
+                                           : NOTIFY_COUNTER_SHOWS, 1);
 
-                g_free (notification_id);
-        } else {
-                g_debug ("Unhandled signal '%s.%s'", interface, signal_name);
+        if (priv->hints == NULL) {
+                return;
+        }
+
+        g_hash_table_iter_init (&iter, priv->hints);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &value)) {
+                if (g_variant_is_of_type (value, G_VARIANT_TYPE ("(iiibiiay)"))) {
+                        image_bytes += g_variant_get_size (value);
+                } else {
+                        hint_bytes += g_variant_get_size (value);
+                }
         }
+
+        _notify_stats_count (NOTIFY_COUNTER_HINT_BYTES, hint_bytes);
+        _notify_stats_count (NOTIFY_COUNTER_IMAGE_BYTES, image_bytes);
 }
 
-static gboolean
-remove_portal_notification (GDBusProxy         *proxy,
-                            NotifyNotification *notification,
-                            NotifyClosedReason  reason,
-                            GError            **error)
+/*
+ * _notify_notification_local_show:
+ * @notification: The notification.
+ *
+ * Marks @notification as shown by a backend that doesn't need a server,
+ * giving it an id if it had none.
+ */
+void
+_notify_notification_local_show (NotifyNotification *notification)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
-        GVariant *ret;
-        gchar *notification_id;
+        static guint32 local_notification_count = 0;
 
-        if (priv->portal_timeout_id) {
-                g_source_remove (priv->portal_timeout_id);
-                priv->portal_timeout_id = 0;
+        forget_closed_id (notification);
+        count_show (notification);
+
+        priv->closed_reason = NOTIFY_CLOSED_REASON_UNSET;
+
+        if (priv->id == 0) {
+                set_id (notification, ++local_notification_count);
         }
 
-        notification_id = get_portal_notification_id (notification);
+        record_acknowledged (notification);
+        _notify_quota_track (notification);
+}
 
-        ret = g_dbus_proxy_call_sync (proxy,
-                                      "RemoveNotification",
-                                      g_variant_new ("(s)", notification_id),
-                                      G_DBUS_CALL_FLAGS_NONE,
-                                      -1,
-                                      NULL,
-                                      error);
+/*
+ * _notify_notification_local_close:
+ * @notification: The notification.
+ *
+ * Closes @notification shown by a backend that doesn't need a server.
+ */
+void
+_notify_notification_local_close (NotifyNotification *notification)
+{
+        _notify_stats_count (NOTIFY_COUNTER_CLOSES, 1);
+        close_notification (notification, NOTIFY_CLOSED_REASON_API_REQUEST);
+}
 
-        g_free (notification_id);
+/*
+ * _notify_routes_new:
+ *
+ * Returns: (transfer full): Empty routes, for a client.
+ */
+NotifyRoutes *
+_notify_routes_new (void)
+{
+        return g_new0 (NotifyRoutes, 1);
+}
 
-        if (!ret) {
-                return FALSE;
+/*
+ * _notify_routes_free:
+ * @routes: Routes without any notification.
+ */
+void
+_notify_routes_free (NotifyRoutes *routes)
+{
+        if (routes->proxy != NULL) {
+                g_clear_signal_handler (&routes->handler, routes->proxy);
+                g_clear_weak_pointer (&routes->proxy);
         }
 
-        close_notification (notification, reason);
+        g_clear_pointer (&routes->table, g_hash_table_destroy);
+        g_free (routes);
+}
 
-        g_variant_unref (ret);
+static NotifyRoutes *
+get_notification_routes (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
 
-        return TRUE;
+        if (priv->client == NULL) {
+                return &_default_routes;
+        }
+
+        return _notify_client_get_routes (priv->client);
 }
 
-static gboolean
-on_portal_timeout (gpointer data)
+static void
+route_add (NotifyNotification *notification)
 {
-        NotifyNotification *notification = data;
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
-        GDBusProxy *proxy;
+        NotifyRoutes *routes = get_notification_routes (notification);
+        gpointer key = GUINT_TO_POINTER (priv->id);
+        GSList *routed;
 
-        priv->portal_timeout_id = 0;
+        if (priv->id == 0) {
+                return;
+        }
 
-        proxy = _notify_get_proxy (NULL);
-        if (proxy == NULL) {
-                return FALSE;
+        if (routes->table == NULL) {
+                routes->table = g_hash_table_new (NULL, NULL);
         }
 
-        remove_portal_notification (proxy, notification,
-                                    NOTIFY_CLOSED_REASON_EXPIRED, NULL);
-        return FALSE;
+        /* Notifications replacing another one share its id */
+        routed = g_hash_table_lookup (routes->table, key);
+        g_hash_table_insert (routes->table, key,
+                             g_slist_prepend (routed, notification));
 }
 
-static GIcon *
-get_notification_gicon (NotifyNotification  *notification,
-                        GError             **error)
+static void
+route_remove (NotifyNotification *notification)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
-        GFileInputStream *input;
-        GFile *file = NULL;
-        GIcon *gicon = NULL;
+        NotifyRoutes *routes = get_notification_routes (notification);
+        gpointer key = GUINT_TO_POINTER (priv->id);
+        GSList *routed;
 
-        if (priv->icon_pixbuf) {
-                return G_ICON (g_object_ref (priv->icon_pixbuf));
+        if (priv->id == 0 || routes->table == NULL) {
+                return;
         }
 
-        if (!priv->icon_name) {
-                return NULL;
-        }
+        routed = g_slist_remove (g_hash_table_lookup (routes->table, key),
+                                 notification);
 
-        if (g_uri_is_valid (priv->icon_name, G_URI_FLAGS_PARSE_RELAXED, NULL)) {
-                file = g_file_new_for_uri (priv->icon_name);
-        } else if (g_file_test (priv->icon_name, G_FILE_TEST_EXISTS)) {
-                file = g_file_new_for_path (priv->icon_name);
+        if (routed != NULL) {
+                g_hash_table_insert (routes->table, key, routed);
         } else {
-                return g_themed_icon_new (priv->icon_name);
+                g_hash_table_remove (routes->table, key);
         }
+}
 
-        input = g_file_read (file, NULL, error);
+static void
+set_id (NotifyNotification *notification,
+        guint32             id)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (priv->id == id) {
+                return;
+        }
+
+        if (priv->routed) {
+                route_remove (notification);
+        }
+
+        priv->id = id;
+
+        if (priv->routed) {
+                route_add (notification);
+        }
+}
+
+/*
+ * Gets the notifications the signals about the notification with @id must
+ * be routed to.
+ *
+ * Returns: (transfer full) (element-type NotifyNotification): The
+ *   notifications, which may be closed or change their id while the
+ *   signal is handled.
+ */
+static GSList *
+get_routes (NotifyRoutes *routes,
+            guint32       id)
+{
+        GSList *routed;
+
+        if (routes->table == NULL) {
+                return NULL;
+        }
+
+        routed = g_hash_table_lookup (routes->table, GUINT_TO_POINTER (id));
+
+        return g_slist_copy_deep (routed, (GCopyFunc) g_object_ref, NULL);
+}
+
+static void
+handle_action_invoked (NotifyNotification *notification,
+                       const char         *action,
+                       const char         *default_action)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        record_action (notification);
+        _notify_event_channel_push (NOTIFY_EVENT_ACTION_INVOKED, notification,
+                                    priv->id, NOTIFY_CLOSED_REASON_UNSET,
+                                    action);
+
+        if (!activate_action (notification, action) &&
+            g_ascii_strcasecmp (action, default_action)) {
+                g_warning ("Received unknown action %s", action);
+        }
+}
+
+/*
+ * Gets the id of the notification of this process with the portal
+ * notification id @notification_id, or 0.
+ */
+static guint32
+parse_portal_notification_id (const char *notification_id)
+{
+        const char *separator;
+        char *expected_id;
+        guint64 id;
+
+        separator = strrchr (notification_id, '-');
+        if (separator == NULL ||
+            !g_ascii_string_to_unsigned (separator + 1, 10, 1, G_MAXUINT32,
+                                         &id, NULL)) {
+                return 0;
+        }
+
+        expected_id = build_portal_notification_id (id);
+        if (!g_str_equal (expected_id, notification_id)) {
+                id = 0;
+        }
+
+        g_free (expected_id);
+
+        return id;
+}
+
+static void
+proxy_g_signal_cb (GDBusProxy *proxy,
+                   const char *sender_name,
+                   const char *signal_name,
+                   GVariant   *parameters,
+                   gpointer    user_data)
+{
+        NotifyRoutes *routes = user_data;
+        const char *interface;
+        GSList *routed = NULL;
+        GSList *l;
+        gint64 trace_begin;
+
+        NOTIFY_PROBE1 (signal__begin, signal_name);
+        trace_begin = NOTIFY_TRACE_TIME ();
+
+        interface = g_dbus_proxy_get_interface_name (proxy);
+
+        if (g_strcmp0 (signal_name, "NotificationClosed") == 0 &&
+            g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(uu)"))) {
+                guint32 id, reason;
+
+                g_variant_get (parameters, "(uu)", &id, &reason);
+
+                routed = get_routes (routes, id);
+                for (l = routed; l != NULL; l = l->next) {
+                        close_notification (l->data, reason);
+                }
+        } else if (g_strcmp0 (signal_name, "ActionInvoked") == 0 &&
+                   g_str_equal (interface, NOTIFY_DBUS_CORE_INTERFACE) &&
+                   g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(us)"))) {
+                guint32 id;
+                const char *action;
+
+                g_variant_get (parameters, "(u&s)", &id, &action);
+
+                routed = get_routes (routes, id);
+                for (l = routed; l != NULL; l = l->next) {
+                        handle_action_invoked (l->data, action, "default");
+                }
+        } else if (g_strcmp0 (signal_name, "ActivationToken") == 0 &&
+                   g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(us)"))) {
+                guint32 id;
+                const char *activation_token;
+
+                g_variant_get (parameters, "(u&s)", &id, &activation_token);
+
+                routed = get_routes (routes, id);
+                for (l = routed; l != NULL; l = l->next) {
+                        NotifyNotificationPrivate *priv =
+                                notify_notification_get_instance_private (l->data);
+
+                        record_action (l->data);
+                        _notify_event_channel_push (NOTIFY_EVENT_ACTIVATION_TOKEN,
+                                                    l->data, id,
+                                                    NOTIFY_CLOSED_REASON_UNSET,
+                                                    activation_token);
+
+                        g_free (priv->activation_token);
+                        priv->activation_token = g_strdup (activation_token);
+                }
+        } else if (g_str_equal (signal_name, "ActionInvoked") &&
+                   g_str_equal (interface, NOTIFY_PORTAL_DBUS_CORE_INTERFACE) &&
+                   g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(ssav)"))) {
+                const char *id;
+                const char *action;
+                GVariant *parameter;
+
+                g_variant_get (parameters, "(&s&s@av)", &id, &action, &parameter);
+                g_variant_unref (parameter);
+
+                routed = get_routes (routes, parse_portal_notification_id (id));
+                for (l = routed; l != NULL; l = l->next) {
+                        handle_action_invoked (l->data, action, "default-action");
+                        close_notification (l->data, NOTIFY_CLOSED_REASON_DISMISSED);
+                }
+        } else {
+                g_debug ("Unhandled signal '%s.%s'", interface, signal_name);
+        }
+
+        _notify_stats_count (NOTIFY_COUNTER_SIGNALS_RECEIVED, 1);
+        _notify_stats_count (routed != NULL ? NOTIFY_COUNTER_SIGNALS_DISPATCHED
+                                            : NOTIFY_COUNTER_SIGNALS_IGNORED, 1);
+
+        NOTIFY_TRACE_MARK (trace_begin, "signal", "%s, routed to %u",
+                           signal_name, g_slist_length (routed));
+        NOTIFY_PROBE2 (signal__end, signal_name, g_slist_length (routed));
+
+        g_slist_free_full (routed, g_object_unref);
+}
+
+/*
+ * Routes the server signals received by @proxy about @notification to it.
+ *
+ * A single handler per server dispatches the signals of all the
+ * notifications of its client by id, so that the cost of a signal doesn't
+ * grow with the number of notifications.
+ */
+static void
+start_routing (NotifyNotification *notification,
+               GDBusProxy         *proxy)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        NotifyRoutes *routes = get_notification_routes (notification);
+
+        if (routes->proxy != proxy) {
+                /* Unless the handler went away with the previous proxy */
+                if (routes->proxy != NULL) {
+                        g_clear_signal_handler (&routes->handler, routes->proxy);
+                }
+
+                g_set_weak_pointer (&routes->proxy, proxy);
+                routes->handler = g_signal_connect (proxy, "g-signal",
+                                                    G_CALLBACK (proxy_g_signal_cb),
+                                                    routes);
+        }
+
+        priv->routed = TRUE;
+        route_add (notification);
+}
+
+static void
+stop_routing (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (!priv->routed) {
+                return;
+        }
+
+        route_remove (notification);
+        priv->routed = FALSE;
+}
+
+/*
+ * Whether something may observe the result of showing @notification.
+ *
+ * Notifications without actions, without ::closed handlers (or a class
+ * handler overriding it) and nobody watching #NotifyNotification:closed-reason
+ * won't do anything with the daemon signals, so there's no point in routing
+ * them the signals, unless an event channel reports them or the quota has
+ * to release them.
+ */
+static gboolean
+notification_needs_signals (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        static guint notify_signal_id = 0;
+        GQuark closed_reason_quark;
+
+        if (priv->actions != NULL || _notify_event_channel_is_active ()) {
+                return TRUE;
+        }
+
+        /* The quota keeps it until the server closes it */
+        if (is_default_client (notification) &&
+            _notify_quota_is_active () &&
+            _notify_notification_is_persistent (notification)) {
+                return TRUE;
+        }
+
+        if (NOTIFY_NOTIFICATION_GET_CLASS (notification)->closed != NULL) {
+                return TRUE;
+        }
+
+        if (g_signal_has_handler_pending (notification,
+                                          signals[SIGNAL_CLOSED], 0, TRUE)) {
+                return TRUE;
+        }
+
+        if (G_UNLIKELY (notify_signal_id == 0)) {
+                notify_signal_id = g_signal_lookup ("notify", G_TYPE_OBJECT);
+        }
+
+        closed_reason_quark =
+                g_param_spec_get_name_quark (properties[PROP_CLOSED_REASON]);
+
+        return g_signal_has_handler_pending (notification,
+                                             notify_signal_id,
+                                             closed_reason_quark,
+                                             TRUE);
+}
+
+/*
+ * _notify_send_message_no_reply:
+ * @proxy: The proxy of the notification service.
+ * @method: The method to call.
+ * @parameters: (transfer floating): The method parameters.
+ * @error: The returned error information.
+ *
+ * Calls @method without waiting for, nor expecting, any reply.
+ *
+ * Returns: %TRUE if the message was queued for sending.
+ */
+gboolean
+_notify_send_message_no_reply (GDBusProxy  *proxy,
+                               const char  *method,
+                               GVariant    *parameters,
+                               GError     **error)
+{
+        GDBusMessage *message;
+        gboolean ret;
+
+        message = g_dbus_message_new_method_call (g_dbus_proxy_get_name (proxy),
+                                                  g_dbus_proxy_get_object_path (proxy),
+                                                  g_dbus_proxy_get_interface_name (proxy),
+                                                  method);
+        g_dbus_message_set_body (message, parameters);
+        g_dbus_message_set_flags (message, _notify_get_message_flags ());
+
+        ret = g_dbus_connection_send_message (g_dbus_proxy_get_connection (proxy),
+                                              message,
+                                              G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+                                              NULL,
+                                              error);
+        g_object_unref (message);
+
+        return ret;
+}
+
+static gboolean
+remove_portal_notification (GDBusProxy         *proxy,
+                            NotifyNotification *notification,
+                            NotifyClosedReason  reason,
+                            GError            **error)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        GVariant *ret;
+        gchar *notification_id;
+        gint64 start_time;
+        GError *local_error = NULL;
+
+        if (priv->portal_timeout_id) {
+                g_source_remove (priv->portal_timeout_id);
+                priv->portal_timeout_id = 0;
+        }
+
+        notification_id = get_portal_notification_id (notification);
+
+        start_time = g_get_monotonic_time ();
+        ret = g_dbus_proxy_call_sync (proxy,
+                                      "RemoveNotification",
+                                      g_variant_new ("(s)", notification_id),
+                                      _notify_get_call_flags (),
+                                      -1,
+                                      NULL,
+                                      &local_error);
+        _notify_stats_record_call ("RemoveNotification", start_time,
+                                   local_error);
+
+        g_free (notification_id);
+
+        if (!ret) {
+                g_propagate_error (error, local_error);
+                return FALSE;
+        }
+
+        close_notification (notification, reason);
+
+        g_variant_unref (ret);
+
+        return TRUE;
+}
+
+static gboolean
+on_portal_timeout (gpointer data)
+{
+        NotifyNotification *notification = data;
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        GDBusProxy *proxy;
+
+        priv->portal_timeout_id = 0;
+
+        proxy = _notify_get_proxy (NULL);
+        if (proxy == NULL) {
+                return FALSE;
+        }
+
+        remove_portal_notification (proxy, notification,
+                                    NOTIFY_CLOSED_REASON_EXPIRED, NULL);
+        return FALSE;
+}
+
+static GIcon *
+get_icon_name_gicon (const char  *icon_name,
+                     GError     **error)
+{
+        GFileInputStream *input;
+        GFile *file = NULL;
+        GIcon *gicon = NULL;
+
+        if (!icon_name) {
+                return NULL;
+        }
+
+        if (g_uri_is_valid (icon_name, G_URI_FLAGS_PARSE_RELAXED, NULL)) {
+                file = g_file_new_for_uri (icon_name);
+        } else if (g_file_test (icon_name, G_FILE_TEST_EXISTS)) {
+                file = g_file_new_for_path (icon_name);
+        } else {
+                return g_themed_icon_new (icon_name);
+        }
+
+        input = g_file_read (file, NULL, error);
 
         if (input) {
                 GByteArray *bytes_array = g_byte_array_new ();
@@ -997,19 +2101,47 @@ get_notification_gicon (NotifyNotification  *notification,
         return gicon;
 }
 
-static gboolean
-add_portal_notification (GDBusProxy         *proxy,
-                         NotifyNotification *notification,
-                         GError            **error)
+static GIcon *
+get_notification_gicon (NotifyNotification  *notification,
+                        GError             **error)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (priv->icon_pixbuf) {
+                return G_ICON (g_object_ref (priv->icon_pixbuf));
+        }
+
+        return get_icon_name_gicon (priv->icon_name, error);
+}
+
+static const char *
+get_portal_priority (NotifyUrgency urgency)
+{
+        switch (urgency) {
+        case NOTIFY_URGENCY_LOW:
+                return "low";
+        case NOTIFY_URGENCY_NORMAL:
+                return "normal";
+        case NOTIFY_URGENCY_CRITICAL:
+                return "urgent";
+        default:
+                g_warn_if_reached ();
+                return NULL;
+        }
+}
+
+static GVariant *
+prepare_portal_show (GDBusProxy         *proxy,
+                     NotifyNotification *notification,
+                     GError            **error)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
         GIcon *icon;
         GVariant *urgency;
-        GVariant *ret;
         GVariantBuilder builder;
         GError *local_error = NULL;
-        static guint32 portal_notification_count = 0;
         char *notification_id;
 
         g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
@@ -1019,52 +2151,24 @@ add_portal_notification (GDBusProxy         *proxy,
         g_variant_builder_add (&builder, "{sv}", "body",
                                g_variant_new_string (priv->body ? priv->body : ""));
 
-        if (find_action_info (notification, "default", NULL)) {
+        if (find_action_info (notification, "default")) {
                 g_variant_builder_add (&builder, "{sv}", "default-action",
                                        g_variant_new_string ("default"));
         }
 
-        if (priv->has_nondefault_actions && priv->actions) {
-                GVariantBuilder buttons;
-
-                g_variant_builder_init (&buttons, G_VARIANT_TYPE ("aa{sv}"));
-
-                for (guint i = 0; i < priv->actions->len; ++i) {
-                        GVariantBuilder button;
-                        ActionInfo *ai = g_ptr_array_index (priv->actions, i);
-
-                        g_variant_builder_init (&button, G_VARIANT_TYPE_VARDICT);
-
-                        g_variant_builder_add (&button, "{sv}", "action",
-                                               g_variant_new_string (ai->id));
-                        g_variant_builder_add (&button, "{sv}", "label",
-                                               g_variant_new_string (ai->label));
-
-                        g_variant_builder_add (&buttons, "@a{sv}",
-                                               g_variant_builder_end (&button));
-                }
-
+        if (priv->actions && priv->actions->has_nondefault) {
                 g_variant_builder_add (&builder, "{sv}", "buttons",
-                                       g_variant_builder_end (&buttons));
+                                       action_set_get_portal_buttons (priv->actions));
         }
 
-        urgency = g_hash_table_lookup (priv->hints, NOTIFY_NOTIFICATION_HINT_URGENCY);
+        urgency = lookup_hint (notification, NOTIFY_NOTIFICATION_HINT_URGENCY);
         if (urgency) {
-                switch (g_variant_get_byte (urgency)) {
-                case NOTIFY_URGENCY_LOW:
-                        g_variant_builder_add (&builder, "{sv}", "priority",
-                                               g_variant_new_string ("low"));
-                        break;
-                case NOTIFY_URGENCY_NORMAL:
-                        g_variant_builder_add (&builder, "{sv}", "priority",
-                                               g_variant_new_string ("normal"));
-                        break;
-                case NOTIFY_URGENCY_CRITICAL:
+                const char *priority;
+
+                priority = get_portal_priority (g_variant_get_byte (urgency));
+                if (priority) {
                         g_variant_builder_add (&builder, "{sv}", "priority",
-                                               g_variant_new_string ("urgent"));
-                        break;
-                default:
-                        g_warn_if_reached ();
+                                               g_variant_new_string (priority));
                 }
         }
 
@@ -1077,37 +2181,44 @@ add_portal_notification (GDBusProxy         *proxy,
                 g_variant_unref (serialized_icon);
                 g_clear_object (&icon);
         } else if (local_error) {
+                g_variant_builder_clear (&builder);
                 g_propagate_error (error, local_error);
-                return FALSE;
+                return NULL;
         }
 
         if (!priv->id) {
-                priv->id = ++portal_notification_count;
+                set_id (notification, ++portal_notification_count);
         } else if (priv->closed_reason == NOTIFY_CLOSED_REASON_UNSET) {
-                remove_portal_notification (proxy, notification,
-                                            NOTIFY_CLOSED_REASON_UNSET, NULL);
+                /* Messages are delivered in order, so there's no need to
+                 * wait for the removal before adding the notification again.
+                 */
+                notification_id = get_portal_notification_id (notification);
+                _notify_send_message_no_reply (proxy,
+                                               "RemoveNotification",
+                                               g_variant_new ("(s)", notification_id),
+                                               NULL);
+                g_free (notification_id);
         }
 
+        g_clear_handle_id (&priv->portal_timeout_id, g_source_remove);
+
         notification_id = get_portal_notification_id (notification);
 
-        ret = g_dbus_proxy_call_sync (proxy,
-                                      "AddNotification",
-                                      g_variant_new ("(s@a{sv})",
-                                                     notification_id,
-                                                     g_variant_builder_end (&builder)),
-                                      G_DBUS_CALL_FLAGS_NONE,
-                                      -1,
-                                      NULL,
-                                      error);
+        return g_variant_new ("(@s@a{sv})",
+                              g_variant_new_take_string (notification_id),
+                              g_variant_builder_end (&builder));
+}
 
-        if (priv->portal_timeout_id) {
-                g_source_remove (priv->portal_timeout_id);
-                priv->portal_timeout_id = 0;
-        }
+static gboolean
+finish_portal_show (NotifyNotification *notification,
+                    GVariant           *result)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
 
-        g_free (notification_id);
+        g_clear_handle_id (&priv->portal_timeout_id, g_source_remove);
 
-        if (!ret) {
+        if (!result) {
                 return FALSE;
         }
 
@@ -1117,30 +2228,45 @@ add_portal_notification (GDBusProxy         *proxy,
                                                          notification);
         }
 
-        g_variant_unref (ret);
-
         return TRUE;
 }
 
+/*
+ * _notify_get_hint_name:
+ * @client: (nullable): The client, or %NULL for the default client.
+ * @hint: The hint name, as in notification-hints.h
+ *
+ * Gets the name the notification server knows @hint as, depending on the
+ * version of the specification it supports.
+ *
+ * If the server version is not known yet (no server is running), the
+ * latest name is returned.
+ *
+ * Returns: (nullable): The hint name, or %NULL if not supported.
+ */
 const char *
-get_hint_name (NotifyNotification *notification,
-               const char         *hint)
+_notify_get_hint_name (NotifyClient *client,
+                       const char   *hint)
 {
+        if (!_notify_client_has_spec_version (client)) {
+                return hint;
+        }
+
         if (g_str_equal (hint, NOTIFY_NOTIFICATION_HINT_IMAGE_DATA)) {
-                if (_notify_check_spec_version (1, 2)) {
+                if (_notify_client_check_spec_version (client, 1, 2)) {
                         return hint;
                 }
-                if (_notify_check_spec_version (1, 1)) {
+                if (_notify_client_check_spec_version (client, 1, 1)) {
                         return NOTIFY_NOTIFICATION_HINT_IMAGE_DATA_LEGACY;
                 }
                 return "icon_data";
         }
 
         if (g_str_equal (hint, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH)) {
-                if (_notify_check_spec_version (1, 2)) {
+                if (_notify_client_check_spec_version (client, 1, 2)) {
                         return hint;
                 }
-                if (_notify_check_spec_version (1, 1)) {
+                if (_notify_client_check_spec_version (client, 1, 1)) {
                         return NOTIFY_NOTIFICATION_HINT_IMAGE_PATH_LEGACY;
                 }
 
@@ -1154,6 +2280,409 @@ get_hint_name (NotifyNotification *notification,
         return hint;
 }
 
+/*
+ * Adds the hints that libnotify sets on behalf of the application, unless
+ * they are already part of @hints (that can be %NULL).
+ */
+static void
+add_default_hints (GVariantBuilder *hints_builder,
+                   GHashTable      *hints)
+{
+        GApplication *application = NULL;
+
+        if (hints == NULL || g_hash_table_lookup (hints, "sender-pid") == NULL) {
+                g_variant_builder_add (hints_builder, "{sv}", "sender-pid",
+                                       g_variant_new_int64 (getpid ()));
+        }
+
+        if (hints != NULL &&
+            g_hash_table_lookup (hints,
+                                 NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY) != NULL) {
+                return;
+        }
+
+        if (_notify_get_snap_app ()) {
+                gchar *snap_desktop;
+
+                snap_desktop = g_strdup_printf ("%s_%s",
+                                                _notify_get_snap_name (),
+                                                _notify_get_snap_app ());
+
+                g_debug ("Using desktop entry: %s", snap_desktop);
+                g_variant_builder_add (hints_builder, "{sv}",
+                                       NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY,
+                                       g_variant_new_take_string (snap_desktop));
+                return;
+        }
+
+        application = g_application_get_default ();
+
+        if (application != NULL) {
+                const char *application_id = g_application_get_application_id (application);
+
+                g_debug ("Using desktop entry: %s", application_id);
+                g_variant_builder_add (hints_builder, "{sv}",
+                                       NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY,
+                                       g_variant_new_string (application_id));
+        }
+}
+
+/*
+ * _notify_notification_get_notify_parameters:
+ * @notification: The notification.
+ *
+ * Builds the parameters of the Notify call showing @notification on a
+ * notification server implementing the specification.
+ *
+ * Returns: (transfer floating): The call parameters.
+ */
+GVariant *
+_notify_notification_get_notify_parameters (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv;
+        GVariantBuilder            hints_builder;
+        GVariant                  *actions;
+        GHashTableIter             iter;
+        gpointer                   key, data;
+        const char                *app_icon = NULL;
+        G_GNUC_UNUSED guint        n_hints;
+        gint64                     trace_begin;
+
+        priv = notify_notification_get_instance_private (notification);
+
+        n_hints = priv->hints != NULL ? g_hash_table_size (priv->hints) : 0;
+        NOTIFY_PROBE2 (hints__begin, priv->id, n_hints);
+        trace_begin = NOTIFY_TRACE_TIME ();
+
+        if (priv->actions != NULL) {
+                actions = action_set_get_fdo_actions (priv->actions);
+        } else {
+                actions = g_variant_new_array (G_VARIANT_TYPE_STRING, NULL, 0);
+        }
+
+        g_variant_builder_init (&hints_builder, G_VARIANT_TYPE ("a{sv}"));
+        if (priv->hints != NULL) {
+                g_hash_table_iter_init (&iter, priv->hints);
+                while (g_hash_table_iter_next (&iter, &key, &data)) {
+                        const char *hint = _notify_get_hint_name (priv->client, key);
+                        if (!hint) {
+                                continue;
+                        }
+
+                        g_variant_builder_add (&hints_builder, "{sv}", hint, data);
+                }
+        }
+
+        add_default_hints (&hints_builder, priv->hints);
+
+        NOTIFY_TRACE_MARK (trace_begin, "hints", "id %u, %u hints",
+                           priv->id, n_hints);
+        NOTIFY_PROBE2 (hints__end, priv->id, n_hints);
+
+        app_icon = priv->app_icon ? priv->app_icon
+                                  : _notify_client_get_app_icon (priv->client);
+
+        /* Use the icon_name as app icon only before there was a hint for it */
+        if (!app_icon && _notify_client_has_spec_version (priv->client) &&
+            !_notify_client_check_spec_version (priv->client, 1, 1)) {
+            app_icon = priv->icon_name;
+        }
+
+        return g_variant_new ("(susss@asa{sv}i)",
+                              priv->app_name ? priv->app_name
+                                             : _notify_client_get_app_name (priv->client),
+                              priv->id,
+                              app_icon ? app_icon : "",
+                              priv->summary ? priv->summary : "",
+                              priv->body ? priv->body : "",
+                              actions,
+                              &hints_builder,
+                              priv->timeout);
+}
+
+/*
+ * _notify_translate_notify_parameters:
+ * @parameters: The parameters of a Notify call.
+ *
+ * Translates the hints of Notify call @parameters that were built when
+ * the specification version of the server was not known yet to the names
+ * supported by the current server.
+ *
+ * Returns: (transfer floating): The translated parameters.
+ */
+GVariant *
+_notify_translate_notify_parameters (GVariant *parameters)
+{
+        GVariantBuilder hints_builder;
+        GVariantIter iter;
+        GVariant *hints;
+        GVariant *value;
+        const char *app_name, *app_icon, *summary, *body;
+        const char *image_path = NULL;
+        const char *key;
+        guint32 replaces_id;
+        gint32 timeout;
+        GVariant *actions;
+        GVariant *ret;
+
+        g_variant_get (parameters, "(&su&s&s&s@as@a{sv}i)",
+                       &app_name, &replaces_id, &app_icon, &summary, &body,
+                       &actions, &hints, &timeout);
+
+        g_variant_builder_init (&hints_builder, G_VARIANT_TYPE ("a{sv}"));
+        g_variant_iter_init (&iter, hints);
+        while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+                const char *hint = _notify_get_hint_name (NULL, key);
+
+                if (!hint) {
+                        if (g_str_equal (key, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH) &&
+                            g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
+                                image_path = g_variant_get_string (value, NULL);
+                        }
+                        continue;
+                }
+
+                g_variant_builder_add (&hints_builder, "{sv}", hint, value);
+        }
+
+        /* Use the image as app icon only before there was a hint for it */
+        if (*app_icon == '\0' && image_path != NULL) {
+                app_icon = image_path;
+        }
+
+        ret = g_variant_new ("(susss@as@a{sv}i)",
+                             app_name,
+                             replaces_id,
+                             app_icon,
+                             summary,
+                             body,
+                             actions,
+                             g_variant_builder_end (&hints_builder),
+                             timeout);
+
+        g_variant_unref (hints);
+        g_variant_unref (actions);
+
+        return ret;
+}
+
+/*
+ * _notify_notification_prepare_show:
+ * @notification: The notification.
+ * @proxy: The proxy for the notification service.
+ * @out_method: (out): The method to call to show @notification.
+ * @error: The returned error information.
+ *
+ * Prepares @notification for being shown, computing the parameters of the
+ * D-Bus call that will show it.
+ *
+ * The call result must be passed to _notify_notification_finish_show().
+ *
+ * Returns: (transfer floating) (nullable): The call parameters, or %NULL
+ *   on error.
+ */
+GVariant *
+_notify_notification_prepare_show (NotifyNotification  *notification,
+                                   GDBusProxy          *proxy,
+                                   const char         **out_method,
+                                   GError             **error)
+{
+        NotifyNotificationPrivate *priv;
+
+        priv = notify_notification_get_instance_private (notification);
+
+        /* Its closed signal may still be pending, but it's a new one */
+        forget_closed_id (notification);
+
+        /* The parameters depend on the version of the server */
+        if (is_default_client (notification)) {
+                _notify_wait_server_info ();
+        }
+
+        if (!priv->routed && notification_needs_signals (notification)) {
+                start_routing (notification, proxy);
+        }
+
+        count_show (notification);
+
+        if (uses_portal (notification)) {
+                *out_method = "AddNotification";
+                return prepare_portal_show (proxy, notification, error);
+        }
+
+        priv->closed_reason = NOTIFY_CLOSED_REASON_UNSET;
+
+        *out_method = "Notify";
+        return _notify_notification_get_notify_parameters (notification);
+}
+
+/*
+ * _notify_notification_finish_show:
+ * @notification: The notification.
+ * @result: (nullable): The result of the call, or %NULL if it failed.
+ * @error: The returned error information.
+ *
+ * Completes showing @notification, using the result of the call prepared
+ * by _notify_notification_prepare_show().
+ *
+ * Returns: %TRUE if the notification was shown.
+ */
+gboolean
+_notify_notification_finish_show (NotifyNotification *notification,
+                                  GVariant           *result,
+                                  GError            **error)
+{
+        if (uses_portal (notification)) {
+                if (!finish_portal_show (notification, result)) {
+                        return FALSE;
+                }
+        } else {
+                guint32 id;
+
+                if (result == NULL) {
+                        return FALSE;
+                }
+                if (!g_variant_is_of_type (result, G_VARIANT_TYPE ("(u)"))) {
+                        g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                     "Unexpected reply type");
+                        return FALSE;
+                }
+
+                g_variant_get (result, "(u)", &id);
+                set_id (notification, id);
+        }
+
+        record_acknowledged (notification);
+
+        if (is_default_client (notification)) {
+                _notify_quota_track (notification);
+        }
+
+        return TRUE;
+}
+
+/*
+ * _notify_notification_begin_show:
+ * @notification: The notification.
+ * @proxy: The proxy for the notification service.
+ * @out_parameters: (out) (transfer floating): Where to store the
+ *   parameters of the call showing @notification, or %NULL if nothing
+ *   has to be sent.
+ * @out_method: (out): Where to store the method to call.
+ * @out_content_hash: (out): Where to store the value to pass to
+ *   _notify_notification_end_show().
+ * @error: The returned error information.
+ *
+ * Runs the steps of notify_notification_show() preceding the call to the
+ * server: deduplication, grouping and spooling can make it unnecessary.
+ *
+ * Returns: %FALSE on error.
+ */
+gboolean
+_notify_notification_begin_show (NotifyNotification  *notification,
+                                 GDBusProxy          *proxy,
+                                 GVariant           **out_parameters,
+                                 const char         **out_method,
+                                 guint64             *out_content_hash,
+                                 GError             **error)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        GVariant *parameters;
+        guint64 fingerprint;
+        guint repeat_count;
+
+        *out_parameters = NULL;
+
+        /* Re-sending the shown content would only make the server render
+         * it again, but unless we follow the closing of the notification,
+         * we can't know that it's still shown */
+        fingerprint = get_show_fingerprint (notification);
+        if (priv->skip_unchanged &&
+            priv->sent_fingerprint == fingerprint &&
+            priv->id != 0 &&
+            priv->closed_reason == NOTIFY_CLOSED_REASON_UNSET &&
+            priv->routed &&
+            !uses_portal (notification)) {
+                *out_content_hash = 0;
+                return TRUE;
+        }
+
+        priv->sent_fingerprint = 0;
+        *out_content_hash = 0;
+        repeat_count = 0;
+
+        if (is_default_client (notification)) {
+                if (_notify_dedup_handle_show (notification, out_content_hash,
+                                               &repeat_count)) {
+                        return TRUE;
+                }
+
+                if (_notify_grouping_handle_show (notification)) {
+                        return TRUE;
+                }
+        }
+
+        parameters = _notify_notification_prepare_show (notification, proxy,
+                                                        out_method, error);
+        if (parameters == NULL) {
+                _notify_dedup_forget (*out_content_hash);
+                return FALSE;
+        }
+
+        if (repeat_count > 0) {
+                parameters = _notify_dedup_add_repeat_hint (parameters,
+                                                            repeat_count);
+        }
+
+        if (is_default_client (notification) &&
+            _notify_spool_should_queue (proxy)) {
+                /* The replayed notification won't get its id recorded */
+                _notify_dedup_forget (*out_content_hash);
+                *out_content_hash = 0;
+                _notify_spool_push (proxy, notification, parameters);
+                return TRUE;
+        }
+
+        priv->sent_fingerprint = fingerprint;
+        *out_parameters = parameters;
+
+        return TRUE;
+}
+
+/*
+ * _notify_notification_end_show:
+ * @notification: The notification.
+ * @result: (nullable): The result of the call, or %NULL if it failed.
+ * @content_hash: The content hash returned by
+ *   _notify_notification_begin_show().
+ * @error: The returned error information.
+ *
+ * Completes showing @notification, using the result of the call prepared
+ * by _notify_notification_begin_show().
+ *
+ * Returns: %TRUE if the notification was shown.
+ */
+gboolean
+_notify_notification_end_show (NotifyNotification *notification,
+                               GVariant           *result,
+                               guint64             content_hash,
+                               GError            **error)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (!_notify_notification_finish_show (notification, result, error)) {
+                priv->sent_fingerprint = 0;
+                _notify_dedup_forget (content_hash);
+                return FALSE;
+        }
+
+        _notify_dedup_shown (content_hash, priv->id);
+
+        return TRUE;
+}
+
 /**
  * notify_notification_show:
  * @notification: The notification.
@@ -1161,6 +2690,21 @@ get_hint_name (NotifyNotification *notification,
  *
  * Tells the notification server to display the notification on the screen.
  *
+ * The notification only starts listening to the notification server signals
+ * if it has actions or if something is connected to its
+ * [signal@Notification::closed] signal (or to the notify signal of
+ * [property@Notification:closed-reason]) at the time it is shown.
+ * Handlers connected later are honored on the next call to this function.
+ *
+ * If grouping is enabled with [func@set_grouping], the notification may
+ * only be shown later, as the digest of its group. If deduplication is
+ * enabled with [func@set_deduplication], a notification with the same
+ * content as a recent one may not be shown, or update it.
+ *
+ * Showing again a notification that is still shown and didn't change
+ * since can be made to do nothing, see
+ * [property@Notification:skip-unchanged].
+ *
  * Returns: %TRUE if successful. On error, this will return %FALSE and set
  *   @error.
  */
@@ -1168,16 +2712,193 @@ gboolean
 notify_notification_show (NotifyNotification *notification,
                           GError            **error)
 {
-        NotifyNotificationPrivate *priv;
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        if (is_default_client (notification) && !notify_is_initted ()) {
+                g_warning ("you must call notify_init() before showing");
+                g_assert_not_reached ();
+        }
+
+        _notify_notification_request_show (notification);
+
+        return _notify_notification_get_backend (notification)->show (notification, error);
+}
+
+/*
+ * _notify_dbus_show:
+ *
+ * Shows @notification through the notification server, or the portal.
+ */
+gboolean
+_notify_dbus_show (NotifyNotification *notification,
+                   GError            **error)
+{
         GDBusProxy                *proxy;
-        GVariantBuilder            actions_builder, hints_builder;
-        GHashTableIter             iter;
-        gpointer                   key, data;
+        GVariant                  *parameters;
         GVariant                  *result;
-        GApplication              *application = NULL;
-        const char                *app_icon = NULL;
+        const char                *method;
+        gboolean                   ret;
+        guint64                    content_hash;
+        gint64                     start_time;
+        gint64                     trace_begin;
+        GError                    *local_error = NULL;
+
+        proxy = _notify_notification_get_proxy (notification, &local_error);
+        if (proxy == NULL) {
+                if (is_default_client (notification) &&
+                    _notify_breaker_should_fall_back (local_error)) {
+                        g_clear_error (&local_error);
+                        return _notify_breaker_fallback (notification, error);
+                }
 
-        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
+                g_propagate_error (error, local_error);
+                return FALSE;
+        }
+
+        /* Before the show is accounted, routed or deduplicated, so that
+         * skipping it leaves no trace */
+        if (is_default_client (notification) && _notify_breaker_is_open ()) {
+                return _notify_breaker_fallback (notification, error);
+        }
+
+        if (!_notify_notification_begin_show (notification, proxy,
+                                              &parameters, &method,
+                                              &content_hash, error)) {
+                if (is_default_client (notification)) {
+                        _notify_breaker_release ();
+                }
+                return FALSE;
+        }
+
+        if (parameters == NULL) {
+                if (is_default_client (notification)) {
+                        _notify_breaker_release ();
+                }
+                return TRUE;
+        }
+
+        NOTIFY_PROBE1 (show__begin, method);
+        trace_begin = NOTIFY_TRACE_TIME ();
+        start_time = g_get_monotonic_time ();
+        result = g_dbus_proxy_call_sync (proxy,
+                                         method,
+                                         parameters,
+                                         _notify_get_call_flags (),
+                                         -1 /* FIXME ? */,
+                                         NULL,
+                                         &local_error);
+        if (is_default_client (notification)) {
+                _notify_breaker_record (start_time, local_error);
+        }
+        _notify_stats_record_call (method, start_time, local_error);
+        NOTIFY_TRACE_MARK (trace_begin, method, "%s",
+                           local_error != NULL ? local_error->message : "done");
+        NOTIFY_PROBE2 (show__end, method, local_error == NULL);
+
+        if (local_error != NULL) {
+                g_propagate_error (error, local_error);
+        }
+
+        ret = _notify_notification_end_show (notification, result,
+                                             content_hash, error);
+        g_clear_pointer (&result, g_variant_unref);
+
+        return ret;
+}
+
+static gboolean
+send_simple_portal_notification (GDBusProxy     *proxy,
+                                 const char     *summary,
+                                 const char     *body,
+                                 const char     *icon,
+                                 NotifyUrgency   urgency,
+                                 GError        **error)
+{
+        GVariantBuilder builder;
+        GIcon *gicon;
+        GError *local_error = NULL;
+        const char *priority;
+        char *notification_id;
+        gboolean ret;
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+        g_variant_builder_add (&builder, "{sv}", "title",
+                               g_variant_new_string (summary));
+        g_variant_builder_add (&builder, "{sv}", "body",
+                               g_variant_new_string (body ? body : ""));
+
+        priority = get_portal_priority (urgency);
+        if (priority) {
+                g_variant_builder_add (&builder, "{sv}", "priority",
+                                       g_variant_new_string (priority));
+        }
+
+        gicon = get_icon_name_gicon (icon, &local_error);
+        if (gicon) {
+                GVariant *serialized_icon = g_icon_serialize (gicon);
+
+                g_variant_builder_add (&builder, "{sv}", "icon",
+                                       serialized_icon);
+                g_variant_unref (serialized_icon);
+                g_clear_object (&gicon);
+        } else if (local_error) {
+                g_variant_builder_clear (&builder);
+                g_propagate_error (error, local_error);
+                return FALSE;
+        }
+
+        notification_id = build_portal_notification_id (++portal_notification_count);
+
+        ret = _notify_send_message_no_reply (proxy,
+                                             "AddNotification",
+                                             g_variant_new ("(s@a{sv})",
+                                                            notification_id,
+                                                            g_variant_builder_end (&builder)),
+                                             error);
+        g_free (notification_id);
+
+        return ret;
+}
+
+/**
+ * notify_send_simple:
+ * @summary: (not nullable): The required summary text.
+ * @body: (nullable): The optional body text.
+ * @icon: (nullable): The optional icon theme icon name or filename.
+ * @urgency: The urgency level.
+ * @error: The returned error information.
+ *
+ * Sends a one-shot notification without creating a [class@Notification].
+ *
+ * The notification is sent without waiting for any reply from the server,
+ * so it costs a single outgoing message. As a consequence, it can't be
+ * updated, closed or activated later and errors happening on the server
+ * side are not reported. Use a [class@Notification] if any of this is
+ * needed.
+ *
+ * Returns: %TRUE if the notification was sent. On error, this will return
+ *   %FALSE and set @error.
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_send_simple (const char     *summary,
+                    const char     *body,
+                    const char     *icon,
+                    NotifyUrgency   urgency,
+                    GError        **error)
+{
+        GDBusProxy      *proxy;
+        GVariantBuilder  hints_builder;
+        const char      *image_path_hint;
+        const char      *app_icon;
+        char            *snapped_icon;
+        GVariant        *parameters;
+        gboolean         ret;
+
+        g_return_val_if_fail (summary != NULL && *summary != '\0', FALSE);
         g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
         if (!notify_is_initted ()) {
@@ -1185,120 +2906,85 @@ notify_notification_show (NotifyNotification *notification,
                 g_assert_not_reached ();
         }
 
-        priv = notify_notification_get_instance_private (notification);
-        proxy = _notify_get_proxy (error);
-        if (proxy == NULL) {
-                return FALSE;
-        }
+        if (!_notify_get_backend ()->uses_dbus) {
+                NotifyNotification *notification;
 
-        if (priv->proxy_signal_handler == 0) {
-                priv->proxy_signal_handler = g_signal_connect_object (proxy,
-                                                                      "g-signal",
-                                                                      G_CALLBACK (proxy_g_signal_cb),
-                                                                      notification,
-                                                                      0);
-        }
+                notification = notify_notification_new (summary, body, icon);
+                notify_notification_set_urgency (notification, urgency);
+                ret = _notify_get_backend ()->show (notification, error);
+                g_object_unref (notification);
 
-        if (_notify_uses_portal_notifications ()) {
-                return add_portal_notification (proxy, notification, error);
+                return ret;
         }
 
-        g_variant_builder_init (&actions_builder, G_VARIANT_TYPE ("as"));
-        for (guint i = 0; priv->actions && i < priv->actions->len; ++i) {
-                ActionInfo *ai = g_ptr_array_index (priv->actions, i);
-
-                g_variant_builder_add (&actions_builder, "s", ai->id);
-                g_variant_builder_add (&actions_builder, "s", ai->label);
+        proxy = _notify_get_proxy (error);
+        if (proxy == NULL) {
+                return FALSE;
         }
 
-        g_variant_builder_init (&hints_builder, G_VARIANT_TYPE ("a{sv}"));
-        g_hash_table_iter_init (&iter, priv->hints);
-        while (g_hash_table_iter_next (&iter, &key, &data)) {
-                const char *hint = get_hint_name (notification, key);
-                if (!hint) {
-                        continue;
-                }
+        _notify_stats_count (NOTIFY_COUNTER_SHOWS, 1);
 
-                g_variant_builder_add (&hints_builder, "{sv}", hint, data);
+        if (body != NULL && *body == '\0') {
+                body = NULL;
         }
 
-        if (g_hash_table_lookup (priv->hints, "sender-pid") == NULL) {
-                g_variant_builder_add (&hints_builder, "{sv}", "sender-pid",
-                                       g_variant_new_int64 (getpid ()));
+        if (icon != NULL && *icon == '\0') {
+                icon = NULL;
         }
 
-        if (_notify_get_snap_app () &&
-            g_hash_table_lookup (priv->hints,
-                                 NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY) == NULL) {
-                gchar *snap_desktop;
+        snapped_icon = try_prepend_snap (NULL, icon);
+        if (snapped_icon != NULL) {
+                icon = snapped_icon;
+        }
 
-                snap_desktop = g_strdup_printf ("%s_%s",
-                                                _notify_get_snap_name (),
-                                                _notify_get_snap_app ());
+        if (_notify_uses_portal_notifications ()) {
+                ret = send_simple_portal_notification (proxy, summary, body,
+                                                       icon, urgency, error);
+                g_free (snapped_icon);
 
-                g_debug ("Using desktop entry: %s", snap_desktop);
-                g_variant_builder_add (&hints_builder, "{sv}",
-                                       NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY,
-                                       g_variant_new_take_string (snap_desktop));
+                return ret;
         }
 
-        if (!_notify_get_snap_app ()) {
-                application = g_application_get_default ();
+        g_variant_builder_init (&hints_builder, G_VARIANT_TYPE ("a{sv}"));
+        g_variant_builder_add (&hints_builder, "{sv}",
+                               NOTIFY_NOTIFICATION_HINT_URGENCY,
+                               g_variant_new_byte ((guchar) urgency));
+
+        image_path_hint = _notify_get_hint_name (NULL, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH);
+        if (icon != NULL && image_path_hint != NULL) {
+                g_variant_builder_add (&hints_builder, "{sv}", image_path_hint,
+                                       g_variant_new_string (icon));
         }
 
-        if (application != NULL) {
-            GVariant *desktop_entry = g_hash_table_lookup (priv->hints,
-                                                           NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY);
-
-            if (desktop_entry == NULL) {
-                const char *application_id = g_application_get_application_id (application);
-
-                g_debug ("Using desktop entry: %s", application_id);
-                g_variant_builder_add (&hints_builder, "{sv}",
-                                       NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY,
-                                       g_variant_new_string (application_id));
-            }
-        }
+        add_default_hints (&hints_builder, NULL);
 
-        app_icon = priv->app_icon ? priv->app_icon : notify_get_app_icon ();
+        app_icon = notify_get_app_icon ();
 
-        /* Use the icon_name as app icon only before there was a hint for it */
-        if (!app_icon && !_notify_check_spec_version (1, 1)) {
-            app_icon = priv->icon_name;
+        /* Use the icon as app icon only before there was a hint for it */
+        if (!app_icon && _notify_has_spec_version () &&
+            !_notify_check_spec_version (1, 1)) {
+                app_icon = icon;
         }
 
-        priv->closed_reason = NOTIFY_CLOSED_REASON_UNSET;
-
-        /* TODO: make this nonblocking */
-        result = g_dbus_proxy_call_sync (proxy,
-                                         "Notify",
-                                         g_variant_new ("(susssasa{sv}i)",
-                                                        priv->app_name ? priv->app_name : notify_get_app_name (),
-                                                        priv->id,
-                                                        app_icon ? app_icon : "",
-                                                        priv->summary ? priv->summary : "",
-                                                        priv->body ? priv->body : "",
-                                                        &actions_builder,
-                                                        &hints_builder,
-                                                        priv->timeout),
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1 /* FIXME ? */,
-                                         NULL,
-                                         error);
-        if (result == NULL) {
-                return FALSE;
-        }
-        if (!g_variant_is_of_type (result, G_VARIANT_TYPE ("(u)"))) {
-                g_variant_unref (result);
-                g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
-                             "Unexpected reply type");
-                return FALSE;
+        parameters = g_variant_new ("(susss@asa{sv}i)",
+                                    notify_get_app_name (),
+                                    0,
+                                    app_icon ? app_icon : "",
+                                    summary,
+                                    body ? body : "",
+                                    g_variant_new_strv (NULL, 0),
+                                    &hints_builder,
+                                    NOTIFY_EXPIRES_DEFAULT);
+        g_free (snapped_icon);
+
+        if (_notify_spool_should_queue (proxy)) {
+                _notify_spool_push (proxy, NULL, parameters);
+                return TRUE;
         }
 
-        g_variant_get (result, "(u)", &priv->id);
-        g_variant_unref (result);
+        ret = _notify_send_message_no_reply (proxy, "Notify", parameters, error);
 
-        return TRUE;
+        return ret;
 }
 
 /**
@@ -1421,6 +3107,7 @@ notify_notification_set_image_from_pixbuf (NotifyNotification *notification,
         gboolean        has_alpha;
         gsize           image_len;
         GVariant       *value;
+        gint64          trace_begin;
 
         g_return_if_fail (pixbuf == NULL || GDK_IS_PIXBUF (pixbuf));
 
@@ -1433,11 +3120,12 @@ notify_notification_set_image_from_pixbuf (NotifyNotification *notification,
                 return;
         }
 
-        if (_notify_uses_portal_notifications ()) {
+        if (uses_portal (notification)) {
                 priv->icon_pixbuf = g_object_ref (pixbuf);
                 return;
         }
 
+        trace_begin = NOTIFY_TRACE_TIME ();
         g_object_get (pixbuf,
                       "width", &width,
                       "height", &height,
@@ -1450,6 +3138,7 @@ notify_notification_set_image_from_pixbuf (NotifyNotification *notification,
         image_len = (height - 1) * rowstride + width *
                 ((n_channels * bits_per_sample + 7) / 8);
 
+        NOTIFY_PROBE2 (image__begin, width, height);
         value = g_variant_new ("(iiibii@ay)",
                                width,
                                height,
@@ -1463,6 +3152,10 @@ notify_notification_set_image_from_pixbuf (NotifyNotification *notification,
                                                         TRUE,
                                                         (GDestroyNotify) g_object_unref,
                                                         g_object_ref (pixbuf)));
+        NOTIFY_TRACE_MARK (trace_begin, "image", "%dx%d, %" G_GSIZE_FORMAT " bytes",
+                           width, height, image_len);
+        NOTIFY_PROBE2 (image__end, width, height);
+
         notify_notification_set_hint (notification,
                                       NOTIFY_NOTIFICATION_HINT_IMAGE_DATA,
                                       value);
@@ -1479,136 +3172,577 @@ get_parsed_variant (NotifyNotification *notification,
         const char *str = g_variant_get_string (variant, NULL);
         gchar *parsed = str_parser (notification, str);
 
-        if (parsed != NULL && g_strcmp0 (str, parsed) != 0) {
-                g_debug ("Hint %s updated in snap environment: '%s' -> '%s'\n",
-                         key, str, parsed);
-                g_variant_unref (variant);
-                variant = g_variant_new_take_string (parsed);
+        if (parsed != NULL && g_strcmp0 (str, parsed) != 0) {
+                g_debug ("Hint %s updated in snap environment: '%s' -> '%s'\n",
+                         key, str, parsed);
+                g_variant_unref (variant);
+                variant = g_variant_new_take_string (parsed);
+        }
+
+        return variant;
+}
+
+static GVariant *
+maybe_parse_snap_hint_value (NotifyNotification *notification,
+                             const gchar *key,
+                             GVariant    *value)
+{
+        StringParserFunc parse_func = NULL;
+
+        if (!_notify_get_snap_path ())
+                return value;
+
+        if (g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY) == 0) {
+                parse_func = try_prepend_snap_desktop;
+        } else if (g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH) == 0 ||
+                   g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH_LEGACY) == 0 ||
+                   g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_SOUND_FILE) == 0) {
+                parse_func = try_prepend_snap;
+        }
+
+        if (parse_func == NULL) {
+                return value;
+        }
+
+        return get_parsed_variant (notification, key, value, parse_func);
+}
+
+/*
+ * Sets the hint for @key, taking the reference on @value.
+ */
+static void
+set_hint_take (NotifyNotification *notification,
+               const char         *key,
+               GVariant           *value)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (priv->hints_shared) {
+                GHashTable *shared = priv->hints;
+
+                priv->hints = _notify_hints_copy (shared);
+                priv->hints_shared = FALSE;
+                g_hash_table_unref (shared);
+        }
+
+        priv->hints = _notify_hints_set (priv->hints, key, value);
+}
+
+/*
+ * _notify_hints_set:
+ * @hints: (nullable) (transfer full): A table of hints, or %NULL.
+ * @key: The hint.
+ * @value: (nullable) (transfer full): The hint's value, or %NULL to unset
+ *   it.
+ *
+ * Returns: (transfer full) (nullable): @hints, or a new table if it was
+ *   %NULL.
+ */
+GHashTable *
+_notify_hints_set (GHashTable *hints,
+                   const char *key,
+                   GVariant   *value)
+{
+        if (value == NULL) {
+                if (hints != NULL) {
+                        g_hash_table_remove (hints, key);
+                }
+                return hints;
+        }
+
+        if (hints == NULL) {
+                hints = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               (GDestroyNotify) g_variant_unref);
+        }
+
+        value = maybe_parse_snap_hint_value (NULL, key, value);
+        g_hash_table_insert (hints, g_strdup (key), g_variant_take_ref (value));
+
+        return hints;
+}
+
+/*
+ * _notify_hints_copy:
+ * @hints: A table of hints.
+ *
+ * Returns: (transfer full): A new table with the hints of @hints.
+ */
+GHashTable *
+_notify_hints_copy (GHashTable *hints)
+{
+        GHashTable *copy;
+        GHashTableIter iter;
+        gpointer key, value;
+
+        copy = g_hash_table_new_full (g_str_hash,
+                                      g_str_equal,
+                                      g_free,
+                                      (GDestroyNotify) g_variant_unref);
+
+        g_hash_table_iter_init (&iter, hints);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+                g_hash_table_insert (copy, g_strdup (key), g_variant_ref (value));
+        }
+
+        return copy;
+}
+
+/**
+ * notify_notification_set_hint:
+ * @notification: a #NotifyNotification
+ * @key: the hint key
+ * @value: (nullable): the hint value
+ *
+ * Sets a hint for @key with value @value.
+ *
+ * If @value is %NULL, a previously set hint for @key is unset.
+ *
+ * If @value is floating, it is consumed.
+ *
+ * Since: 0.6
+ */
+void
+notify_notification_set_hint (NotifyNotification *notification,
+                              const char         *key,
+                              GVariant           *value)
+{
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        g_return_if_fail (key != NULL && *key != '\0');
+
+        set_hint_take (notification, key,
+                       value ? g_variant_ref_sink (value) : NULL);
+}
+
+/**
+ * notify_notification_set_hints:
+ * @notification: a #NotifyNotification
+ * @hints: the hints, as a `a{sv}` dictionary
+ *
+ * Sets all the hints of @hints at once, keeping the other hints of
+ * @notification.
+ *
+ * If @hints is floating, it is consumed.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_notification_set_hints (NotifyNotification *notification,
+                               GVariant           *hints)
+{
+        GVariantIter iter;
+        const char *key;
+        GVariant *value;
+
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        g_return_if_fail (hints != NULL);
+        g_return_if_fail (g_variant_is_of_type (hints, G_VARIANT_TYPE_VARDICT));
+
+        g_variant_ref_sink (hints);
+
+        g_variant_iter_init (&iter, hints);
+        while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+                if (*key != '\0') {
+                        set_hint_take (notification, key, value);
+                } else {
+                        g_variant_unref (value);
+                }
+        }
+
+        g_variant_unref (hints);
+}
+
+/**
+ * notify_notification_set_app_name:
+ * @notification: a #NotifyNotification
+ * @app_name: (nullable): the localised application name
+ *
+ * Sets the application name for the notification.
+ *
+ * If this function is not called or if @app_name is %NULL, the application name
+ * will be set from the value used in [func@init] or overridden with
+ * [func@set_app_name].
+ *
+ * Since: 0.7.3
+ */
+void
+notify_notification_set_app_name (NotifyNotification *notification,
+                                  const char         *app_name)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+
+        if (uses_portal (notification)) {
+                return;
+        }
+
+        g_clear_pointer (&priv->app_name, g_ref_string_release);
+        priv->app_name = app_name ? g_ref_string_new (app_name) : NULL;
+
+        g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_APP_NAME]);
+}
+
+/**
+ * notify_notification_set_app_icon:
+ * @notification: a #NotifyNotification
+ * @app_icon: (nullable): The optional icon theme icon name or filename.
+ *
+ * Sets the application icon for the notification.
+ *
+ * If this function is not called or if @app_icon is %NULL, the application icon
+ * will be set from the value set via [func@set_app_icon].
+ *
+ * Since: 0.8.4
+ */
+void
+notify_notification_set_app_icon (NotifyNotification *notification,
+                                  const char         *app_icon)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+
+        if (maybe_warn_portal_unsupported_feature ("App Icon")) {
+                return;
+        }
+
+        g_clear_pointer (&priv->app_icon, g_ref_string_release);
+        priv->app_icon = app_icon ? g_ref_string_new (app_icon) : NULL;
+
+        g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_APP_ICON]);
+}
+
+/**
+ * notify_notification_set_group_key:
+ * @notification: a #NotifyNotification
+ * @group_key: (nullable): The key of the group of the notification.
+ *
+ * Sets the key used to group this notification with other ones when
+ * grouping is enabled with [func@set_grouping].
+ *
+ * If set, it's used instead of the key derived from the grouping mode.
+ * The key is only used by libnotify and is not sent to the server.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_notification_set_group_key (NotifyNotification *notification,
+                                   const char         *group_key)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+
+        g_free (priv->group_key);
+        priv->group_key = g_strdup (group_key);
+}
+
+/*
+ * _notify_notification_get_group_key:
+ * @notification: The notification.
+ * @group_by: The grouping mode.
+ *
+ * Gets the key of the group @notification belongs to.
+ *
+ * Returns: (nullable): The group key, or %NULL if @notification can't be
+ *   grouped.
+ */
+const char *
+_notify_notification_get_group_key (NotifyNotification *notification,
+                                    NotifyGroupBy       group_by)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        if (priv->group_key != NULL) {
+                return priv->group_key;
+        }
+
+        switch (group_by) {
+        case NOTIFY_GROUP_BY_CATEGORY:
+                return _notify_notification_get_category (notification);
+
+        case NOTIFY_GROUP_BY_APP_NAME:
+                return priv->app_name ? priv->app_name
+                                      : _notify_client_get_app_name (priv->client);
+
+        default:
+                return NULL;
+        }
+}
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME        0x100000001b3ull
+
+static guint64
+hash_bytes (guint64       hash,
+            gconstpointer data,
+            gsize         size)
+{
+        const guint8 *bytes = data;
+
+        for (gsize i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+        }
+
+        return hash;
+}
+
+static guint64
+hash_string (guint64     hash,
+             const char *str)
+{
+        /* Include the terminator, so that consecutive strings are
+         * delimited, and distinguish NULL from empty strings */
+        if (str == NULL) {
+                return hash_bytes (hash, "\xff", 1);
         }
 
-        return variant;
+        return hash_bytes (hash, str, strlen (str) + 1);
 }
 
-static GVariant *
-maybe_parse_snap_hint_value (NotifyNotification *notification,
-                             const gchar *key,
-                             GVariant    *value)
+static int
+compare_hint_names (gconstpointer a,
+                    gconstpointer b)
 {
-        StringParserFunc parse_func = NULL;
+        return strcmp (*(const char **) a, *(const char **) b);
+}
 
-        if (!_notify_get_snap_path ())
-                return value;
+/*
+ * _notify_notification_get_content_hash:
+ * @notification: The notification.
+ *
+ * Computes a hash of what @notification shows: its application name,
+ * summary, body, icon, hints and actions.
+ *
+ * Returns: The content hash, never 0.
+ */
+guint64
+_notify_notification_get_content_hash (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        guint64 hash = FNV_OFFSET_BASIS;
+        const char **hint_names;
+        guint n_hints;
+
+        hash = hash_string (hash, priv->app_name);
+        hash = hash_string (hash, priv->app_icon);
+        hash = hash_string (hash, priv->summary);
+        hash = hash_string (hash, priv->body);
+        hash = hash_string (hash, priv->icon_name);
+
+        /* The hints order in the table is not stable */
+        if (priv->hints != NULL) {
+                hint_names = (const char **) g_hash_table_get_keys_as_array (priv->hints,
+                                                                             &n_hints);
+                qsort (hint_names, n_hints, sizeof (char *), compare_hint_names);
+
+                for (guint i = 0; i < n_hints; ++i) {
+                        GVariant *value = g_hash_table_lookup (priv->hints,
+                                                               hint_names[i]);
+
+                        hash = hash_string (hash, hint_names[i]);
+                        hash = hash_string (hash, g_variant_get_type_string (value));
+                        hash = hash_bytes (hash, g_variant_get_data (value),
+                                           g_variant_get_size (value));
+                }
 
-        if (g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_DESKTOP_ENTRY) == 0) {
-                parse_func = try_prepend_snap_desktop;
-        } else if (g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH) == 0 ||
-                   g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_IMAGE_PATH_LEGACY) == 0 ||
-                   g_strcmp0 (key, NOTIFY_NOTIFICATION_HINT_SOUND_FILE) == 0) {
-                parse_func = try_prepend_snap;
+                g_free (hint_names);
         }
 
-        if (parse_func == NULL) {
-                return value;
+        for (guint i = 0; priv->actions && i < priv->actions->actions->len; ++i) {
+                ActionInfo *ai = g_ptr_array_index (priv->actions->actions, i);
+
+                hash = hash_string (hash, ai->id);
+                hash = hash_string (hash, ai->label);
         }
 
-        return get_parsed_variant (notification, key, value, parse_func);
+        return hash != 0 ? hash : 1;
 }
 
-/**
- * notify_notification_set_hint:
- * @notification: a #NotifyNotification
- * @key: the hint key
- * @value: (nullable): the hint value
- *
- * Sets a hint for @key with value @value.
- *
- * If @value is %NULL, a previously set hint for @key is unset.
- *
- * If @value is floating, it is consumed.
+/*
+ * Computes a fingerprint of what showing @notification sends to the
+ * server that is currently running.
+ */
+static guint64
+get_show_fingerprint (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+        guint64 hash = _notify_notification_get_content_hash (notification);
+        guint serial = _notify_client_get_name_owner_serial (priv->client);
+
+        hash = hash_string (hash, _notify_client_get_app_name (priv->client));
+        hash = hash_bytes (hash, &priv->timeout, sizeof (priv->timeout));
+        hash = hash_bytes (hash, &serial, sizeof (serial));
+
+        return hash != 0 ? hash : 1;
+}
+
+/*
+ * _notify_notification_apply_template:
+ * @notification: A notification that was just created.
+ * @summary: The summary text.
+ * @body: (nullable): The body text.
+ * @icon_name: (nullable): The icon name.
+ * @app_name: (nullable): The application name, as a reference counted
+ *   string.
+ * @app_icon: (nullable): The application icon, as a reference counted
+ *   string.
+ * @timeout: The timeout.
+ * @hints: (nullable): The hints, shared until @notification changes them.
+ * @actions: (nullable): The actions, shared until @notification changes
+ *   them.
  *
- * Since: 0.6
+ * Sets the content of @notification from a template, without notifying
+ * the property changes.
  */
 void
-notify_notification_set_hint (NotifyNotification *notification,
-                              const char         *key,
-                              GVariant           *value)
+_notify_notification_apply_template (NotifyNotification *notification,
+                                     const char         *summary,
+                                     const char         *body,
+                                     const char         *icon_name,
+                                     char               *app_name,
+                                     char               *app_icon,
+                                     gint                timeout,
+                                     GHashTable         *hints,
+                                     NotifyActionSet    *actions)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
 
-        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
-        g_return_if_fail (key != NULL && *key != '\0');
+        if (body != NULL && *body == '\0') {
+                body = NULL;
+        }
 
-        if (value != NULL) {
-                value = maybe_parse_snap_hint_value (notification, key, value);
-                g_hash_table_insert (priv->hints,
-                                     g_strdup (key),
-                                     g_variant_ref_sink (value));
-        } else {
-                g_hash_table_remove (priv->hints, key);
+        set_text_fields (priv, summary, body, icon_name);
+
+        priv->app_name = app_name ? g_ref_string_acquire (app_name) : NULL;
+        priv->app_icon = app_icon ? g_ref_string_acquire (app_icon) : NULL;
+        priv->timeout = timeout;
+
+        if (hints != NULL) {
+                priv->hints = g_hash_table_ref (hints);
+                priv->hints_shared = TRUE;
+        }
+
+        if (actions != NULL) {
+                priv->actions = _notify_action_set_ref (actions);
+                priv->actions_shared = TRUE;
         }
 }
 
-/**
- * notify_notification_set_app_name:
- * @notification: a #NotifyNotification
- * @app_name: (nullable): the localised application name
- *
- * Sets the application name for the notification.
+/*
+ * _notify_notification_copy:
+ * @notification: The notification to copy.
+ * @client: (nullable): The client of the copy, or %NULL for the default
+ *   client.
  *
- * If this function is not called or if @app_name is %NULL, the application name
- * will be set from the value used in [func@init] or overridden with
- * [func@set_app_name].
+ * Creates a notification with the content of @notification, bound to
+ * @client. The copy shares the hints of @notification until either of
+ * them changes them, but not its actions, id or state.
  *
- * Since: 0.7.3
+ * Returns: (transfer full): The copy.
  */
-void
-notify_notification_set_app_name (NotifyNotification *notification,
-                                  const char         *app_name)
+NotifyNotification *
+_notify_notification_copy (NotifyNotification *notification,
+                           NotifyClient       *client)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
+        NotifyNotification *copy;
 
-        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        copy = g_object_new (NOTIFY_TYPE_NOTIFICATION,
+                             "client", client,
+                             NULL);
 
-        if (_notify_uses_portal_notifications ()) {
-                return;
+        _notify_notification_apply_template (copy,
+                                             priv->summary,
+                                             priv->body,
+                                             priv->icon_name,
+                                             priv->app_name,
+                                             priv->app_icon,
+                                             priv->timeout,
+                                             priv->hints,
+                                             NULL);
+
+        /* Copying a copy only reads it, so copies can be made from threads */
+        if (priv->hints != NULL && !priv->hints_shared) {
+                priv->hints_shared = TRUE;
         }
 
-        g_free (priv->app_name);
-        priv->app_name = g_strdup (app_name);
-
-        g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_APP_NAME]);
+        return copy;
 }
 
-/**
- * notify_notification_set_app_icon:
- * @notification: a #NotifyNotification
- * @app_icon: (nullable): The optional icon theme icon name or filename.
- *
- * Sets the application icon for the notification.
+/*
+ * _notify_notification_get_category:
+ * @notification: The notification.
  *
- * If this function is not called or if @app_icon is %NULL, the application icon
- * will be set from the value set via [func@set_app_icon].
+ * Returns: (nullable): The category of @notification, if it has one.
+ */
+const char *
+_notify_notification_get_category (NotifyNotification *notification)
+{
+        GVariant *category;
+
+        category = lookup_hint (notification, NOTIFY_NOTIFICATION_HINT_CATEGORY);
+        if (category != NULL &&
+            g_variant_is_of_type (category, G_VARIANT_TYPE_STRING)) {
+                return g_variant_get_string (category, NULL);
+        }
+
+        return NULL;
+}
+
+/*
+ * _notify_notification_is_persistent:
+ * @notification: The notification.
  *
- * Since: 0.8.4
+ * Returns: %TRUE if @notification stays shown until it's closed, that is
+ *   if it never expires or is resident.
  */
-void
-notify_notification_set_app_icon (NotifyNotification *notification,
-                                  const char         *app_icon)
+gboolean
+_notify_notification_is_persistent (NotifyNotification *notification)
 {
         NotifyNotificationPrivate *priv =
                 notify_notification_get_instance_private (notification);
-        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        GVariant *resident;
 
-        if (maybe_warn_portal_unsupported_feature ("App Icon")) {
-                return;
+        if (priv->timeout == NOTIFY_EXPIRES_NEVER) {
+                return TRUE;
         }
 
-        g_free (priv->app_icon);
-        priv->app_icon = g_strdup (app_icon);
+        resident = lookup_hint (notification, NOTIFY_NOTIFICATION_HINT_RESIDENT);
 
-        g_object_notify_by_pspec (G_OBJECT (notification), properties[PROP_APP_ICON]);
+        return resident != NULL &&
+               g_variant_is_of_type (resident, G_VARIANT_TYPE_BOOLEAN) &&
+               g_variant_get_boolean (resident);
+}
+
+/*
+ * _notify_notification_get_urgency:
+ * @notification: The notification.
+ *
+ * Returns: The urgency level of @notification.
+ */
+NotifyUrgency
+_notify_notification_get_urgency (NotifyNotification *notification)
+{
+        GVariant *urgency;
+
+        urgency = lookup_hint (notification, NOTIFY_NOTIFICATION_HINT_URGENCY);
+        if (urgency != NULL &&
+            g_variant_is_of_type (urgency, G_VARIANT_TYPE_BYTE)) {
+                return MIN (g_variant_get_byte (urgency), NOTIFY_URGENCY_CRITICAL);
+        }
+
+        return NOTIFY_URGENCY_NORMAL;
 }
 
 
@@ -1762,7 +3896,8 @@ notify_notification_clear_hints (NotifyNotification *notification)
 
         g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
 
-        g_hash_table_remove_all (priv->hints);
+        g_clear_pointer (&priv->hints, g_hash_table_unref);
+        priv->hints_shared = FALSE;
 }
 
 /**
@@ -1779,8 +3914,8 @@ notify_notification_clear_actions (NotifyNotification *notification)
 
         g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
 
-        g_clear_pointer (&priv->actions, g_ptr_array_unref);
-        priv->has_nondefault_actions = FALSE;
+        g_clear_pointer (&priv->actions, _notify_action_set_unref);
+        priv->actions_shared = FALSE;
 }
 
 /**
@@ -1807,8 +3942,6 @@ notify_notification_add_action (NotifyNotification  *notification,
                                 GFreeFunc            free_func)
 {
         NotifyNotificationPrivate *priv;
-        ActionInfo *action_info;
-        guint old_action_idx;
 
         g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
         g_return_if_fail (action != NULL && *action != '\0');
@@ -1817,25 +3950,106 @@ notify_notification_add_action (NotifyNotification  *notification,
 
         priv = notify_notification_get_instance_private (notification);
 
-        if (priv->actions == NULL) {
-                priv->actions = g_ptr_array_new_with_free_func (
-                        (GDestroyNotify) destroy_action_info);
-        } else if (find_action_info (notification, action, &old_action_idx)) {
-                g_ptr_array_remove_index (priv->actions, old_action_idx);
+        if (priv->actions_shared) {
+                NotifyActionSet *shared = priv->actions;
+
+                priv->actions = _notify_action_set_copy (shared);
+                priv->actions_shared = FALSE;
+                _notify_action_set_unref (shared);
         }
 
-        action_info = g_new0 (ActionInfo, 1);
-        action_info->id = g_strdup (action);
-        action_info->label = g_strdup (label);
-        action_info->cb = callback;
-        action_info->user_data = user_data;
-        action_info->free_func = free_func;
-        g_ptr_array_add (priv->actions, g_steal_pointer (&action_info));
+        priv->actions = _notify_action_set_add (priv->actions, action, label,
+                                                callback, user_data, free_func);
+}
+
+/**
+ * notify_notification_set_dispatch_context:
+ * @notification: The notification.
+ * @context: (nullable): The context to dispatch to, or %NULL.
+ *
+ * Sets the [struct@GLib.MainContext] where the action callbacks and the
+ * [signal@Notification::closed] signal of @notification are delivered,
+ * taking precedence over [func@set_dispatch_context] and
+ * [func@set_dispatch_thread_pool].
+ *
+ * The notification is kept alive until the callbacks ran. When they are
+ * delivered to another context than the one receiving the server signals,
+ * the [property@Notification:id] is already reset when the
+ * [signal@Notification::closed] signal is emitted.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_notification_set_dispatch_context (NotifyNotification *notification,
+                                          GMainContext       *context)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
 
-        if (!priv->has_nondefault_actions &&
-            g_ascii_strcasecmp (action, "default") != 0) {
-                priv->has_nondefault_actions = TRUE;
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+
+        if (context != NULL) {
+                g_main_context_ref (context);
         }
+
+        g_clear_pointer (&priv->dispatch_context, g_main_context_unref);
+        priv->dispatch_context = context;
+}
+
+/**
+ * notify_notification_get_client:
+ * @notification: The notification.
+ *
+ * Gets the client @notification is sent through.
+ *
+ * Returns: (transfer none): The client of @notification, the default
+ *   client unless it was created with [ctor@Client.new_notification].
+ *
+ * Since: 0.8.8
+ */
+NotifyClient *
+notify_notification_get_client (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), NULL);
+
+        return priv->client ? priv->client : notify_client_get_default ();
+}
+
+/*
+ * _notify_notification_get_client:
+ * @notification: The notification.
+ *
+ * Returns: (nullable) (transfer none): The client of @notification, or
+ *   %NULL for the default client.
+ */
+NotifyClient *
+_notify_notification_get_client (NotifyNotification *notification)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        return priv->client;
+}
+
+/*
+ * _notify_notification_get_proxy:
+ * @notification: The notification.
+ * @error: (nullable): a location to store a #GError, or %NULL
+ *
+ * Returns: (nullable) (transfer none): The proxy for the notification
+ *   server of the client of @notification, or %NULL on error.
+ */
+GDBusProxy *
+_notify_notification_get_proxy (NotifyNotification  *notification,
+                                GError             **error)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        return _notify_client_get_proxy (priv->client, error);
 }
 
 /**
@@ -1856,13 +4070,14 @@ notify_notification_add_action (NotifyNotification  *notification,
 const char *
 notify_notification_get_activation_token (NotifyNotification *notification)
 {
-        NotifyNotificationPrivate *priv =
-                notify_notification_get_instance_private (notification);
+        ActionActivation *activation;
 
         g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), NULL);
-        g_return_val_if_fail (priv->activating, NULL);
 
-        return priv->activation_token;
+        activation = get_current_activation (notification);
+        g_return_val_if_fail (activation != NULL, NULL);
+
+        return activation->activation_token;
 }
 
 /**
@@ -1888,11 +4103,8 @@ notify_notification_get_activation_token (NotifyNotification *notification)
 GAppLaunchContext *
 notify_notification_get_activation_app_launch_context (NotifyNotification *notification)
 {
-        NotifyNotificationPrivate *priv =
-                notify_notification_get_instance_private (notification);
-
         g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), NULL);
-        g_return_val_if_fail (priv->activating, NULL);
+        g_return_val_if_fail (get_current_activation (notification) != NULL, NULL);
 
         return notification_app_launch_context_new (notification);
 }
@@ -1905,7 +4117,72 @@ _notify_notification_has_nondefault_actions (const NotifyNotification *n)
 
         g_return_val_if_fail (NOTIFY_IS_NOTIFICATION ((NotifyNotification *) n), FALSE);
 
-        return priv->has_nondefault_actions;
+        return priv->actions != NULL && priv->actions->has_nondefault;
+}
+
+/*
+ * _notify_notification_prepare_close:
+ * @notification: The notification.
+ * @proxy: The proxy for the notification service.
+ * @out_method: (out): The method to call to close @notification.
+ *
+ * Computes the parameters of the D-Bus call that will close @notification.
+ *
+ * The call result must be passed to _notify_notification_finish_close().
+ *
+ * Returns: (transfer floating): The call parameters.
+ */
+GVariant *
+_notify_notification_prepare_close (NotifyNotification  *notification,
+                                    GDBusProxy          *proxy,
+                                    const char         **out_method)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        _notify_stats_count (NOTIFY_COUNTER_CLOSES, 1);
+
+        if (uses_portal (notification)) {
+                g_clear_handle_id (&priv->portal_timeout_id, g_source_remove);
+
+                *out_method = "RemoveNotification";
+                return g_variant_new ("(@s)",
+                                      g_variant_new_take_string (get_portal_notification_id (notification)));
+        }
+
+        *out_method = "CloseNotification";
+        return g_variant_new ("(u)", priv->id);
+}
+
+/*
+ * _notify_notification_finish_close:
+ * @notification: The notification.
+ * @result: (nullable): The result of the call, or %NULL if it failed.
+ *
+ * Completes closing @notification, using the result of the call prepared
+ * by _notify_notification_prepare_close().
+ *
+ * Returns: %TRUE if the notification was closed.
+ */
+gboolean
+_notify_notification_finish_close (NotifyNotification *notification,
+                                   GVariant           *result)
+{
+        if (result == NULL) {
+                return FALSE;
+        }
+
+        if (is_default_client (notification)) {
+                _notify_quota_untrack (notification);
+        }
+
+        /* The portal does not emit any signal when removing notifications */
+        if (uses_portal (notification)) {
+                close_notification (notification,
+                                    NOTIFY_CLOSED_REASON_API_REQUEST);
+        }
+
+        return TRUE;
 }
 
 /**
@@ -1921,41 +4198,78 @@ gboolean
 notify_notification_close (NotifyNotification *notification,
                            GError            **error)
 {
-        NotifyNotificationPrivate *priv;
-        GDBusProxy  *proxy;
-        GVariant   *result;
-
         g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
         g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-        priv = notify_notification_get_instance_private (notification);
+        return _notify_notification_get_backend (notification)->close (notification, error);
+}
 
-        proxy = _notify_get_proxy (error);
+/*
+ * _notify_dbus_close:
+ *
+ * Closes @notification through the notification server, or the portal.
+ */
+gboolean
+_notify_dbus_close (NotifyNotification *notification,
+                    GError            **error)
+{
+        GDBusProxy  *proxy;
+        GVariant    *parameters;
+        GVariant    *result;
+        const char  *method;
+        gboolean     ret;
+        gint64       start_time;
+        gint64       trace_begin;
+        GError      *local_error = NULL;
+
+        proxy = _notify_notification_get_proxy (notification, error);
         if (proxy == NULL) {
                 return FALSE;
         }
 
-        if (_notify_uses_portal_notifications ()) {
-                return remove_portal_notification (proxy, notification,
-                                                   NOTIFY_CLOSED_REASON_API_REQUEST,
-                                                   error);
+        if (is_default_client (notification) &&
+            _notify_spool_should_queue (proxy)) {
+                /* There's no server showing it, just drop it if queued */
+                _notify_spool_remove (notification);
+                return TRUE;
+        }
+
+        /* There's nothing to fall back to */
+        if (is_default_client (notification) && _notify_breaker_is_open ()) {
+                _notify_breaker_set_error (error);
+                return FALSE;
         }
 
+        parameters = _notify_notification_prepare_close (notification, proxy,
+                                                         &method);
+
         /* FIXME: make this nonblocking! */
+        NOTIFY_PROBE1 (close__begin, method);
+        trace_begin = NOTIFY_TRACE_TIME ();
+        start_time = g_get_monotonic_time ();
         result = g_dbus_proxy_call_sync (proxy,
-                                         "CloseNotification",
-                                         g_variant_new ("(u)", priv->id),
-                                         G_DBUS_CALL_FLAGS_NONE,
+                                         method,
+                                         parameters,
+                                         _notify_get_call_flags (),
                                          -1 /* FIXME! */,
                                          NULL,
-                                         error);
-        if (result == NULL) {
-                return FALSE;
+                                         &local_error);
+        if (is_default_client (notification)) {
+                _notify_breaker_record (start_time, local_error);
         }
+        _notify_stats_record_call (method, start_time, local_error);
+        NOTIFY_TRACE_MARK (trace_begin, method, "%s",
+                           local_error != NULL ? local_error->message : "done");
+        NOTIFY_PROBE2 (close__end, method, local_error == NULL);
 
-        g_variant_unref (result);
+        if (local_error != NULL) {
+                g_propagate_error (error, local_error);
+        }
 
-        return TRUE;
+        ret = _notify_notification_finish_close (notification, result);
+        g_clear_pointer (&result, g_variant_unref);
+
+        return ret;
 }
 
 /**
@@ -1982,3 +4296,34 @@ notify_notification_get_closed_reason (const NotifyNotification *notification)
 
         return priv->closed_reason;
 }
+
+/**
+ * notify_notification_get_timestamp:
+ * @notification: The notification.
+ * @timestamp: The step of the lifecycle of @notification.
+ *
+ * Gets when @notification reached the @timestamp step of its lifecycle,
+ * to measure how fast the server shows it and how long the user takes to
+ * react to it. Showing the notification again starts a new lifecycle.
+ *
+ * The durations of the lifecycles of all the notifications are also
+ * summarized by [func@get_statistics].
+ *
+ * Returns: The monotonic time of @timestamp, as returned by
+ *   [func@GLib.get_monotonic_time], or 0 if it didn't happen yet or is
+ *   not known, see #NotifyTimestamp.
+ *
+ * Since: 0.8.8
+ */
+gint64
+notify_notification_get_timestamp (NotifyNotification *notification,
+                                   NotifyTimestamp     timestamp)
+{
+        NotifyNotificationPrivate *priv =
+                notify_notification_get_instance_private (notification);
+
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), 0);
+        g_return_val_if_fail (timestamp <= NOTIFY_TIMESTAMP_CLOSED, 0);
+
+        return priv->timestamps[timestamp];
+}
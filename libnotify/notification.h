@@ -113,6 +113,32 @@ typedef enum
                 "Use 'NOTIFY_CLOSED_REASON_UNDEFINED' instead"))) = 4,
 } NotifyClosedReason;
 
+/**
+ * NotifyTimestamp:
+ * @NOTIFY_TIMESTAMP_SHOW_REQUESTED: When the notification was last asked
+ *   to be shown.
+ * @NOTIFY_TIMESTAMP_ACKNOWLEDGED: When the server replied that it showed
+ *   the notification.
+ * @NOTIFY_TIMESTAMP_ACTION_INVOKED: When the first action or activation
+ *   token was received since the notification was shown.
+ * @NOTIFY_TIMESTAMP_CLOSED: When the notification was closed.
+ *
+ * The steps of the lifecycle of a notification whose time is recorded,
+ * see [method@Notification.get_timestamp].
+ *
+ * The actions and the closing are only recorded for notifications that
+ * follow the signals of the server, see [method@Notification.show].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_TIMESTAMP_SHOW_REQUESTED,
+        NOTIFY_TIMESTAMP_ACKNOWLEDGED,
+        NOTIFY_TIMESTAMP_ACTION_INVOKED,
+        NOTIFY_TIMESTAMP_CLOSED,
+} NotifyTimestamp;
+
 /**
  * NotifyActionCallback:
  * @notification: a #NotifyActionCallback notification
@@ -144,9 +170,26 @@ gboolean            notify_notification_update                (NotifyNotificatio
                                                                const char         *body,
                                                                const char         *icon);
 
+gboolean            notify_notification_update_full           (NotifyNotification *notification,
+                                                               const char         *summary,
+                                                               const char         *body,
+                                                               const char         *icon,
+                                                               gint                timeout,
+                                                               NotifyUrgency       urgency,
+                                                               GVariant           *hints);
+
 gboolean            notify_notification_show                  (NotifyNotification *notification,
                                                                GError            **error);
 
+void                notify_notification_show_async            (NotifyNotification  *notification,
+                                                               GCancellable        *cancellable,
+                                                               GAsyncReadyCallback  callback,
+                                                               gpointer             user_data);
+
+gboolean            notify_notification_show_finish           (NotifyNotification  *notification,
+                                                               GAsyncResult        *result,
+                                                               GError             **error);
+
 void                notify_notification_set_timeout           (NotifyNotification *notification,
                                                                gint                timeout);
 
@@ -192,12 +235,18 @@ void                notify_notification_set_hint              (NotifyNotificatio
                                                                const char         *key,
                                                                GVariant           *value);
 
+void                notify_notification_set_hints             (NotifyNotification *notification,
+                                                               GVariant           *hints);
+
 void                notify_notification_set_app_name          (NotifyNotification *notification,
                                                                const char         *app_name);
 
 void                notify_notification_set_app_icon          (NotifyNotification *notification,
                                                                const char         *app_icon);
 
+void                notify_notification_set_group_key         (NotifyNotification *notification,
+                                                               const char         *group_key);
+
 void                notify_notification_clear_hints           (NotifyNotification *notification);
 
 void                notify_notification_add_action            (NotifyNotification *notification,
@@ -211,10 +260,16 @@ const char         *notify_notification_get_activation_token  (NotifyNotificatio
 
 GAppLaunchContext  *notify_notification_get_activation_app_launch_context (NotifyNotification *notification);
 
+void                notify_notification_set_dispatch_context  (NotifyNotification *notification,
+                                                               GMainContext       *context);
+
 void                notify_notification_clear_actions         (NotifyNotification *notification);
 gboolean            notify_notification_close                 (NotifyNotification *notification,
                                                                GError            **error);
 
 gint                notify_notification_get_closed_reason     (const NotifyNotification *notification);
 
+gint64              notify_notification_get_timestamp         (NotifyNotification *notification,
+                                                               NotifyTimestamp     timestamp);
+
 G_END_DECLS
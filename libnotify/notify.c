@@ -34,17 +34,75 @@
 #include "notify.h"
 #include "internal.h"
 
+#define DEFAULT_UNINIT_TIMEOUT 2000
+
 static gboolean         _initted = FALSE;
 static char            *_app_name = NULL;
 static char            *_app_icon = NULL;
 static char            *_snap_name = NULL;
 static char            *_snap_app = NULL;
 static char            *_flatpak_app = NULL;
+static GDBusConnection *_connection = NULL;
 static GDBusProxy      *_proxy = NULL;
 static GList           *_active_notifications = NULL;
+static guint            _name_owner_serial = 0;
 static int              _spec_version_major = 0;
 static int              _spec_version_minor = 0;
 static int              _portal_version = 0;
+static guint            _uninit_timeout = DEFAULT_UNINIT_TIMEOUT;
+
+/* The capabilities of the server, if known */
+static char           **_server_caps = NULL;
+/* Set while the server information is refreshed */
+static GCancellable    *_refresh_cancellable = NULL;
+/* Where the replies of the refresh are dispatched */
+static GMainContext    *_refresh_context = NULL;
+static guint            _refresh_pending = 0;
+static gint64           _refresh_start_time = 0;
+
+gboolean
+_notify_has_spec_version (void)
+{
+        return _spec_version_major > 0;
+}
+
+/*
+ * _notify_parse_spec_version:
+ * @spec_version: The specification version returned by the server.
+ * @major: (out): Where to store the major version, or 0 if unknown.
+ * @minor: (out): Where to store the minor version, or 0 if unknown.
+ */
+void
+_notify_parse_spec_version (const char *spec_version,
+                            int        *major,
+                            int        *minor)
+{
+        g_debug ("Server spec version is '%s'", spec_version);
+
+        *major = 0;
+        *minor = 0;
+
+        sscanf (spec_version, "%d.%d", major, minor);
+}
+
+/*
+ * _notify_spec_version_is_at_least:
+ *
+ * Returns: %TRUE if the version @server_major.@server_minor of the
+ *   specification is at least @major.@minor.
+ */
+gboolean
+_notify_spec_version_is_at_least (int server_major,
+                                  int server_minor,
+                                  int major,
+                                  int minor)
+{
+        if (server_major != major) {
+                return server_major > major;
+        }
+
+        return server_minor >= minor;
+}
 
 gboolean
 _notify_check_spec_version (int major,
@@ -52,22 +110,77 @@ _notify_check_spec_version (int major,
 {
         g_assert (_spec_version_major > 0);
 
-       if (_spec_version_major > major)
-               return TRUE;
-       if (_spec_version_major < major)
-               return FALSE;
-       return _spec_version_minor >= minor;
+        return _notify_spec_version_is_at_least (_spec_version_major,
+                                                 _spec_version_minor,
+                                                 major, minor);
 }
 
-static gboolean
-_notify_get_server_info (char **ret_name,
-                         char **ret_vendor,
-                         char **ret_version,
-                         char **ret_spec_version,
-                         GError **error)
+/*
+ * _notify_proxy_get_server_info:
+ * @proxy: A proxy for a notification server.
+ *
+ * Calls GetServerInformation on the notification server of @proxy.
+ *
+ * Returns: %FALSE on error.
+ */
+gboolean
+_notify_proxy_get_server_info (GDBusProxy  *proxy,
+                               char       **ret_name,
+                               char       **ret_vendor,
+                               char       **ret_version,
+                               char       **ret_spec_version,
+                               GError     **error)
+{
+        GVariant *result;
+        GError   *local_error = NULL;
+        gint64    start_time;
+
+        start_time = g_get_monotonic_time ();
+        result = g_dbus_proxy_call_sync (proxy,
+                                         "GetServerInformation",
+                                         g_variant_new ("()"),
+                                         _notify_get_call_flags (),
+                                         -1 /* FIXME shorter timeout? */,
+                                         NULL,
+                                         &local_error);
+        _notify_stats_record_call ("GetServerInformation", start_time,
+                                   local_error);
+        if (result == NULL) {
+                g_propagate_error (error, local_error);
+                return FALSE;
+        }
+        if (!g_variant_is_of_type (result, G_VARIANT_TYPE ("(ssss)"))) {
+                g_variant_unref (result);
+                g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                             "Unexpected reply type");
+                return FALSE;
+        }
+
+        g_variant_get (result, "(ssss)",
+                       ret_name,
+                       ret_vendor,
+                       ret_version,
+                       ret_spec_version);
+        g_variant_unref (result);
+        return TRUE;
+}
+
+/*
+ * _notify_dbus_get_server_info:
+ *
+ * Gets the information of the notification server, or of the portal.
+ */
+gboolean
+_notify_dbus_get_server_info (char **ret_name,
+                              char **ret_vendor,
+                              char **ret_version,
+                              char **ret_spec_version,
+                              GError **error)
 {
         GDBusProxy *proxy;
-        GVariant   *result;
+        gboolean    ret;
+        gint64      start_time;
+        GError     *local_error = NULL;
 
         proxy = _notify_get_proxy (error);
         if (proxy == NULL) {
@@ -94,30 +207,32 @@ _notify_get_server_info (char **ret_name,
                 return TRUE;
         }
 
-        result = g_dbus_proxy_call_sync (proxy,
-                                         "GetServerInformation",
-                                         g_variant_new ("()"),
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1 /* FIXME shorter timeout? */,
-                                         NULL,
-                                         error);
-        if (result == NULL) {
+        if (_notify_breaker_is_open ()) {
+                _notify_breaker_set_error (error);
                 return FALSE;
         }
-        if (!g_variant_is_of_type (result, G_VARIANT_TYPE ("(ssss)"))) {
-                g_variant_unref (result);
-                g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
-                             "Unexpected reply type");
-                return FALSE;
+
+        start_time = g_get_monotonic_time ();
+        ret = _notify_proxy_get_server_info (proxy,
+                                             ret_name,
+                                             ret_vendor,
+                                             ret_version,
+                                             ret_spec_version,
+                                             &local_error);
+        _notify_breaker_record (start_time, local_error);
+        if (!ret) {
+                g_propagate_error (error, local_error);
         }
 
-        g_variant_get (result, "(ssss)",
-                       ret_name,
-                       ret_vendor,
-                       ret_version,
-                       ret_spec_version);
-        g_variant_unref (result);
-        return TRUE;
+        return ret;
+}
+
+static void
+set_spec_version (const char *spec_version)
+{
+        _notify_parse_spec_version (spec_version,
+                                    &_spec_version_major,
+                                    &_spec_version_minor);
 }
 
 static gboolean
@@ -125,19 +240,13 @@ _notify_update_spec_version (GError **error)
 {
        char *spec_version;
 
-       if (!_notify_get_server_info (NULL, NULL, NULL, &spec_version, error)) {
+       if (!_notify_dbus_get_server_info (NULL, NULL, NULL, &spec_version, error)) {
                 _spec_version_major = 0;
                 _spec_version_minor = 0;
                return FALSE;
        }
 
-       g_debug ("Server spec version is '%s'", spec_version);
-
-       sscanf (spec_version,
-               "%d.%d",
-               &_spec_version_major,
-               &_spec_version_minor);
-
+       set_spec_version (spec_version);
        g_free (spec_version);
 
        return TRUE;
@@ -184,6 +293,48 @@ notify_set_app_icon (const char *app_icon)
         _app_icon = g_strdup (app_icon);
 }
 
+/**
+ * notify_init_with_connection:
+ * @app_name: (nullable): The name of the application initializing libnotify.
+ * @connection: The connection to the notification server.
+ *
+ * Initializes libnotify like [func@init], but talking to the notification
+ * server over @connection rather than over the session bus, until
+ * [func@uninit] is called.
+ *
+ * @connection can be a message bus connection the application already
+ * holds, so that it's shared, or a peer-to-peer connection to the
+ * notification server itself, skipping the bus. In the latter case, there
+ * is no portal support and the notifications are never spooled.
+ *
+ * A peer-to-peer connection can also be used without changing the
+ * application, by setting the `NOTIFY_BUS_ADDRESS` environment variable
+ * to the D-Bus address of the notification server.
+ *
+ * Returns: %TRUE if successful, or %FALSE on error, or if libnotify was
+ *   already initialized with another connection.
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_init_with_connection (const char      *app_name,
+                             GDBusConnection *connection)
+{
+        g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), FALSE);
+
+        if (_initted) {
+                return _connection == connection;
+        }
+
+        if (!notify_init (app_name)) {
+                return FALSE;
+        }
+
+        g_set_object (&_connection, connection);
+
+        return TRUE;
+}
+
 /**
  * notify_init:
  * @app_name: (nullable): The name of the application initializing libnotify.
@@ -426,6 +577,15 @@ _notify_is_running_in_sandbox (void)
                 FORCE_PORTAL = 3
         };
 
+        switch (_notify_get_backend_type ()) {
+        case NOTIFY_BACKEND_FDO:
+                return FALSE;
+        case NOTIFY_BACKEND_PORTAL:
+                return TRUE;
+        default:
+                break;
+        }
+
         if (g_once_init_enter (&use_portal)) {
                 if (G_UNLIKELY (g_getenv ("NOTIFY_IGNORE_PORTAL"))) {
                         g_once_init_leave (&use_portal, IGNORE_PORTAL);
@@ -480,6 +640,67 @@ notify_get_app_icon (void)
         return _app_icon;
 }
 
+static void
+on_uninit_closed (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+        gboolean *done = user_data;
+        GError *error = NULL;
+
+        if (!notify_batch_submit_finish (NOTIFY_BATCH (source), result, &error)) {
+                g_debug ("Failed to close the notifications: %s",
+                         error->message);
+                g_error_free (error);
+        }
+
+        *done = TRUE;
+}
+
+static gboolean
+on_uninit_timeout (gpointer user_data)
+{
+        g_cancellable_cancel (user_data);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * Closes the notifications of @batch, waiting for the replies until the
+ * uninit timeout at most. The requests are sent anyways.
+ */
+static void
+uninit_close_notifications (NotifyBatch *batch)
+{
+        GMainContext *context;
+        GCancellable *cancellable;
+        GSource *timeout_source;
+        gboolean done = FALSE;
+
+        /* Only the replies are dispatched while waiting */
+        context = g_main_context_new ();
+        g_main_context_push_thread_default (context);
+
+        cancellable = g_cancellable_new ();
+        timeout_source = g_timeout_source_new (_uninit_timeout);
+        g_source_set_callback (timeout_source, on_uninit_timeout,
+                               cancellable, NULL);
+        g_source_attach (timeout_source, context);
+
+        notify_batch_submit (batch, cancellable, on_uninit_closed, &done);
+
+        while (!done) {
+                g_main_context_iteration (context, TRUE);
+        }
+
+        g_source_destroy (timeout_source);
+        g_source_unref (timeout_source);
+        g_object_unref (cancellable);
+
+        g_main_context_pop_thread_default (context);
+        g_main_context_unref (context);
+}
+
 /**
  * notify_uninit:
  *
@@ -487,37 +708,99 @@ notify_get_app_icon (void)
  *
  * This should be called when the program no longer needs libnotify for
  * the rest of its lifecycle, typically just before exitting.
+ *
+ * The notifications that never expire or that have actions are closed,
+ * without waiting for the server longer than the timeout set with
+ * [func@set_uninit_timeout].
  */
 void
 notify_uninit (void)
 {
+        NotifyBatch *batch;
+        GList *live;
         GList *l;
 
         if (!_initted) {
                 return;
         }
 
-        g_clear_pointer (&_app_name, g_free);
+        _notify_grouping_flush ();
+        _notify_scheduler_clear ();
+
+        /* Keep the live notifications alive while closing them */
+        live = _notify_quota_steal ();
+
+        /* All the closings are sent at once, as a single round trip */
+        batch = notify_batch_new ();
 
         for (l = _active_notifications; l != NULL; l = l->next) {
                 NotifyNotification *n = NOTIFY_NOTIFICATION (l->data);
 
                 if (_notify_notification_get_timeout (n) == 0 ||
                     _notify_notification_has_nondefault_actions (n)) {
-                        notify_notification_close (n, NULL);
+                        notify_batch_add_close (batch, n);
                 }
+        }
+
+        if (notify_batch_get_n_items (batch) > 0) {
+                uninit_close_notifications (batch);
+        }
+
+        g_object_unref (batch);
+
+        for (l = _active_notifications; l != NULL; l = l->next) {
+                g_object_run_dispose (G_OBJECT (l->data));
+        }
+
+        g_list_free_full (live, g_object_unref);
+
+        g_clear_pointer (&_app_name, g_free);
+
+        if (_proxy != NULL) {
+                /* Don't lose messages sent without expecting a reply */
+                g_dbus_connection_flush_sync (g_dbus_proxy_get_connection (_proxy),
+                                              NULL, NULL);
+        }
+
+        _notify_spool_clear ();
 
-                g_object_run_dispose (G_OBJECT (n));
+        if (_refresh_cancellable != NULL) {
+                g_cancellable_cancel (_refresh_cancellable);
+                g_clear_object (&_refresh_cancellable);
+                g_clear_pointer (&_refresh_context, g_main_context_unref);
         }
+        g_clear_pointer (&_server_caps, g_strfreev);
+        _notify_backend_clear ();
 
         g_clear_object (&_proxy);
+        g_clear_object (&_connection);
         g_clear_pointer (&_snap_name, g_free);
         g_clear_pointer (&_snap_app, g_free);
         g_clear_pointer (&_flatpak_app, g_free);
 
+        _notify_stats_dump ();
+
         _initted = FALSE;
 }
 
+/**
+ * notify_set_uninit_timeout:
+ * @timeout: The timeout, in milliseconds.
+ *
+ * Sets how long [func@uninit] waits at most for the notification server
+ * to confirm that the notifications were closed, 2 seconds by default.
+ *
+ * With a timeout of 0 the notifications are still closed, but without
+ * waiting for the server.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_uninit_timeout (guint timeout)
+{
+        _uninit_timeout = timeout;
+}
+
 /**
  * notify_is_initted:
  *
@@ -538,7 +821,7 @@ _get_portal_proxy (GError **error)
         GDBusProxy *proxy;
         GVariant *res;
 
-        proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
+        proxy = g_dbus_proxy_new_sync (_connection,
                                                G_DBUS_PROXY_FLAGS_NONE,
                                                NULL,
                                                NOTIFY_PORTAL_DBUS_NAME,
@@ -571,23 +854,277 @@ _get_portal_proxy (GError **error)
         return proxy;
 }
 
+/*
+ * Sends what was waiting for a server, now that its information is known.
+ */
+static void
+refresh_done (void)
+{
+        g_clear_object (&_refresh_cancellable);
+        g_clear_pointer (&_refresh_context, g_main_context_unref);
+        _refresh_pending = 0;
+
+        _notify_spool_replay (_proxy);
+        _notify_outbox_flush_once (_proxy);
+        _notify_scheduler_resume ();
+}
+
+static void
+on_server_info_ready (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data,
+                      const char   *method)
+{
+        GError *error = NULL;
+        GVariant *result;
+
+        result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+        _notify_stats_record_call (method, _refresh_start_time, error);
+
+        /* A newer refresh started, or the refresh was completed already */
+        if (user_data != _refresh_cancellable) {
+                g_clear_error (&error);
+                g_clear_pointer (&result, g_variant_unref);
+                return;
+        }
+
+        _notify_breaker_record (_refresh_start_time, error);
+
+        if (result != NULL &&
+            g_variant_is_of_type (result, G_VARIANT_TYPE ("(ssss)"))) {
+                const char *spec_version;
+
+                g_variant_get (result, "(&s&s&s&s)",
+                               NULL, NULL, NULL, &spec_version);
+                set_spec_version (spec_version);
+        } else if (result != NULL &&
+                   g_variant_is_of_type (result, G_VARIANT_TYPE ("(as)"))) {
+                g_strfreev (_server_caps);
+                g_variant_get (result, "(^as)", &_server_caps);
+        } else {
+                g_warning ("Failed to refresh the server information: %s",
+                           error ? error->message : "Unexpected reply type");
+        }
+
+        g_clear_error (&error);
+        g_clear_pointer (&result, g_variant_unref);
+
+        if (--_refresh_pending == 0) {
+                refresh_done ();
+        }
+}
+
+static void
+on_refresh_info_ready (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+        on_server_info_ready (source, res, user_data, "GetServerInformation");
+}
+
+static void
+on_refresh_caps_ready (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+        on_server_info_ready (source, res, user_data, "GetCapabilities");
+}
+
 static void
 on_name_owner_changed (GDBusProxy *proxy)
 {
-        g_autoptr(GError) error = NULL;
         g_autofree char *name_owner = NULL;
 
         name_owner = g_dbus_proxy_get_name_owner (_proxy);
+        _name_owner_serial++;
+
+        g_clear_pointer (&_server_caps, g_strfreev);
+
+        if (_refresh_cancellable != NULL) {
+                g_cancellable_cancel (_refresh_cancellable);
+                g_clear_object (&_refresh_cancellable);
+                g_clear_pointer (&_refresh_context, g_main_context_unref);
+        }
+
+        _spec_version_major = 0;
+        _spec_version_minor = 0;
 
         if (!name_owner) {
-                _spec_version_major = 0;
-                _spec_version_minor = 0;
                 return;
         }
 
+        /* The portal answers for the server, see
+         * _notify_dbus_get_server_info() */
+        if (_notify_uses_portal_notifications ()) {
+                set_spec_version ("1.2");
+                refresh_done ();
+                return;
+        }
+
+        /* Like the synchronous queries, the refresh is skipped while the
+         * server is deemed unavailable, and the version stays unknown */
+        if (_notify_breaker_is_open ()) {
+                refresh_done ();
+                return;
+        }
+
+        /* Blocking here would stall the main loop while the new server
+         * starts, so the notifications wait for the refresh instead */
+        _refresh_cancellable = g_cancellable_new ();
+        _refresh_context = g_main_context_ref_thread_default ();
+        _refresh_pending = 2;
+        _refresh_start_time = g_get_monotonic_time ();
+
+        g_dbus_proxy_call (_proxy,
+                           "GetServerInformation",
+                           g_variant_new ("()"),
+                           _notify_get_call_flags (),
+                           -1,
+                           _refresh_cancellable,
+                           on_refresh_info_ready,
+                           _refresh_cancellable);
+        g_dbus_proxy_call (_proxy,
+                           "GetCapabilities",
+                           g_variant_new ("()"),
+                           _notify_get_call_flags (),
+                           -1,
+                           _refresh_cancellable,
+                           on_refresh_caps_ready,
+                           _refresh_cancellable);
+}
+
+/*
+ * _notify_is_refreshing_server_info:
+ *
+ * Returns: %TRUE while the information of a new server is queried.
+ */
+gboolean
+_notify_is_refreshing_server_info (void)
+{
+        return _refresh_cancellable != NULL;
+}
+
+/*
+ * _notify_wait_server_info:
+ *
+ * Completes the pending refresh of the server information, if any,
+ * synchronously.
+ */
+void
+_notify_wait_server_info (void)
+{
+        GError *error = NULL;
+
+        if (_refresh_cancellable == NULL) {
+                return;
+        }
+
+        /* Wait for the replies of the server that is starting, rather
+         * than asking it again */
+        if (g_main_context_acquire (_refresh_context)) {
+                GMainContext *context = g_main_context_ref (_refresh_context);
+
+                while (_refresh_cancellable != NULL) {
+                        g_main_context_iteration (context, TRUE);
+                }
+
+                g_main_context_release (context);
+                g_main_context_unref (context);
+                return;
+        }
+
+        /* Another thread dispatches them: query the server here */
+        g_cancellable_cancel (_refresh_cancellable);
+        g_clear_object (&_refresh_cancellable);
+        g_clear_pointer (&_refresh_context, g_main_context_unref);
+
         if (!_notify_update_spec_version (&error)) {
                 g_warning ("Failed to update the spec version: %s", error->message);
+                g_error_free (error);
+        }
+
+        refresh_done ();
+}
+
+/*
+ * _notify_get_name_owner_serial:
+ *
+ * Gets a number changing each time the owner of the notification service
+ * name changes, after which the ids of the notifications shown before are
+ * meaningless.
+ *
+ * Returns: The name owner serial.
+ */
+guint
+_notify_get_name_owner_serial (void)
+{
+        return _name_owner_serial;
+}
+
+/*
+ * Gets the connection to talk to the notification server over: the one
+ * passed to notify_init_with_connection(), a peer-to-peer connection to
+ * the address in NOTIFY_BUS_ADDRESS, or the session bus.
+ */
+static GDBusConnection *
+get_connection (GError **error)
+{
+        const char *address;
+
+        if (_connection != NULL) {
+                return _connection;
+        }
+
+        address = g_getenv ("NOTIFY_BUS_ADDRESS");
+
+        if (address != NULL && *address != '\0') {
+                _connection = g_dbus_connection_new_for_address_sync (address,
+                                                                      G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                                                      NULL,
+                                                                      NULL,
+                                                                      error);
+        } else {
+                _connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, error);
         }
+
+        return _connection;
+}
+
+/*
+ * _notify_proxy_new:
+ * @connection: A message bus connection, or a peer-to-peer connection
+ *   to a notification server.
+ * @error: (nullable): a location to store a #GError, or %NULL
+ *
+ * Synchronously creates a #GDBusProxy for the notification server on
+ * @connection.
+ *
+ * Returns: (transfer full) (nullable): the new #GDBusProxy, or %NULL on error
+ */
+GDBusProxy *
+_notify_proxy_new (GDBusConnection  *connection,
+                   GError          **error)
+{
+        GDBusProxyFlags flags = G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES;
+        gboolean peer;
+
+        /* Also the case when spooling: the spool decides whether to
+         * queue the notifications or to start the server */
+        if (_notify_get_call_flags () & G_DBUS_CALL_FLAGS_NO_AUTO_START) {
+                flags |= G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START;
+        }
+
+        /* Peer-to-peer connections have no bus name to talk to */
+        peer = g_dbus_connection_get_unique_name (connection) == NULL;
+
+        return g_dbus_proxy_new_sync (connection,
+                                      flags,
+                                      NULL,
+                                      peer ? NULL : NOTIFY_DBUS_NAME,
+                                      NOTIFY_DBUS_CORE_OBJECT,
+                                      NOTIFY_DBUS_CORE_INTERFACE,
+                                      NULL,
+                                      error);
 }
 
 /*
@@ -602,32 +1139,61 @@ on_name_owner_changed (GDBusProxy *proxy)
 GDBusProxy *
 _notify_get_proxy (GError **error)
 {
+        GError *local_error = NULL;
+        gint64 start_time;
+        gboolean peer;
+
         if (_proxy != NULL)
                 return _proxy;
 
-        if (_notify_is_running_in_sandbox ()) {
+        if (!_notify_get_backend ()->uses_dbus) {
+                g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             "The %s backend doesn't use D-Bus",
+                             _notify_get_backend ()->name);
+                return NULL;
+        }
+
+        /* Creating the proxy can block as long as a call */
+        if (_notify_breaker_is_blocking ()) {
+                _notify_breaker_set_error (error);
+                return NULL;
+        }
+
+        if (!get_connection (error)) {
+                return NULL;
+        }
+
+        /* Without a bus there's no portal */
+        peer = g_dbus_connection_get_unique_name (_connection) == NULL;
+
+        if (!peer && _notify_is_running_in_sandbox ()) {
                 _proxy = _get_portal_proxy (error);
 
-                if (_proxy != NULL) {
+                if (_proxy != NULL ||
+                    _notify_get_backend_type () == NOTIFY_BACKEND_PORTAL) {
                         goto out;
                 }
         }
 
-        _proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
-                                                NULL,
-                                                NOTIFY_DBUS_NAME,
-                                                NOTIFY_DBUS_CORE_OBJECT,
-                                                NOTIFY_DBUS_CORE_INTERFACE,
-                                                NULL,
-                                                error);
+        start_time = g_get_monotonic_time ();
+        _proxy = _notify_proxy_new (_connection, &local_error);
+
+        /* Its success says nothing about the server, only its failure */
+        if (local_error != NULL) {
+                _notify_breaker_record (start_time, local_error);
+                g_propagate_error (error, local_error);
+        }
 
 out:
         if (_proxy == NULL) {
                 return NULL;
         }
 
-        if (!_notify_update_spec_version (error)) {
+        if (_notify_spool_should_queue (_proxy)) {
+                /* No server is running: notifications are spooled until
+                 * one appears, and its version is queried at that point */
+                g_debug ("No notification server is running, spooling");
+        } else if (!_notify_update_spec_version (error)) {
                g_clear_object (&_proxy);
                return NULL;
         }
@@ -636,25 +1202,67 @@ out:
         g_signal_connect (_proxy, "notify::name-owner",
                           G_CALLBACK (on_name_owner_changed), NULL);
 
+        if (!_notify_spool_should_queue (_proxy)) {
+                _notify_outbox_flush_once (_proxy);
+        }
+
         return _proxy;
 }
 
-/**
- * notify_get_server_caps:
+/*
+ * _notify_proxy_get_server_caps:
+ * @proxy: A proxy for a notification server.
+ * @error: (nullable): a location to store a #GError, or %NULL
  *
- * Queries the server capabilities.
+ * Calls GetCapabilities on the notification server of @proxy.
  *
- * Synchronously queries the server for its capabilities and returns them in a
- * list.
+ * Returns: (transfer full) (nullable): The capabilities, or %NULL on error.
+ */
+char **
+_notify_proxy_get_server_caps (GDBusProxy  *proxy,
+                               GError     **error)
+{
+        GVariant *result;
+        GError   *local_error = NULL;
+        gint64    start_time;
+        char    **caps;
+
+        start_time = g_get_monotonic_time ();
+        result = g_dbus_proxy_call_sync (proxy,
+                                         "GetCapabilities",
+                                         g_variant_new ("()"),
+                                         _notify_get_call_flags (),
+                                         -1 /* FIXME shorter timeout? */,
+                                         NULL,
+                                         &local_error);
+        _notify_stats_record_call ("GetCapabilities", start_time, local_error);
+        if (result == NULL) {
+                g_propagate_error (error, local_error);
+                return NULL;
+        }
+        if (!g_variant_is_of_type (result, G_VARIANT_TYPE ("(as)"))) {
+                g_variant_unref (result);
+                g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                             "Unexpected reply type");
+                return NULL;
+        }
+
+        g_variant_get (result, "(^as)", &caps);
+        g_variant_unref (result);
+
+        return caps;
+}
+
+/*
+ * _notify_dbus_get_server_caps:
  *
- * Returns: (transfer full) (element-type utf8): a list of server capability strings.
+ * Gets the capabilities of the notification server, or of the portal.
  */
 GList *
-notify_get_server_caps (void)
+_notify_dbus_get_server_caps (void)
 {
         GDBusProxy *proxy;
-        GVariant   *result;
-        char      **cap, **caps;
+        char      **cap;
         GList      *list = NULL;
 
         proxy = _notify_get_proxy (NULL);
@@ -672,33 +1280,49 @@ notify_get_server_caps (void)
                 return list;
         }
 
-        result = g_dbus_proxy_call_sync (proxy,
-                                         "GetCapabilities",
-                                         g_variant_new ("()"),
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1 /* FIXME shorter timeout? */,
-                                         NULL,
-                                         NULL);
-        if (result == NULL) {
-                return NULL;
-        }
-        if (!g_variant_is_of_type (result, G_VARIANT_TYPE ("(as)"))) {
-                g_variant_unref (result);
-                return NULL;
-        }
+        _notify_wait_server_info ();
 
-        g_variant_get (result, "(^as)", &caps);
+        if (_server_caps == NULL) {
+                GError *error = NULL;
+                gint64 start_time;
+
+                if (_notify_breaker_is_open ()) {
+                        return NULL;
+                }
 
-        for (cap = caps; *cap != NULL; cap++) {
-                list = g_list_prepend (list, *cap);
+                start_time = g_get_monotonic_time ();
+                _server_caps = _notify_proxy_get_server_caps (proxy, &error);
+                _notify_breaker_record (start_time, error);
+                g_clear_error (&error);
+
+                if (_server_caps == NULL) {
+                        return NULL;
+                }
         }
 
-        g_free (caps);
-        g_variant_unref (result);
+        for (cap = _server_caps; *cap != NULL; cap++) {
+                list = g_list_prepend (list, g_strdup (*cap));
+        }
 
         return g_list_reverse (list);
 }
 
+/**
+ * notify_get_server_caps:
+ *
+ * Queries the server capabilities.
+ *
+ * Synchronously queries the server for its capabilities and returns them in a
+ * list. The capabilities are cached until the server changes.
+ *
+ * Returns: (transfer full) (element-type utf8): a list of server capability strings.
+ */
+GList *
+notify_get_server_caps (void)
+{
+        return _notify_get_backend ()->get_server_caps ();
+}
+
 /**
  * notify_get_server_info:
  * @ret_name: (out) (optional) (transfer full): a location to store the server name, or %NULL
@@ -721,7 +1345,7 @@ notify_get_server_info (char **ret_name,
                         char **ret_version,
                         char **ret_spec_version)
 {
-        return _notify_get_server_info (ret_name, ret_vendor, ret_version, ret_spec_version, NULL);
+        return _notify_get_backend ()->get_server_info (ret_name, ret_vendor, ret_version, ret_spec_version, NULL);
 }
 
 void
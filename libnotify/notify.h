@@ -23,15 +23,132 @@
 #define _LIBNOTIFY_NOTIFY_H_
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include <libnotify/notification.h>
+#include <libnotify/batch.h>
+#include <libnotify/template.h>
+#include <libnotify/event-channel.h>
+#include <libnotify/client.h>
+#include <libnotify/broadcast.h>
+#include <libnotify/statistics.h>
 #include <libnotify/notify-enum-types.h>
 #include <libnotify/notify-features.h>
 
 G_BEGIN_DECLS
 
+/**
+ * NotifyGroupBy:
+ * @NOTIFY_GROUP_BY_NONE: Notifications are not grouped.
+ * @NOTIFY_GROUP_BY_KEY: Notifications are grouped only by the key set with
+ *   [method@Notification.set_group_key].
+ * @NOTIFY_GROUP_BY_CATEGORY: Notifications are grouped by category.
+ * @NOTIFY_GROUP_BY_APP_NAME: Notifications are grouped by application name.
+ *
+ * How notifications are grouped, see [func@set_grouping].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_GROUP_BY_NONE,
+        NOTIFY_GROUP_BY_KEY,
+        NOTIFY_GROUP_BY_CATEGORY,
+        NOTIFY_GROUP_BY_APP_NAME,
+} NotifyGroupBy;
+
+/**
+ * NotifyDedupMode:
+ * @NOTIFY_DEDUP_NONE: Duplicated notifications are shown.
+ * @NOTIFY_DEDUP_SUPPRESS: Duplicated notifications are not shown.
+ * @NOTIFY_DEDUP_UPDATE: Duplicated notifications update the notification
+ *   showing the same content.
+ *
+ * How notifications with the same content are handled, see
+ * [func@set_deduplication].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_DEDUP_NONE,
+        NOTIFY_DEDUP_SUPPRESS,
+        NOTIFY_DEDUP_UPDATE,
+} NotifyDedupMode;
+
+/**
+ * NotifyEvictionPolicy:
+ * @NOTIFY_EVICT_OLDEST: The notification shown first is closed.
+ * @NOTIFY_EVICT_LOWEST_URGENCY: The notification with the lowest urgency
+ *   is closed, the one shown first among them.
+ *
+ * Which notification is closed when the quota of live notifications is
+ * exceeded, see [func@set_active_quota].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_EVICT_OLDEST,
+        NOTIFY_EVICT_LOWEST_URGENCY,
+} NotifyEvictionPolicy;
+
+/**
+ * NotifyEvictionFunc:
+ * @notification: The notification that was evicted.
+ * @user_data: User data passed to [func@set_eviction_callback].
+ *
+ * The function called when a notification is closed because the quota of
+ * live notifications was exceeded.
+ *
+ * Since: 0.8.8
+ */
+typedef void (*NotifyEvictionFunc) (NotifyNotification *notification,
+                                    gpointer            user_data);
+
+/**
+ * NotifyFallbackFunc:
+ * @notification: The notification that couldn't be shown.
+ * @user_data: User data passed to [func@set_fallback_sink].
+ *
+ * The function called with the notifications shown while the notification
+ * server is considered unavailable.
+ *
+ * Since: 0.8.8
+ */
+typedef void (*NotifyFallbackFunc) (NotifyNotification *notification,
+                                    gpointer            user_data);
+
+/**
+ * NotifyBackendType:
+ * @NOTIFY_BACKEND_AUTO: The XDG Desktop Notification Portal is used in a
+ *   sandbox, the notification server otherwise.
+ * @NOTIFY_BACKEND_FDO: The notifications are sent to the notification
+ *   server.
+ * @NOTIFY_BACKEND_PORTAL: The notifications are sent to the XDG Desktop
+ *   Notification Portal.
+ * @NOTIFY_BACKEND_LOG: The notifications are written to a file or to the
+ *   journal.
+ * @NOTIFY_BACKEND_NULL: The notifications are dropped.
+ *
+ * How the notifications are delivered, see [func@set_backend].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_BACKEND_AUTO,
+        NOTIFY_BACKEND_FDO,
+        NOTIFY_BACKEND_PORTAL,
+        NOTIFY_BACKEND_LOG,
+        NOTIFY_BACKEND_NULL,
+} NotifyBackendType;
+
 gboolean        notify_init (const char *app_name);
+gboolean        notify_init_with_connection (const char      *app_name,
+                                             GDBusConnection *connection);
 void            notify_uninit (void);
+void            notify_set_uninit_timeout (guint timeout);
 gboolean        notify_is_initted (void);
 
 const char     *notify_get_app_name (void);
@@ -47,6 +164,52 @@ gboolean        notify_get_server_info (char **ret_name,
                                         char **ret_version,
                                         char **ret_spec_version);
 
+void            notify_set_offline_spool_size (guint max_entries);
+guint           notify_get_offline_spool_size (void);
+
+void            notify_set_grouping (NotifyGroupBy group_by,
+                                     guint         window);
+
+void            notify_set_deduplication (NotifyDedupMode mode,
+                                          guint           window);
+void            notify_get_deduplication_stats (guint64 *hits,
+                                                guint64 *misses);
+
+void            notify_set_max_in_flight (NotifyUrgency urgency,
+                                          guint         max_in_flight);
+void            notify_set_scheduler_aging (guint interval);
+
+void            notify_set_active_quota (guint                max_active,
+                                         gboolean             per_category,
+                                         NotifyEvictionPolicy policy);
+void            notify_set_eviction_callback (NotifyEvictionFunc func,
+                                              gpointer           user_data,
+                                              GDestroyNotify     destroy);
+
+void            notify_set_auto_start (gboolean auto_start);
+void            notify_set_circuit_breaker (guint max_failures,
+                                            guint slow_call_threshold,
+                                            guint cooldown);
+void            notify_set_fallback_sink (NotifyFallbackFunc func,
+                                          gpointer           user_data,
+                                          GDestroyNotify     destroy);
+
+void            notify_set_backend (NotifyBackendType backend);
+void            notify_set_log_file (const char *path);
+
+void            notify_set_dispatch_context (GMainContext *context);
+void            notify_set_dispatch_thread_pool (gint max_threads);
+
+gboolean        notify_outbox_append (NotifyNotification  *notification,
+                                      GError             **error);
+guint           notify_outbox_flush (GError **error);
+
+gboolean        notify_send_simple (const char     *summary,
+                                    const char     *body,
+                                    const char     *icon,
+                                    NotifyUrgency   urgency,
+                                    GError        **error);
+
 G_END_DECLS
 
 #endif /* _LIBNOTIFY_NOTIFY_H_ */
@@ -0,0 +1,619 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/*
+ * The outbox is a ring buffer in a file shared by all the processes of the
+ * user, that any number of writers append to without locking: a record is
+ * reserved by atomically moving the head forward, then filled and marked
+ * as committed. A single flusher at a time (holding the file lock) sends
+ * the committed records and moves the tail forward.
+ *
+ * Offsets are free running 32 bit counters, the data size being a power
+ * of two they can wrap around safely.
+ *
+ * Records are contiguous: when one doesn't fit before the end of the
+ * buffer, the end is skipped with a padding record, or implicitly when
+ * it's too short to hold a record header.
+ *
+ * A writer dying between its reservation and setting its pid leaves a
+ * record nobody owns: the flusher waits for it for a while, then skips
+ * it if its length was set, or drops the rest of the outbox otherwise.
+ */
+
+#define OUTBOX_MAGIC            0x584f424eu     /* "NBOX" */
+#define OUTBOX_VERSION          1
+#define OUTBOX_DATA_SIZE        (64 * 1024)
+#define OUTBOX_RECORD_ALIGN     8
+/* Seconds before a reserved record without a writer is reclaimed */
+#define OUTBOX_STALL_TIMEOUT    10
+
+enum {
+        OUTBOX_RECORD_FREE = 0,
+        OUTBOX_RECORD_COMMITTED,
+        OUTBOX_RECORD_PADDING,
+};
+
+typedef struct
+{
+        guint32 magic;
+        guint32 version;
+        guint32 size;
+        guint32 head;           /* Bytes reserved by the writers */
+        guint32 tail;           /* Bytes consumed by the flusher */
+        guint32 stalled_tail;   /* Tail of the record without a writer */
+        guint32 stalled_since;  /* When it was found, in seconds, or 0 */
+        guint32 reserved;
+} OutboxHeader;
+
+typedef struct
+{
+        guint32 state;
+        guint32 length;         /* Including this header */
+        gint32  pid;            /* Set once length is valid */
+        guint32 payload_size;
+        gint64  queued_time;
+} OutboxRecord;
+
+typedef struct
+{
+        int           fd;
+        OutboxHeader *header;
+        guint8       *data;
+} Outbox;
+
+#define OUTBOX_FILE_SIZE (sizeof (OutboxHeader) + OUTBOX_DATA_SIZE)
+
+G_STATIC_ASSERT ((OUTBOX_DATA_SIZE & (OUTBOX_DATA_SIZE - 1)) == 0);
+G_STATIC_ASSERT (sizeof (OutboxHeader) % OUTBOX_RECORD_ALIGN == 0);
+G_STATIC_ASSERT (sizeof (OutboxRecord) % OUTBOX_RECORD_ALIGN == 0);
+
+static gboolean _outbox_flushed = FALSE;
+
+static char *
+outbox_get_path (void)
+{
+        return g_build_filename (g_get_user_runtime_dir (),
+                                 "libnotify", "outbox", NULL);
+}
+
+static void
+outbox_close (Outbox *outbox)
+{
+        if (outbox->header != NULL) {
+                munmap (outbox->header, OUTBOX_FILE_SIZE);
+        }
+
+        if (outbox->fd >= 0) {
+                close (outbox->fd);
+        }
+}
+
+static gboolean
+outbox_set_error_from_errno (GError    **error,
+                             int         saved_errno,
+                             const char *path)
+{
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                     "Failed to open the outbox %s: %s",
+                     path, g_strerror (saved_errno));
+
+        return FALSE;
+}
+
+static gboolean
+outbox_open (Outbox    *outbox,
+             gboolean   create,
+             GError   **error)
+{
+        g_autofree char *path = outbox_get_path ();
+        struct stat st;
+        void *map;
+
+        outbox->fd = -1;
+        outbox->header = NULL;
+        outbox->data = NULL;
+
+        if (create) {
+                g_autofree char *dir = g_path_get_dirname (path);
+
+                if (g_mkdir_with_parents (dir, 0700) != 0) {
+                        return outbox_set_error_from_errno (error, errno, dir);
+                }
+        }
+
+        outbox->fd = open (path,
+                           O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0),
+                           0600);
+        if (outbox->fd < 0) {
+                return outbox_set_error_from_errno (error, errno, path);
+        }
+
+        if (fstat (outbox->fd, &st) != 0) {
+                goto error;
+        }
+
+        if (st.st_size < (off_t) OUTBOX_FILE_SIZE) {
+                if (!create) {
+                        /* Not initialized yet, so nothing to flush */
+                        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                                     "The outbox %s is empty", path);
+                        outbox_close (outbox);
+                        return FALSE;
+                }
+
+                if (flock (outbox->fd, LOCK_EX) != 0) {
+                        goto error;
+                }
+
+                if (fstat (outbox->fd, &st) != 0 ||
+                    (st.st_size < (off_t) OUTBOX_FILE_SIZE &&
+                     ftruncate (outbox->fd, OUTBOX_FILE_SIZE) != 0)) {
+                        int saved_errno = errno;
+
+                        flock (outbox->fd, LOCK_UN);
+                        errno = saved_errno;
+                        goto error;
+                }
+
+                flock (outbox->fd, LOCK_UN);
+        }
+
+        map = mmap (NULL, OUTBOX_FILE_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, outbox->fd, 0);
+        if (map == MAP_FAILED) {
+                goto error;
+        }
+
+        outbox->header = map;
+        outbox->data = (guint8 *) map + sizeof (OutboxHeader);
+
+        if (g_atomic_int_get (&outbox->header->magic) != OUTBOX_MAGIC) {
+                /* A newly created file, the lock serializes the writers
+                 * initializing it concurrently */
+                if (flock (outbox->fd, LOCK_EX) != 0) {
+                        goto error;
+                }
+
+                if (outbox->header->magic != OUTBOX_MAGIC) {
+                        memset (map, 0, OUTBOX_FILE_SIZE);
+                        outbox->header->version = OUTBOX_VERSION;
+                        outbox->header->size = OUTBOX_DATA_SIZE;
+                        g_atomic_int_set (&outbox->header->magic, OUTBOX_MAGIC);
+                }
+
+                flock (outbox->fd, LOCK_UN);
+        }
+
+        if (outbox->header->version != OUTBOX_VERSION ||
+            outbox->header->size != OUTBOX_DATA_SIZE) {
+                g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                             "The outbox %s has an unsupported format", path);
+                outbox_close (outbox);
+                return FALSE;
+        }
+
+        return TRUE;
+
+error:
+        outbox_set_error_from_errno (error, errno, path);
+        outbox_close (outbox);
+
+        return FALSE;
+}
+
+static inline OutboxRecord *
+outbox_get_record (Outbox *outbox,
+                   guint32 position)
+{
+        return (OutboxRecord *) (outbox->data + (position & (OUTBOX_DATA_SIZE - 1)));
+}
+
+/*
+ * Gets the size of the end of the buffer skipped implicitly from
+ * @position, because it can't hold a record header, or 0.
+ */
+static inline guint32
+outbox_get_implicit_padding (guint32 position)
+{
+        guint32 left = OUTBOX_DATA_SIZE - (position & (OUTBOX_DATA_SIZE - 1));
+
+        return left < sizeof (OutboxRecord) ? left : 0;
+}
+
+static gboolean
+outbox_append (Outbox    *outbox,
+               GVariant  *parameters,
+               GError   **error)
+{
+        OutboxRecord *record;
+        gsize payload_size;
+        guint32 length, padding;
+        guint32 head, tail, offset;
+
+        payload_size = g_variant_get_size (parameters);
+        length = sizeof (OutboxRecord) + payload_size;
+        length = (length + OUTBOX_RECORD_ALIGN - 1) & ~(OUTBOX_RECORD_ALIGN - 1);
+
+        if (length > OUTBOX_DATA_SIZE / 4) {
+                g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                             "The notification is too large for the outbox");
+                return FALSE;
+        }
+
+        do {
+                head = g_atomic_int_get (&outbox->header->head);
+                tail = g_atomic_int_get (&outbox->header->tail);
+                offset = head & (OUTBOX_DATA_SIZE - 1);
+
+                /* Records are contiguous, skip the end of the buffer if
+                 * the record does not fit there */
+                padding = offset + length > OUTBOX_DATA_SIZE ?
+                          OUTBOX_DATA_SIZE - offset : 0;
+
+                if (head + padding + length - tail > OUTBOX_DATA_SIZE) {
+                        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                                     "The outbox is full");
+                        return FALSE;
+                }
+        } while (!g_atomic_int_compare_and_exchange ((gint *) &outbox->header->head,
+                                                     (gint) head,
+                                                     (gint) (head + padding + length)));
+
+        if (padding >= sizeof (OutboxRecord)) {
+                record = outbox_get_record (outbox, head);
+                g_atomic_int_set (&record->length, padding);
+                g_atomic_int_set (&record->pid, getpid ());
+                g_atomic_int_set (&record->state, OUTBOX_RECORD_PADDING);
+        }
+        head += padding;
+
+        record = outbox_get_record (outbox, head);
+        g_atomic_int_set (&record->length, length);
+        g_atomic_int_set (&record->pid, getpid ());
+
+        record->payload_size = payload_size;
+        record->queued_time = g_get_real_time ();
+        g_variant_store (parameters, record + 1);
+
+        g_atomic_int_set (&record->state, OUTBOX_RECORD_COMMITTED);
+
+        return TRUE;
+}
+
+static gboolean
+outbox_record_is_abandoned (OutboxRecord *record)
+{
+        gint32 pid = g_atomic_int_get (&record->pid);
+
+        /* Unknown yet, see outbox_record_is_stalled() */
+        if (pid == 0) {
+                return FALSE;
+        }
+
+        return kill (pid, 0) != 0 && errno == ESRCH;
+}
+
+/*
+ * Checks whether the record at @tail, reserved by a writer that didn't set
+ * its pid yet, stayed so for too long, the writer having probably died
+ * right after its reservation. The flusher holds the lock.
+ */
+static gboolean
+outbox_record_is_stalled (Outbox  *outbox,
+                          guint32  tail,
+                          gint64   now)
+{
+        guint32 now_s = (guint32) (now / G_USEC_PER_SEC);
+        OutboxHeader *header = outbox->header;
+
+        if (header->stalled_since == 0 || header->stalled_tail != tail) {
+                header->stalled_tail = tail;
+                header->stalled_since = now_s;
+                return FALSE;
+        }
+
+        return now_s - header->stalled_since >= OUTBOX_STALL_TIMEOUT;
+}
+
+static GVariant *
+outbox_record_get_parameters (OutboxRecord *record,
+                              gint64        now)
+{
+        GVariant *parameters;
+        GBytes *bytes;
+        gint32 timeout;
+
+        if (record->payload_size > record->length - sizeof (OutboxRecord)) {
+                return NULL;
+        }
+
+        bytes = g_bytes_new (record + 1, record->payload_size);
+        parameters = g_variant_new_from_bytes (G_VARIANT_TYPE ("(susssasa{sv}i)"),
+                                               bytes, FALSE);
+        g_variant_ref_sink (parameters);
+        g_bytes_unref (bytes);
+
+        if (!g_variant_is_normal_form (parameters)) {
+                g_variant_unref (parameters);
+                return NULL;
+        }
+
+        g_variant_get_child (parameters, 7, "i", &timeout);
+        if (timeout > 0 &&
+            now - record->queued_time >= (gint64) timeout * G_TIME_SPAN_MILLISECOND) {
+                g_variant_unref (parameters);
+                return NULL;
+        }
+
+        return parameters;
+}
+
+static guint
+outbox_flush (Outbox     *outbox,
+              GDBusProxy *proxy,
+              GError    **error)
+{
+        guint32 head, tail;
+        guint n_sent = 0;
+        gint64 now;
+
+        if (flock (outbox->fd, LOCK_EX | LOCK_NB) != 0) {
+                /* Another process is flushing it already */
+                return 0;
+        }
+
+        now = g_get_real_time ();
+        head = g_atomic_int_get (&outbox->header->head);
+        tail = g_atomic_int_get (&outbox->header->tail);
+
+        while (tail != head) {
+                OutboxRecord *record;
+                guint32 state;
+                guint32 length;
+                guint32 padding;
+
+                padding = outbox_get_implicit_padding (tail);
+                if (padding > 0) {
+                        tail += padding;
+                        continue;
+                }
+
+                record = outbox_get_record (outbox, tail);
+                state = g_atomic_int_get (&record->state);
+
+                if (state == OUTBOX_RECORD_FREE &&
+                    !outbox_record_is_abandoned (record) &&
+                    (g_atomic_int_get (&record->pid) != 0 ||
+                     !outbox_record_is_stalled (outbox, tail, now))) {
+                        /* Still being written, the next flush will get it */
+                        break;
+                }
+
+                length = g_atomic_int_get (&record->length);
+                if (length < sizeof (OutboxRecord) ||
+                    length % OUTBOX_RECORD_ALIGN != 0 ||
+                    length > head - tail ||
+                    (tail & (OUTBOX_DATA_SIZE - 1)) + length > OUTBOX_DATA_SIZE) {
+                        g_warning ("The notification outbox is corrupted, "
+                                   "dropping its content");
+                        memset (outbox->data, 0, OUTBOX_DATA_SIZE);
+                        tail = head;
+                        break;
+                }
+
+                if (state == OUTBOX_RECORD_COMMITTED) {
+                        GVariant *parameters;
+
+                        parameters = outbox_record_get_parameters (record, now);
+                        if (parameters != NULL) {
+                                GVariant *translated;
+
+                                translated = _notify_translate_notify_parameters (parameters);
+                                if (!_notify_send_message_no_reply (proxy, "Notify",
+                                                                    translated, error)) {
+                                        g_variant_unref (parameters);
+                                        break;
+                                }
+
+                                n_sent++;
+                                g_variant_unref (parameters);
+                        }
+                }
+
+                /* The next writers rely on a zero length until they set it */
+                memset (record, 0, length);
+                tail += length;
+                g_atomic_int_set (&outbox->header->tail, tail);
+        }
+
+        g_atomic_int_set (&outbox->header->tail, tail);
+        if (outbox->header->stalled_tail != tail) {
+                outbox->header->stalled_since = 0;
+        }
+        flock (outbox->fd, LOCK_UN);
+
+        return n_sent;
+}
+
+/*
+ * _notify_outbox_flush_once:
+ * @proxy: The notification server proxy.
+ *
+ * Sends the notifications left in the outbox by other processes, unless
+ * this process already did.
+ */
+void
+_notify_outbox_flush_once (GDBusProxy *proxy)
+{
+        g_autofree char *path = NULL;
+        GError *error = NULL;
+        Outbox outbox;
+        guint n_sent;
+
+        if (_outbox_flushed || _notify_uses_portal_notifications ()) {
+                return;
+        }
+
+        _outbox_flushed = TRUE;
+
+        path = outbox_get_path ();
+        if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+                return;
+        }
+
+        if (!outbox_open (&outbox, FALSE, &error)) {
+                g_debug ("%s", error->message);
+                g_clear_error (&error);
+                return;
+        }
+
+        n_sent = outbox_flush (&outbox, proxy, &error);
+        if (error != NULL) {
+                g_debug ("Failed to flush the outbox: %s", error->message);
+                g_clear_error (&error);
+        }
+
+        if (n_sent > 0) {
+                g_debug ("Sent %u notifications from the outbox", n_sent);
+        }
+
+        outbox_close (&outbox);
+}
+
+/**
+ * notify_outbox_append:
+ * @notification: The notification.
+ * @error: The returned error information.
+ *
+ * Appends @notification to the outbox, a file shared by all the processes
+ * of the user, instead of sending it to the notification server.
+ *
+ * This never blocks on the notification server nor connects to the bus,
+ * and is meant for short-lived processes that don't need to know if or
+ * when the notification is shown, nor to update it later. The outbox is
+ * flushed by [func@outbox_flush], or automatically by the next process
+ * using libnotify to show a notification.
+ *
+ * Notifications that expired when the outbox is flushed are dropped.
+ *
+ * Returns: %TRUE if the notification was appended. On error, this will
+ *   return %FALSE and set @error.
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_outbox_append (NotifyNotification *notification,
+                      GError            **error)
+{
+        GVariant *parameters;
+        Outbox outbox;
+        gboolean ret;
+
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        if (!notify_is_initted ()) {
+                g_warning ("you must call notify_init() before showing");
+                g_assert_not_reached ();
+        }
+
+        if (!outbox_open (&outbox, TRUE, error)) {
+                return FALSE;
+        }
+
+        parameters = g_variant_ref_sink (_notify_notification_get_notify_parameters (notification));
+        ret = outbox_append (&outbox, parameters, error);
+        g_variant_unref (parameters);
+
+        outbox_close (&outbox);
+
+        return ret;
+}
+
+/**
+ * notify_outbox_flush:
+ * @error: The returned error information.
+ *
+ * Sends the notifications appended to the outbox by
+ * [func@outbox_append].
+ *
+ * The notifications are sent without waiting for any reply from the
+ * server. If another process is flushing the outbox at the same time,
+ * nothing is sent.
+ *
+ * Returns: The number of notifications sent. On error, this will return
+ *   the number of notifications sent before the error and set @error.
+ *
+ * Since: 0.8.8
+ */
+guint
+notify_outbox_flush (GError **error)
+{
+        GDBusProxy *proxy;
+        GError *local_error = NULL;
+        Outbox outbox;
+        guint n_sent;
+
+        g_return_val_if_fail (error == NULL || *error == NULL, 0);
+
+        /* Don't let getting the proxy flush it on our behalf */
+        _outbox_flushed = TRUE;
+
+        proxy = _notify_get_proxy (error);
+        if (proxy == NULL) {
+                return 0;
+        }
+
+        if (_notify_uses_portal_notifications ()) {
+                g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             "The outbox can't be used with the notification portal");
+                return 0;
+        }
+
+        if (!outbox_open (&outbox, FALSE, &local_error)) {
+                if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+                        g_clear_error (&local_error);
+                        return 0;
+                }
+
+                g_propagate_error (error, local_error);
+                return 0;
+        }
+
+        n_sent = outbox_flush (&outbox, proxy, error);
+        outbox_close (&outbox);
+
+        return n_sent;
+}
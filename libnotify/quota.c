@@ -0,0 +1,308 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+typedef struct
+{
+        NotifyNotification *notification;
+        NotifyUrgency       urgency;
+} QuotaEntry;
+
+/* The live notifications, from the least recently shown */
+static GQueue                _live = G_QUEUE_INIT;
+static guint                 _max_active = 0;
+static gboolean              _per_category = FALSE;
+static NotifyEvictionPolicy  _policy = NOTIFY_EVICT_OLDEST;
+
+static NotifyEvictionFunc    _eviction_func = NULL;
+static gpointer              _eviction_data = NULL;
+static GDestroyNotify        _eviction_destroy = NULL;
+
+static void
+quota_entry_free (QuotaEntry *entry)
+{
+        g_object_unref (entry->notification);
+        g_free (entry);
+}
+
+static GList *
+quota_find (NotifyNotification *notification)
+{
+        for (GList *l = _live.head; l != NULL; l = l->next) {
+                QuotaEntry *entry = l->data;
+
+                if (entry->notification == notification) {
+                        return l;
+                }
+        }
+
+        return NULL;
+}
+
+static gboolean
+quota_same_bucket (QuotaEntry *a,
+                   QuotaEntry *b)
+{
+        if (!_per_category) {
+                return TRUE;
+        }
+
+        return g_strcmp0 (_notify_notification_get_category (a->notification),
+                          _notify_notification_get_category (b->notification)) == 0;
+}
+
+/*
+ * Picks the notification to evict to make room for @added, among the ones
+ * sharing its quota.
+ */
+static GList *
+quota_pick_victim (QuotaEntry *added)
+{
+        GList *victim = NULL;
+
+        for (GList *l = _live.head; l != NULL; l = l->next) {
+                QuotaEntry *entry = l->data;
+
+                if (entry == added || !quota_same_bucket (entry, added)) {
+                        continue;
+                }
+
+                if (_policy == NOTIFY_EVICT_OLDEST) {
+                        return l;
+                }
+
+                if (victim == NULL ||
+                    entry->urgency < ((QuotaEntry *) victim->data)->urgency) {
+                        victim = l;
+                }
+        }
+
+        return victim;
+}
+
+static void
+on_evicted_closed (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+        NotifyBatch *batch = NOTIFY_BATCH (source);
+        GError *error = NULL;
+
+        if (!notify_batch_submit_finish (batch, result, &error)) {
+                g_debug ("Failed to close evicted notifications: %s",
+                         error->message);
+                g_error_free (error);
+        }
+
+        g_object_unref (batch);
+}
+
+static void
+quota_enforce (QuotaEntry *added)
+{
+        NotifyBatch *batch = NULL;
+        guint count = 0;
+
+        for (GList *l = _live.head; l != NULL; l = l->next) {
+                if (quota_same_bucket (l->data, added)) {
+                        count++;
+                }
+        }
+
+        for (; count > _max_active; --count) {
+                GList *victim = quota_pick_victim (added);
+                QuotaEntry *entry;
+
+                if (victim == NULL) {
+                        break;
+                }
+
+                entry = victim->data;
+                g_queue_delete_link (&_live, victim);
+
+                if (batch == NULL) {
+                        batch = notify_batch_new ();
+                }
+                notify_batch_add_close (batch, entry->notification);
+
+                if (_eviction_func != NULL) {
+                        _eviction_func (entry->notification, _eviction_data);
+                }
+
+                quota_entry_free (entry);
+        }
+
+        if (batch != NULL) {
+                notify_batch_submit (batch, NULL, on_evicted_closed, NULL);
+        }
+}
+
+gboolean
+_notify_quota_is_active (void)
+{
+        return _max_active > 0;
+}
+
+/*
+ * _notify_quota_track:
+ * @notification: A notification that was just shown.
+ *
+ * Accounts @notification as live if it doesn't expire by itself, evicting
+ * the live notifications exceeding the quota.
+ */
+void
+_notify_quota_track (NotifyNotification *notification)
+{
+        QuotaEntry *entry;
+        GList *link;
+
+        if (_max_active == 0) {
+                return;
+        }
+
+        link = quota_find (notification);
+
+        if (!_notify_notification_is_persistent (notification)) {
+                if (link != NULL) {
+                        quota_entry_free (link->data);
+                        g_queue_delete_link (&_live, link);
+                }
+                return;
+        }
+
+        if (link != NULL) {
+                /* Shown again, so it's now the most recent one */
+                entry = link->data;
+                g_queue_unlink (&_live, link);
+                g_queue_push_tail_link (&_live, link);
+        } else {
+                entry = g_new0 (QuotaEntry, 1);
+                entry->notification = g_object_ref (notification);
+                g_queue_push_tail (&_live, entry);
+        }
+
+        entry->urgency = _notify_notification_get_urgency (notification);
+
+        quota_enforce (entry);
+}
+
+/*
+ * _notify_quota_untrack:
+ * @notification: A notification that was closed.
+ */
+void
+_notify_quota_untrack (NotifyNotification *notification)
+{
+        GList *link = quota_find (notification);
+
+        if (link != NULL) {
+                QuotaEntry *entry = link->data;
+
+                g_queue_delete_link (&_live, link);
+                quota_entry_free (entry);
+        }
+}
+
+/*
+ * _notify_quota_steal:
+ *
+ * Stops accounting the live notifications.
+ *
+ * Returns: (transfer full) (element-type NotifyNotification): The
+ *   notifications that were live.
+ */
+GList *
+_notify_quota_steal (void)
+{
+        GList *notifications = NULL;
+        QuotaEntry *entry;
+
+        while ((entry = g_queue_pop_tail (&_live)) != NULL) {
+                notifications = g_list_prepend (notifications,
+                                                entry->notification);
+                g_free (entry);
+        }
+
+        return notifications;
+}
+
+/**
+ * notify_set_active_quota:
+ * @max_active: The maximum number of live notifications, or 0 for no
+ *   limit.
+ * @per_category: Whether the limit applies to each category separately.
+ * @policy: How the notifications to close are chosen.
+ *
+ * Limits the number of live notifications that don't expire by themselves,
+ * that is notifications that never expire or that are resident.
+ *
+ * When showing a notification makes the number of live notifications go
+ * over @max_active, the notifications picked according to @policy are
+ * closed and reported to the function set with
+ * [func@set_eviction_callback]. The library keeps a reference on the
+ * live notifications until they are closed or evicted, and follows their
+ * closing by the server while a quota is set.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_active_quota (guint                max_active,
+                         gboolean             per_category,
+                         NotifyEvictionPolicy policy)
+{
+        _max_active = max_active;
+        _per_category = per_category;
+        _policy = policy;
+
+        if (max_active == 0) {
+                g_queue_clear_full (&_live, (GDestroyNotify) quota_entry_free);
+        }
+}
+
+/**
+ * notify_set_eviction_callback:
+ * @func: (nullable) (scope notified) (closure user_data): The function to
+ *   call when a notification is evicted, or %NULL.
+ * @user_data: User data to pass to @func.
+ * @destroy: (nullable): Destroy notifier for @user_data.
+ *
+ * Sets the function called for each notification closed because the
+ * quota set with [func@set_active_quota] was exceeded.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_eviction_callback (NotifyEvictionFunc func,
+                              gpointer           user_data,
+                              GDestroyNotify     destroy)
+{
+        if (_eviction_destroy != NULL) {
+                _eviction_destroy (_eviction_data);
+        }
+
+        _eviction_func = func;
+        _eviction_data = user_data;
+        _eviction_destroy = destroy;
+}
@@ -0,0 +1,523 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+#include "trace.h"
+
+/*
+ * The notifications shown asynchronously are queued by urgency and sent
+ * from the most urgent queue first, with a limit on the number of calls
+ * waiting for a reply for each urgency and overall. The overall limit
+ * leaves room for the critical notifications, while aging makes the
+ * notifications waiting in a queue for long compete as if they were more
+ * urgent, so that they are not starved.
+ */
+
+#define SCHEDULER_MAX_IN_FLIGHT 16
+#define DEFAULT_AGING_INTERVAL  2000
+
+#define N_URGENCIES (NOTIFY_URGENCY_CRITICAL + 1)
+
+typedef struct
+{
+        GTask         *task;
+        NotifyUrgency  urgency;
+        gint64         queued_time;
+        gint64         sent_time;
+        gint64         trace_begin;
+        guint64        content_hash;
+        /* The method called, a static string */
+        const char    *method;
+} SchedulerJob;
+
+typedef struct
+{
+        GQueue jobs;
+        guint  in_flight;
+        guint  max_in_flight;
+} SchedulerQueue;
+
+static SchedulerQueue _queues[N_URGENCIES] = {
+        [NOTIFY_URGENCY_LOW] = { G_QUEUE_INIT, 0, 4 },
+        [NOTIFY_URGENCY_NORMAL] = { G_QUEUE_INIT, 0, 8 },
+        [NOTIFY_URGENCY_CRITICAL] = { G_QUEUE_INIT, 0, SCHEDULER_MAX_IN_FLIGHT },
+};
+
+static guint _in_flight = 0;
+static gboolean _dispatching = FALSE;
+static guint _aging_interval = DEFAULT_AGING_INTERVAL;
+
+static void scheduler_dispatch (void);
+
+static void
+scheduler_job_free (SchedulerJob *job)
+{
+        g_clear_object (&job->task);
+        g_free (job);
+}
+
+static guint
+scheduler_job_get_priority (SchedulerJob *job,
+                            gint64        now)
+{
+        guint priority = job->urgency;
+
+        if (_aging_interval > 0) {
+                priority += (now - job->queued_time) /
+                            (_aging_interval * G_TIME_SPAN_MILLISECOND);
+        }
+
+        return MIN (priority, NOTIFY_URGENCY_CRITICAL);
+}
+
+/*
+ * Gets the queue whose head must be sent next, if any can be sent, ties
+ * being won by the most urgent queue.
+ */
+static SchedulerQueue *
+scheduler_pick_queue (void)
+{
+        SchedulerQueue *best = NULL;
+        guint best_priority = 0;
+        gint64 now;
+
+        /* Waiting for the information of a new server doesn't block */
+        if (_in_flight >= SCHEDULER_MAX_IN_FLIGHT ||
+            _notify_is_refreshing_server_info ()) {
+                return NULL;
+        }
+
+        now = g_get_monotonic_time ();
+
+        for (int urgency = NOTIFY_URGENCY_CRITICAL; urgency >= NOTIFY_URGENCY_LOW; --urgency) {
+                SchedulerQueue *queue = &_queues[urgency];
+                guint priority;
+
+                if (g_queue_is_empty (&queue->jobs) ||
+                    queue->in_flight >= queue->max_in_flight) {
+                        continue;
+                }
+
+                priority = scheduler_job_get_priority (g_queue_peek_head (&queue->jobs),
+                                                       now);
+                if (best == NULL || priority > best_priority) {
+                        best = queue;
+                        best_priority = priority;
+                }
+        }
+
+        return best;
+}
+
+static void
+scheduler_job_done (SchedulerJob *job)
+{
+        _queues[job->urgency].in_flight--;
+        _in_flight--;
+
+        scheduler_job_free (job);
+        scheduler_dispatch ();
+}
+
+static void
+on_show_call_done (GObject      *source,
+                   GAsyncResult *res,
+                   gpointer      user_data)
+{
+        SchedulerJob *job = user_data;
+        NotifyNotification *notification = g_task_get_source_object (job->task);
+        GError *error = NULL;
+        GVariant *result;
+
+        result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+        _notify_breaker_record (job->sent_time, error);
+        _notify_stats_record_call (job->method, job->sent_time, error);
+        NOTIFY_TRACE_MARK (job->trace_begin, job->method, "%s",
+                           error != NULL ? error->message : "done");
+        NOTIFY_PROBE2 (show__end, job->method, error == NULL);
+
+        if (_notify_notification_end_show (notification, result,
+                                           job->content_hash,
+                                           error ? NULL : &error)) {
+                g_task_return_boolean (job->task, TRUE);
+        } else {
+                g_task_return_error (job->task, error);
+        }
+
+        g_clear_pointer (&result, g_variant_unref);
+
+        scheduler_job_done (job);
+}
+
+static void
+scheduler_send (SchedulerJob *job)
+{
+        NotifyNotification *notification = g_task_get_source_object (job->task);
+        GDBusProxy *proxy;
+        GVariant *parameters;
+        GError *error = NULL;
+
+        _queues[job->urgency].in_flight++;
+        _in_flight++;
+
+        if (g_task_return_error_if_cancelled (job->task)) {
+                scheduler_job_done (job);
+                return;
+        }
+
+        proxy = _notify_get_proxy (&error);
+        if (proxy == NULL && _notify_breaker_should_fall_back (error)) {
+                g_clear_error (&error);
+
+                if (_notify_breaker_fallback (notification, &error)) {
+                        g_task_return_boolean (job->task, TRUE);
+                } else {
+                        g_task_return_error (job->task, error);
+                }
+
+                scheduler_job_done (job);
+                return;
+        }
+
+        if (proxy == NULL) {
+                g_task_return_error (job->task, error);
+                scheduler_job_done (job);
+                return;
+        }
+
+        /* Like _notify_dbus_show(), before the show leaves any trace */
+        if (_notify_breaker_is_open ()) {
+                if (_notify_breaker_fallback (notification, &error)) {
+                        g_task_return_boolean (job->task, TRUE);
+                } else {
+                        g_task_return_error (job->task, error);
+                }
+
+                scheduler_job_done (job);
+                return;
+        }
+
+        if (!_notify_notification_begin_show (notification, proxy,
+                                              &parameters, &job->method,
+                                              &job->content_hash, &error)) {
+                _notify_breaker_release ();
+                g_task_return_error (job->task, error);
+                scheduler_job_done (job);
+                return;
+        }
+
+        if (parameters == NULL) {
+                _notify_breaker_release ();
+                g_task_return_boolean (job->task, TRUE);
+                scheduler_job_done (job);
+                return;
+        }
+
+        NOTIFY_PROBE1 (show__begin, job->method);
+        job->trace_begin = NOTIFY_TRACE_TIME ();
+        job->sent_time = g_get_monotonic_time ();
+        g_dbus_proxy_call (proxy,
+                           job->method,
+                           parameters,
+                           _notify_get_call_flags (),
+                           -1,
+                           g_task_get_cancellable (job->task),
+                           on_show_call_done,
+                           job);
+}
+
+static void
+scheduler_dispatch (void)
+{
+        SchedulerQueue *queue;
+
+        /* Jobs completing while being sent are handled by the loop */
+        if (_dispatching) {
+                return;
+        }
+
+        _dispatching = TRUE;
+        while ((queue = scheduler_pick_queue ()) != NULL) {
+                scheduler_send (g_queue_pop_head (&queue->jobs));
+        }
+        _dispatching = FALSE;
+}
+
+static void
+on_direct_show_done (GObject      *source,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+        SchedulerJob *job = user_data;
+        NotifyNotification *notification = g_task_get_source_object (job->task);
+        GError *error = NULL;
+        GVariant *result;
+
+        result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+        _notify_stats_record_call (job->method, job->sent_time, error);
+        NOTIFY_TRACE_MARK (job->trace_begin, job->method, "%s",
+                           error != NULL ? error->message : "done");
+        NOTIFY_PROBE2 (show__end, job->method, error == NULL);
+
+        if (_notify_notification_end_show (notification, result, 0,
+                                           error ? NULL : &error)) {
+                g_task_return_boolean (job->task, TRUE);
+        } else {
+                g_task_return_error (job->task, error);
+        }
+
+        g_clear_pointer (&result, g_variant_unref);
+        scheduler_job_free (job);
+}
+
+/*
+ * Sends the notifications of the clients other than the default one
+ * right away: the scheduler only queues the ones of the default client.
+ */
+static void
+show_direct (GTask *task)
+{
+        NotifyNotification *notification = g_task_get_source_object (task);
+        GDBusProxy *proxy;
+        GVariant *parameters;
+        SchedulerJob *job;
+        const char *method;
+        guint64 content_hash;
+        GError *error = NULL;
+
+        proxy = _notify_notification_get_proxy (notification, &error);
+        if (proxy == NULL ||
+            !_notify_notification_begin_show (notification, proxy,
+                                              &parameters, &method,
+                                              &content_hash, &error)) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        if (parameters == NULL) {
+                g_task_return_boolean (task, TRUE);
+                g_object_unref (task);
+                return;
+        }
+
+        job = g_new0 (SchedulerJob, 1);
+        job->task = task;
+        job->method = method;
+
+        NOTIFY_PROBE1 (show__begin, method);
+        job->trace_begin = NOTIFY_TRACE_TIME ();
+        job->sent_time = g_get_monotonic_time ();
+
+        g_dbus_proxy_call (proxy,
+                           method,
+                           parameters,
+                           _notify_get_call_flags (),
+                           -1,
+                           g_task_get_cancellable (task),
+                           on_direct_show_done,
+                           job);
+}
+
+/*
+ * _notify_scheduler_clear:
+ *
+ * Fails all the notifications waiting to be sent.
+ */
+void
+_notify_scheduler_clear (void)
+{
+        for (int urgency = NOTIFY_URGENCY_LOW; urgency < N_URGENCIES; ++urgency) {
+                SchedulerJob *job;
+
+                while ((job = g_queue_pop_head (&_queues[urgency].jobs)) != NULL) {
+                        g_task_return_new_error (job->task,
+                                                 G_IO_ERROR,
+                                                 G_IO_ERROR_CANCELLED,
+                                                 "libnotify was uninitialized");
+                        scheduler_job_free (job);
+                }
+        }
+}
+
+/*
+ * _notify_scheduler_resume:
+ *
+ * Sends the notifications that waited for the server information.
+ */
+void
+_notify_scheduler_resume (void)
+{
+        scheduler_dispatch ();
+}
+
+/**
+ * notify_notification_show_async:
+ * @notification: The notification.
+ * @cancellable: (nullable): A #GCancellable, or %NULL.
+ * @callback: (scope async): The callback to call when the notification
+ *   was shown.
+ * @user_data: User data to pass to @callback.
+ *
+ * Asynchronously tells the notification server to display the
+ * notification on the screen.
+ *
+ * The notifications shown asynchronously are sent by urgency, the
+ * critical ones first, and with a limited number of calls to the server
+ * at once; see [func@set_max_in_flight]. Notifications waiting for long
+ * are promoted, so that the less urgent ones are eventually sent even
+ * under load.
+ *
+ * The notification content is read when it's actually sent. The
+ * notifications of a [class@Client] other than the default one are sent
+ * right away.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_notification_show_async (NotifyNotification  *notification,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+        SchedulerJob *job;
+
+        g_return_if_fail (NOTIFY_IS_NOTIFICATION (notification));
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+        _notify_notification_request_show (notification);
+
+        if (!_notify_client_is_default (_notify_notification_get_client (notification))) {
+                GTask *task = g_task_new (notification, cancellable,
+                                          callback, user_data);
+
+                g_task_set_source_tag (task, notify_notification_show_async);
+                show_direct (task);
+                return;
+        }
+
+        if (!notify_is_initted ()) {
+                g_warning ("you must call notify_init() before showing");
+                g_assert_not_reached ();
+        }
+
+        /* Backends not using a server have nothing to wait for */
+        if (!_notify_get_backend ()->uses_dbus) {
+                GTask *task = g_task_new (notification, cancellable,
+                                          callback, user_data);
+                GError *error = NULL;
+
+                g_task_set_source_tag (task, notify_notification_show_async);
+
+                if (_notify_get_backend ()->show (notification, &error)) {
+                        g_task_return_boolean (task, TRUE);
+                } else {
+                        g_task_return_error (task, error);
+                }
+
+                g_object_unref (task);
+                return;
+        }
+
+        job = g_new0 (SchedulerJob, 1);
+        job->task = g_task_new (notification, cancellable, callback, user_data);
+        g_task_set_source_tag (job->task, notify_notification_show_async);
+        job->urgency = _notify_notification_get_urgency (notification);
+        job->queued_time = g_get_monotonic_time ();
+
+        g_queue_push_tail (&_queues[job->urgency].jobs, job);
+
+        scheduler_dispatch ();
+}
+
+/**
+ * notify_notification_show_finish:
+ * @notification: The notification.
+ * @result: The #GAsyncResult passed to the callback.
+ * @error: The returned error information.
+ *
+ * Finishes an operation started with [method@Notification.show_async].
+ *
+ * Returns: %TRUE if successful. On error, this will return %FALSE and set
+ *   @error.
+ *
+ * Since: 0.8.8
+ */
+gboolean
+notify_notification_show_finish (NotifyNotification  *notification,
+                                 GAsyncResult        *result,
+                                 GError             **error)
+{
+        g_return_val_if_fail (NOTIFY_IS_NOTIFICATION (notification), FALSE);
+        g_return_val_if_fail (g_task_is_valid (result, notification), FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * notify_set_max_in_flight:
+ * @urgency: The urgency level.
+ * @max_in_flight: The maximum number of calls.
+ *
+ * Sets the maximum number of notifications with @urgency shown with
+ * [method@Notification.show_async] that can be waiting for the reply of
+ * the server at once.
+ *
+ * Regardless of it, no more than 16 calls are made at once, so the
+ * limits of the less urgent notifications determine how many calls are
+ * left for the more urgent ones. By default up to 4 low urgency, 8
+ * normal urgency and 16 critical notifications can be sent at once.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_max_in_flight (NotifyUrgency urgency,
+                          guint         max_in_flight)
+{
+        g_return_if_fail (urgency >= NOTIFY_URGENCY_LOW &&
+                          urgency <= NOTIFY_URGENCY_CRITICAL);
+        g_return_if_fail (max_in_flight > 0);
+
+        _queues[urgency].max_in_flight = max_in_flight;
+
+        scheduler_dispatch ();
+}
+
+/**
+ * notify_set_scheduler_aging:
+ * @interval: The aging interval, in milliseconds, or 0 to disable aging.
+ *
+ * Sets how long notifications shown with [method@Notification.show_async]
+ * wait before they are considered as having the next urgency level when
+ * choosing the notification to send.
+ *
+ * The default is 2 seconds.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_scheduler_aging (guint interval)
+{
+        _aging_interval = interval;
+}
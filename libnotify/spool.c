@@ -0,0 +1,387 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/* Number of Notify calls that can be waiting for a reply while replaying */
+#define SPOOL_REPLAY_WINDOW 16
+
+typedef struct
+{
+        GVariant *parameters;           /* (susssasa{sv}i) */
+        GWeakRef  notification;
+        gint64    queued_time;
+} SpoolEntry;
+
+static GQueue    _spool = G_QUEUE_INIT;
+static guint     _spool_max_size = 0;
+static guint     _spool_in_flight = 0;
+static gboolean  _spool_start_requested = FALSE;
+
+static void spool_replay_continue (GDBusProxy *proxy);
+
+static void
+spool_entry_free (SpoolEntry *entry)
+{
+        g_variant_unref (entry->parameters);
+        g_weak_ref_clear (&entry->notification);
+        g_free (entry);
+}
+
+static guint32
+spool_entry_get_replaces_id (SpoolEntry *entry)
+{
+        guint32 replaces_id;
+
+        g_variant_get_child (entry->parameters, 1, "u", &replaces_id);
+
+        return replaces_id;
+}
+
+static gboolean
+spool_entry_is_stale (SpoolEntry *entry,
+                      gint64      now)
+{
+        GVariant *hints;
+        gboolean transient = FALSE;
+        gint32 timeout;
+
+        g_variant_get_child (entry->parameters, 7, "i", &timeout);
+
+        if (timeout > 0 &&
+            now - entry->queued_time >= (gint64) timeout * G_TIME_SPAN_MILLISECOND) {
+                return TRUE;
+        }
+
+        /* Transient notifications are only meaningful when they happen */
+        hints = g_variant_get_child_value (entry->parameters, 6);
+        g_variant_lookup (hints, NOTIFY_NOTIFICATION_HINT_TRANSIENT, "b",
+                          &transient);
+        g_variant_unref (hints);
+
+        return transient;
+}
+
+static void
+on_spool_replay_done (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+        NotifyNotification *notification = user_data;
+        GError *error = NULL;
+        GVariant *result;
+
+        result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+
+        if (result == NULL) {
+                g_debug ("Failed to replay spooled notification: %s",
+                         error->message);
+                g_clear_error (&error);
+        } else if (notification != NULL) {
+                _notify_notification_finish_show (notification, result, NULL);
+        }
+
+        g_clear_pointer (&result, g_variant_unref);
+        g_clear_object (&notification);
+
+        _spool_in_flight--;
+        spool_replay_continue (G_DBUS_PROXY (source));
+}
+
+static void
+spool_replay_continue (GDBusProxy *proxy)
+{
+        g_autofree char *name_owner = NULL;
+        gint64 now;
+
+        name_owner = g_dbus_proxy_get_name_owner (proxy);
+        if (name_owner == NULL) {
+                /* The server went away again, wait for the next one */
+                return;
+        }
+
+        now = g_get_monotonic_time ();
+
+        while (_spool_in_flight < SPOOL_REPLAY_WINDOW &&
+               !g_queue_is_empty (&_spool)) {
+                SpoolEntry *entry = g_queue_pop_head (&_spool);
+
+                if (spool_entry_is_stale (entry, now)) {
+                        spool_entry_free (entry);
+                        continue;
+                }
+
+                _spool_in_flight++;
+                g_dbus_proxy_call (proxy,
+                                   "Notify",
+                                   _notify_translate_notify_parameters (entry->parameters),
+                                   _notify_get_call_flags (),
+                                   -1,
+                                   NULL,
+                                   on_spool_replay_done,
+                                   g_weak_ref_get (&entry->notification));
+                spool_entry_free (entry);
+        }
+}
+
+/*
+ * Asks the bus to activate the notification server, without waiting for
+ * it: the spooled notifications are replayed once it owns its name.
+ */
+static void
+spool_request_server_start (GDBusProxy *proxy)
+{
+        if (_spool_start_requested || !_notify_get_auto_start ()) {
+                return;
+        }
+
+        _spool_start_requested = TRUE;
+        g_dbus_connection_call (g_dbus_proxy_get_connection (proxy),
+                                "org.freedesktop.DBus",
+                                "/org/freedesktop/DBus",
+                                "org.freedesktop.DBus",
+                                "StartServiceByName",
+                                g_variant_new ("(su)", NOTIFY_DBUS_NAME, 0),
+                                NULL,
+                                G_DBUS_CALL_FLAGS_NONE,
+                                -1,
+                                NULL,
+                                NULL,
+                                NULL);
+}
+
+gboolean
+_notify_spool_is_enabled (void)
+{
+        return _spool_max_size > 0 && !_notify_uses_portal_notifications ();
+}
+
+/*
+ * _notify_spool_should_queue:
+ * @proxy: The notification server proxy.
+ *
+ * Gets whether the notifications sent through @proxy have to be spooled,
+ * that is when no server owns the name or the previously spooled
+ * notifications have not been replayed yet.
+ */
+gboolean
+_notify_spool_should_queue (GDBusProxy *proxy)
+{
+        g_autofree char *name_owner = NULL;
+
+        /* Peer-to-peer connections have no name owner to wait for */
+        if (!_notify_spool_is_enabled () ||
+            g_dbus_proxy_get_name (proxy) == NULL) {
+                return FALSE;
+        }
+
+        if (!g_queue_is_empty (&_spool)) {
+                return TRUE;
+        }
+
+        name_owner = g_dbus_proxy_get_name_owner (proxy);
+
+        return name_owner == NULL;
+}
+
+/*
+ * _notify_spool_push:
+ * @proxy: The notification server proxy.
+ * @notification: (nullable): The notification being shown.
+ * @parameters: The parameters of the Notify call.
+ *
+ * Queues a Notify call until a server owns the notification service
+ * name, replacing any queued call for the same notification.
+ *
+ * If the spool is full, the oldest queued call is dropped.
+ */
+void
+_notify_spool_push (GDBusProxy         *proxy,
+                    NotifyNotification *notification,
+                    GVariant           *parameters)
+{
+        SpoolEntry *entry = NULL;
+        guint32 replaces_id;
+
+        g_return_if_fail (g_variant_is_of_type (parameters,
+                                                G_VARIANT_TYPE ("(susssasa{sv}i)")));
+
+        g_variant_ref_sink (parameters);
+        g_variant_get_child (parameters, 1, "u", &replaces_id);
+
+        for (GList *l = _spool.head; l != NULL; l = l->next) {
+                SpoolEntry *queued = l->data;
+                NotifyNotification *queued_notification;
+
+                queued_notification = g_weak_ref_get (&queued->notification);
+                if (queued_notification != NULL) {
+                        g_object_unref (queued_notification);
+                }
+
+                if ((notification != NULL && queued_notification == notification) ||
+                    (replaces_id != 0 &&
+                     spool_entry_get_replaces_id (queued) == replaces_id)) {
+                        entry = queued;
+                        break;
+                }
+        }
+
+        if (entry != NULL) {
+                g_variant_unref (entry->parameters);
+        } else {
+                if (g_queue_get_length (&_spool) >= _spool_max_size) {
+                        g_debug ("Notification spool is full, dropping the "
+                                 "oldest notification");
+                        spool_entry_free (g_queue_pop_head (&_spool));
+                }
+
+                entry = g_new0 (SpoolEntry, 1);
+                g_weak_ref_init (&entry->notification, notification);
+                g_queue_push_tail (&_spool, entry);
+        }
+
+        entry->parameters = parameters;
+        entry->queued_time = g_get_monotonic_time ();
+
+        if (_spool_in_flight == 0) {
+                spool_replay_continue (proxy);
+        }
+
+        if (!g_queue_is_empty (&_spool)) {
+                spool_request_server_start (proxy);
+        }
+}
+
+/*
+ * _notify_spool_remove:
+ * @notification: The notification.
+ *
+ * Drops the queued call for @notification, if any.
+ *
+ * Returns: %TRUE if a queued call was dropped.
+ */
+gboolean
+_notify_spool_remove (NotifyNotification *notification)
+{
+        for (GList *l = _spool.head; l != NULL; l = l->next) {
+                SpoolEntry *entry = l->data;
+                NotifyNotification *queued_notification;
+
+                queued_notification = g_weak_ref_get (&entry->notification);
+                if (queued_notification != NULL) {
+                        g_object_unref (queued_notification);
+                }
+
+                if (queued_notification == notification) {
+                        g_queue_delete_link (&_spool, l);
+                        spool_entry_free (entry);
+                        return TRUE;
+                }
+        }
+
+        return FALSE;
+}
+
+/*
+ * _notify_spool_replay:
+ * @proxy: The notification server proxy.
+ *
+ * Sends the queued notifications to the server that now owns the
+ * notification service name, keeping a limited number of calls in flight
+ * so that the server isn't flooded. Expired and transient notifications
+ * are dropped.
+ */
+void
+_notify_spool_replay (GDBusProxy *proxy)
+{
+        _spool_start_requested = FALSE;
+
+        if (g_queue_is_empty (&_spool)) {
+                return;
+        }
+
+        g_debug ("Replaying %u spooled notifications",
+                 g_queue_get_length (&_spool));
+
+        spool_replay_continue (proxy);
+}
+
+void
+_notify_spool_clear (void)
+{
+        g_queue_clear_full (&_spool, (GDestroyNotify) spool_entry_free);
+        _spool_start_requested = FALSE;
+}
+
+/**
+ * notify_set_offline_spool_size:
+ * @max_entries: The maximum number of spooled notifications, or 0 to
+ *   disable the spool.
+ *
+ * Sets how many notifications are kept while no notification server is
+ * running, for example while it's restarting or before it has been
+ * started.
+ *
+ * Notifications shown in the meantime are queued instead of failing or
+ * waiting for the server to be started, and are sent once a server
+ * appears. Updates of a queued notification replace it, and notifications
+ * that expired or that are transient are dropped. When the spool is full
+ * the oldest notifications are dropped.
+ *
+ * While the spool is enabled the calls to the notification server never
+ * start it through D-Bus activation, so that they can't block waiting for
+ * it: the server is instead started in the background when the first
+ * notification is spooled, unless [func@set_auto_start] disabled it.
+ *
+ * The spool is disabled by default, and is not used when notifications
+ * are sent through the notification portal.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_set_offline_spool_size (guint max_entries)
+{
+        _spool_max_size = max_entries;
+
+        while (g_queue_get_length (&_spool) > _spool_max_size) {
+                spool_entry_free (g_queue_pop_head (&_spool));
+        }
+}
+
+/**
+ * notify_get_offline_spool_size:
+ *
+ * Gets the maximum number of notifications kept while no notification
+ * server is running.
+ *
+ * Returns: The maximum number of spooled notifications, or 0 if the spool
+ *   is disabled.
+ *
+ * Since: 0.8.8
+ */
+guint
+notify_get_offline_spool_size (void)
+{
+        return _spool_max_size;
+}
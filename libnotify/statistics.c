@@ -0,0 +1,622 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+/*
+ * The statistics are updated by the calls of every client, possibly from
+ * several threads, so they are protected by a lock. Each update is a few
+ * additions next to a D-Bus round trip.
+ */
+
+#define N_COUNTERS        (NOTIFY_COUNTER_IMAGE_BYTES + 1)
+#define N_OPERATIONS      (NOTIFY_OPERATION_PORTAL_REMOVE_NOTIFICATION + 1)
+#define N_INTERVALS       (NOTIFY_INTERVAL_CLOSE + 1)
+#define N_LATENCY_BUCKETS 20
+
+/* Enough for the users to take hours to react to a notification */
+#define N_INTERVAL_BUCKETS 32
+
+/* The upper limit of the first bucket, as a power of two */
+#define FIRST_BUCKET_BITS 4
+
+typedef struct
+{
+        /* The error domain in the upper bits, the code in the lower ones */
+        gint64  key;
+        guint64 count;
+} FailureEntry;
+
+struct _NotifyStatistics
+{
+        guint64     counters[N_COUNTERS];
+        guint64     latencies[N_OPERATIONS][N_LATENCY_BUCKETS];
+        guint64     intervals[N_INTERVALS][N_INTERVAL_BUCKETS];
+        GHashTable *failures;
+};
+
+static const char * const operation_methods[N_OPERATIONS] = {
+        [NOTIFY_OPERATION_NOTIFY] = "Notify",
+        [NOTIFY_OPERATION_CLOSE_NOTIFICATION] = "CloseNotification",
+        [NOTIFY_OPERATION_GET_CAPABILITIES] = "GetCapabilities",
+        [NOTIFY_OPERATION_GET_SERVER_INFORMATION] = "GetServerInformation",
+        [NOTIFY_OPERATION_PORTAL_ADD_NOTIFICATION] = "AddNotification",
+        [NOTIFY_OPERATION_PORTAL_REMOVE_NOTIFICATION] = "RemoveNotification",
+};
+
+static const char * const counter_names[N_COUNTERS] = {
+        [NOTIFY_COUNTER_SHOWS] = "shows",
+        [NOTIFY_COUNTER_UPDATES] = "updates",
+        [NOTIFY_COUNTER_CLOSES] = "closes",
+        [NOTIFY_COUNTER_FAILURES] = "failures",
+        [NOTIFY_COUNTER_SIGNALS_RECEIVED] = "signals received",
+        [NOTIFY_COUNTER_SIGNALS_DISPATCHED] = "signals dispatched",
+        [NOTIFY_COUNTER_SIGNALS_IGNORED] = "signals ignored",
+        [NOTIFY_COUNTER_HINT_BYTES] = "hint bytes",
+        [NOTIFY_COUNTER_IMAGE_BYTES] = "image bytes",
+};
+
+static const char * const interval_names[N_INTERVALS] = {
+        [NOTIFY_INTERVAL_ACKNOWLEDGE] = "time to acknowledge",
+        [NOTIFY_INTERVAL_ACTION] = "time to action",
+        [NOTIFY_INTERVAL_CLOSE] = "time to close",
+};
+
+static GMutex           _stats_lock;
+static NotifyStatistics _stats;
+
+G_DEFINE_BOXED_TYPE (NotifyStatistics, notify_statistics,
+                     notify_statistics_copy, notify_statistics_free)
+
+static gint64
+failure_key (GQuark domain,
+             gint   code)
+{
+        return (gint64) (((guint64) domain << 32) | (guint32) code);
+}
+
+static GHashTable *
+failures_new (void)
+{
+        return g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                      NULL, g_free);
+}
+
+static GHashTable *
+failures_copy (GHashTable *failures)
+{
+        GHashTable *copy = failures_new ();
+        GHashTableIter iter;
+        FailureEntry *entry;
+
+        if (failures == NULL) {
+                return copy;
+        }
+
+        g_hash_table_iter_init (&iter, failures);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+                FailureEntry *entry_copy = g_new (FailureEntry, 1);
+
+                *entry_copy = *entry;
+
+                g_hash_table_insert (copy, &entry_copy->key, entry_copy);
+        }
+
+        return copy;
+}
+
+static guint
+histogram_bucket (gint64 duration,
+                  guint  n_buckets)
+{
+        guint bucket;
+
+        if (duration < (1 << FIRST_BUCKET_BITS)) {
+                return 0;
+        }
+
+        bucket = g_bit_storage (duration) - FIRST_BUCKET_BITS;
+
+        return MIN (bucket, n_buckets - 1);
+}
+
+static gint64
+histogram_bucket_limit (guint bucket,
+                        guint n_buckets)
+{
+        if (bucket >= n_buckets - 1) {
+                return G_MAXINT64;
+        }
+
+        return (gint64) 1 << (bucket + FIRST_BUCKET_BITS);
+}
+
+/*
+ * _notify_stats_count:
+ * @counter: The counter to increase.
+ * @value: The value to add to it.
+ */
+void
+_notify_stats_count (NotifyCounter counter,
+                     guint64       value)
+{
+        g_mutex_lock (&_stats_lock);
+        _stats.counters[counter] += value;
+        g_mutex_unlock (&_stats_lock);
+}
+
+/*
+ * _notify_stats_record_call:
+ * @method: The D-Bus method that was called.
+ * @start_time: The monotonic time when the call was made.
+ * @error: (nullable): The error of the call, if it failed.
+ *
+ * Records the latency of a call to the server, and its failure. Cancelled
+ * calls are not recorded, as they say nothing about the server.
+ */
+void
+_notify_stats_record_call (const char   *method,
+                           gint64        start_time,
+                           const GError *error)
+{
+        gint64 duration = g_get_monotonic_time () - start_time;
+        FailureEntry *entry;
+        gint64 key;
+        int operation;
+
+        if (error != NULL &&
+            g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                return;
+        }
+
+        for (operation = 0; operation < N_OPERATIONS; ++operation) {
+                if (g_str_equal (method, operation_methods[operation])) {
+                        break;
+                }
+        }
+
+        g_return_if_fail (operation < N_OPERATIONS);
+
+        g_mutex_lock (&_stats_lock);
+
+        _stats.latencies[operation][histogram_bucket (duration, N_LATENCY_BUCKETS)]++;
+
+        if (error != NULL) {
+                _stats.counters[NOTIFY_COUNTER_FAILURES]++;
+
+                if (_stats.failures == NULL) {
+                        _stats.failures = failures_new ();
+                }
+
+                key = failure_key (error->domain, error->code);
+                entry = g_hash_table_lookup (_stats.failures, &key);
+                if (entry == NULL) {
+                        entry = g_new0 (FailureEntry, 1);
+                        entry->key = key;
+                        g_hash_table_insert (_stats.failures, &entry->key, entry);
+                }
+                entry->count++;
+        }
+
+        g_mutex_unlock (&_stats_lock);
+}
+
+/*
+ * _notify_stats_record_interval:
+ * @interval: The interval of the lifecycle of a notification.
+ * @duration: Its duration, in microseconds.
+ */
+void
+_notify_stats_record_interval (NotifyInterval interval,
+                               gint64         duration)
+{
+        g_mutex_lock (&_stats_lock);
+        _stats.intervals[interval][histogram_bucket (duration, N_INTERVAL_BUCKETS)]++;
+        g_mutex_unlock (&_stats_lock);
+}
+
+/*
+ * Formats the statistics as a human readable report, skipping the
+ * operations that were never made.
+ */
+static char *
+statistics_to_string (const NotifyStatistics *stats)
+{
+        GString *string = g_string_new ("libnotify statistics:\n");
+
+        for (int counter = 0; counter < N_COUNTERS; ++counter) {
+                g_string_append_printf (string, "  %-20s %" G_GUINT64_FORMAT "\n",
+                                        counter_names[counter],
+                                        stats->counters[counter]);
+        }
+
+        if (stats->failures != NULL) {
+                GHashTableIter iter;
+                FailureEntry *entry;
+
+                g_hash_table_iter_init (&iter, stats->failures);
+                while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+                        g_string_append_printf (string, "  failures %s:%d %" G_GUINT64_FORMAT "\n",
+                                                g_quark_to_string ((guint64) entry->key >> 32),
+                                                (gint) (guint32) entry->key,
+                                                entry->count);
+                }
+        }
+
+        for (int operation = 0; operation < N_OPERATIONS; ++operation) {
+                const guint64 *buckets = stats->latencies[operation];
+                guint64 total = 0;
+
+                for (int bucket = 0; bucket < N_LATENCY_BUCKETS; ++bucket) {
+                        total += buckets[bucket];
+                }
+
+                if (total == 0) {
+                        continue;
+                }
+
+                g_string_append_printf (string, "  %s latencies (%" G_GUINT64_FORMAT " calls):\n",
+                                        operation_methods[operation], total);
+
+                for (int bucket = 0; bucket < N_LATENCY_BUCKETS; ++bucket) {
+                        if (buckets[bucket] == 0) {
+                                continue;
+                        }
+
+                        if (bucket == N_LATENCY_BUCKETS - 1) {
+                                g_string_append_printf (string, "    >= %" G_GINT64_FORMAT " us",
+                                                        notify_statistics_get_bucket_limit (bucket - 1));
+                        } else {
+                                g_string_append_printf (string, "    < %" G_GINT64_FORMAT " us",
+                                                        notify_statistics_get_bucket_limit (bucket));
+                        }
+
+                        g_string_append_printf (string, " %" G_GUINT64_FORMAT "\n",
+                                                buckets[bucket]);
+                }
+        }
+
+        for (int interval = 0; interval < N_INTERVALS; ++interval) {
+                guint64 count = notify_statistics_get_interval_count (stats, interval);
+
+                if (count == 0) {
+                        continue;
+                }
+
+                g_string_append_printf (string, "  %s (%" G_GUINT64_FORMAT " notifications):"
+                                        " p50 < %" G_GINT64_FORMAT " us,"
+                                        " p90 < %" G_GINT64_FORMAT " us,"
+                                        " p99 < %" G_GINT64_FORMAT " us\n",
+                                        interval_names[interval], count,
+                                        notify_statistics_get_percentile (stats, interval, 50),
+                                        notify_statistics_get_percentile (stats, interval, 90),
+                                        notify_statistics_get_percentile (stats, interval, 99));
+        }
+
+        return g_string_free (string, FALSE);
+}
+
+/*
+ * _notify_stats_dump:
+ *
+ * Writes the statistics to the standard error if the `NOTIFY_STATS`
+ * environment variable is set to anything but an empty string or `0`.
+ */
+void
+_notify_stats_dump (void)
+{
+        const char *env = g_getenv ("NOTIFY_STATS");
+        g_autoptr(NotifyStatistics) stats = NULL;
+        g_autofree char *report = NULL;
+
+        if (env == NULL || *env == '\0' || g_str_equal (env, "0")) {
+                return;
+        }
+
+        stats = notify_get_statistics ();
+        report = statistics_to_string (stats);
+
+        fputs (report, stderr);
+}
+
+/**
+ * notify_get_statistics:
+ *
+ * Gets a snapshot of the counters and of the latency histograms of the
+ * calls to the notification server and to the notification portal, and
+ * of the distributions of the lifecycle intervals of the notifications.
+ *
+ * The calls of all the clients are measured, except the ones replaying
+ * the offline spool and showing the digests of grouped notifications,
+ * which are only counted as shows. Cancelled calls are not counted.
+ *
+ * If the `NOTIFY_STATS` environment variable is set, they are also
+ * written to the standard error by [func@uninit].
+ *
+ * Returns: (transfer full): The statistics, to free with
+ *   [method@Statistics.free].
+ *
+ * Since: 0.8.8
+ */
+NotifyStatistics *
+notify_get_statistics (void)
+{
+        NotifyStatistics *stats;
+
+        g_mutex_lock (&_stats_lock);
+        stats = notify_statistics_copy (&_stats);
+        g_mutex_unlock (&_stats_lock);
+
+        return stats;
+}
+
+/**
+ * notify_reset_statistics:
+ *
+ * Resets all the counters, the latency histograms and the interval
+ * distributions to zero.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_reset_statistics (void)
+{
+        g_mutex_lock (&_stats_lock);
+        g_clear_pointer (&_stats.failures, g_hash_table_destroy);
+        memset (&_stats, 0, sizeof (NotifyStatistics));
+        g_mutex_unlock (&_stats_lock);
+}
+
+/**
+ * notify_statistics_copy:
+ * @stats: The statistics.
+ *
+ * Returns: (transfer full): A copy of @stats.
+ *
+ * Since: 0.8.8
+ */
+NotifyStatistics *
+notify_statistics_copy (const NotifyStatistics *stats)
+{
+        NotifyStatistics *copy;
+
+        g_return_val_if_fail (stats != NULL, NULL);
+
+        copy = g_new (NotifyStatistics, 1);
+        *copy = *stats;
+        copy->failures = failures_copy (stats->failures);
+
+        return copy;
+}
+
+/**
+ * notify_statistics_free:
+ * @stats: The statistics.
+ *
+ * Frees @stats.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_statistics_free (NotifyStatistics *stats)
+{
+        g_return_if_fail (stats != NULL);
+
+        g_clear_pointer (&stats->failures, g_hash_table_destroy);
+        g_free (stats);
+}
+
+/**
+ * notify_statistics_get_counter:
+ * @stats: The statistics.
+ * @counter: The counter.
+ *
+ * Returns: The value of @counter.
+ *
+ * Since: 0.8.8
+ */
+guint64
+notify_statistics_get_counter (const NotifyStatistics *stats,
+                               NotifyCounter           counter)
+{
+        g_return_val_if_fail (stats != NULL, 0);
+        g_return_val_if_fail (counter < N_COUNTERS, 0);
+
+        return stats->counters[counter];
+}
+
+/**
+ * notify_statistics_get_failures:
+ * @stats: The statistics.
+ * @domain: The error domain.
+ * @code: The error code.
+ *
+ * Gets the number of calls to the server that failed with the error
+ * @code of @domain, such as %G_DBUS_ERROR_SERVICE_UNKNOWN of
+ * %G_DBUS_ERROR or %G_IO_ERROR_TIMED_OUT of %G_IO_ERROR.
+ *
+ * Returns: The number of failures.
+ *
+ * Since: 0.8.8
+ */
+guint64
+notify_statistics_get_failures (const NotifyStatistics *stats,
+                                GQuark                  domain,
+                                gint                    code)
+{
+        FailureEntry *entry;
+        gint64 key;
+
+        g_return_val_if_fail (stats != NULL, 0);
+
+        if (stats->failures == NULL) {
+                return 0;
+        }
+
+        key = failure_key (domain, code);
+        entry = g_hash_table_lookup (stats->failures, &key);
+
+        return entry ? entry->count : 0;
+}
+
+/**
+ * notify_statistics_get_latencies:
+ * @stats: The statistics.
+ * @operation: The D-Bus call.
+ * @n_buckets: (out): Return location for the number of buckets.
+ *
+ * Gets the histogram of the latencies of @operation, that is the time
+ * from when the call was made to when its reply or error was received.
+ *
+ * The buckets have logarithmic sizes: bucket `i` counts the calls that
+ * took less than [func@Statistics.get_bucket_limit] of `i` microseconds,
+ * but not less than the limit of bucket `i - 1`. The last bucket counts
+ * all the longer calls.
+ *
+ * Returns: (array length=n_buckets) (transfer none): The number of calls
+ *   in each bucket.
+ *
+ * Since: 0.8.8
+ */
+const guint64 *
+notify_statistics_get_latencies (const NotifyStatistics *stats,
+                                 NotifyOperation         operation,
+                                 guint                  *n_buckets)
+{
+        g_return_val_if_fail (stats != NULL, NULL);
+        g_return_val_if_fail (operation < N_OPERATIONS, NULL);
+        g_return_val_if_fail (n_buckets != NULL, NULL);
+
+        *n_buckets = N_LATENCY_BUCKETS;
+
+        return stats->latencies[operation];
+}
+
+/**
+ * notify_statistics_get_bucket_limit:
+ * @bucket: The index of a latency bucket.
+ *
+ * Gets the latency, in microseconds, under which the calls are counted
+ * in @bucket or in the previous buckets, see
+ * [method@Statistics.get_latencies]. The first bucket counts the calls
+ * under 16 µs, and each next bucket doubles the limit.
+ *
+ * Returns: The limit of @bucket, or %G_MAXINT64 for the last bucket.
+ *
+ * Since: 0.8.8
+ */
+gint64
+notify_statistics_get_bucket_limit (guint bucket)
+{
+        return histogram_bucket_limit (bucket, N_LATENCY_BUCKETS);
+}
+
+/**
+ * notify_statistics_get_interval_count:
+ * @stats: The statistics.
+ * @interval: The lifecycle interval.
+ *
+ * Gets the number of times @interval was measured, that is the number of
+ * notifications that were acknowledged, acted upon or closed after the
+ * server showed them.
+ *
+ * Returns: The number of measures of @interval.
+ *
+ * Since: 0.8.8
+ */
+guint64
+notify_statistics_get_interval_count (const NotifyStatistics *stats,
+                                      NotifyInterval          interval)
+{
+        guint64 count = 0;
+
+        g_return_val_if_fail (stats != NULL, 0);
+        g_return_val_if_fail (interval < N_INTERVALS, 0);
+
+        for (int bucket = 0; bucket < N_INTERVAL_BUCKETS; ++bucket) {
+                count += stats->intervals[interval][bucket];
+        }
+
+        return count;
+}
+
+/**
+ * notify_statistics_get_percentile:
+ * @stats: The statistics.
+ * @interval: The lifecycle interval.
+ * @percentile: The percentile, between 0 and 100.
+ *
+ * Gets the duration under which @percentile percent of the measures of
+ * @interval fall, such as the median time the server takes to show the
+ * notifications with 50, or the time the slowest users take to react to
+ * them with 99.
+ *
+ * The durations are recorded in buckets of logarithmic sizes like the
+ * ones of [method@Statistics.get_latencies], so the returned value is an
+ * upper bound, at most twice the actual percentile.
+ *
+ * Returns: The duration in microseconds, %G_MAXINT64 if it's over four
+ *   hours, or 0 if @interval was never measured.
+ *
+ * Since: 0.8.8
+ */
+gint64
+notify_statistics_get_percentile (const NotifyStatistics *stats,
+                                  NotifyInterval          interval,
+                                  gdouble                 percentile)
+{
+        guint64 count;
+        guint64 rank;
+        guint64 seen = 0;
+        int bucket;
+
+        g_return_val_if_fail (stats != NULL, 0);
+        g_return_val_if_fail (interval < N_INTERVALS, 0);
+        g_return_val_if_fail (percentile >= 0 && percentile <= 100, 0);
+
+        count = notify_statistics_get_interval_count (stats, interval);
+        if (count == 0) {
+                return 0;
+        }
+
+        /* The rank of the measure in the sorted measures, from 1 */
+        rank = (guint64) (percentile * count / 100);
+        if ((gdouble) rank * 100 < percentile * count) {
+                rank++;
+        }
+        rank = CLAMP (rank, 1, count);
+
+        for (bucket = 0; bucket < N_INTERVAL_BUCKETS - 1; ++bucket) {
+                seen += stats->intervals[interval][bucket];
+
+                if (seen >= rank) {
+                        break;
+                }
+        }
+
+        return histogram_bucket_limit (bucket, N_INTERVAL_BUCKETS);
+}
@@ -0,0 +1,160 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * NotifyCounter:
+ * @NOTIFY_COUNTER_SHOWS: Notifications shown for the first time.
+ * @NOTIFY_COUNTER_UPDATES: Notifications shown again, updating the
+ *   notification showing them.
+ * @NOTIFY_COUNTER_CLOSES: Notifications closed by the application.
+ * @NOTIFY_COUNTER_FAILURES: Calls to the server that failed, see
+ *   [method@Statistics.get_failures].
+ * @NOTIFY_COUNTER_SIGNALS_RECEIVED: Signals received from the server.
+ * @NOTIFY_COUNTER_SIGNALS_DISPATCHED: Signals delivered to notifications
+ *   of the process.
+ * @NOTIFY_COUNTER_SIGNALS_IGNORED: Signals about no notification of the
+ *   process, or that were not understood.
+ * @NOTIFY_COUNTER_HINT_BYTES: Bytes of hints sent, without the images.
+ * @NOTIFY_COUNTER_IMAGE_BYTES: Bytes of image data hints sent.
+ *
+ * The counters of [struct@Statistics].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_COUNTER_SHOWS,
+        NOTIFY_COUNTER_UPDATES,
+        NOTIFY_COUNTER_CLOSES,
+        NOTIFY_COUNTER_FAILURES,
+        NOTIFY_COUNTER_SIGNALS_RECEIVED,
+        NOTIFY_COUNTER_SIGNALS_DISPATCHED,
+        NOTIFY_COUNTER_SIGNALS_IGNORED,
+        NOTIFY_COUNTER_HINT_BYTES,
+        NOTIFY_COUNTER_IMAGE_BYTES,
+} NotifyCounter;
+
+/**
+ * NotifyOperation:
+ * @NOTIFY_OPERATION_NOTIFY: The `Notify` call of the notification server.
+ * @NOTIFY_OPERATION_CLOSE_NOTIFICATION: The `CloseNotification` call of the
+ *   notification server.
+ * @NOTIFY_OPERATION_GET_CAPABILITIES: The `GetCapabilities` call of the
+ *   notification server.
+ * @NOTIFY_OPERATION_GET_SERVER_INFORMATION: The `GetServerInformation`
+ *   call of the notification server.
+ * @NOTIFY_OPERATION_PORTAL_ADD_NOTIFICATION: The `AddNotification` call of
+ *   the notification portal.
+ * @NOTIFY_OPERATION_PORTAL_REMOVE_NOTIFICATION: The `RemoveNotification`
+ *   call of the notification portal.
+ *
+ * The D-Bus calls whose latency is measured by [struct@Statistics].
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_OPERATION_NOTIFY,
+        NOTIFY_OPERATION_CLOSE_NOTIFICATION,
+        NOTIFY_OPERATION_GET_CAPABILITIES,
+        NOTIFY_OPERATION_GET_SERVER_INFORMATION,
+        NOTIFY_OPERATION_PORTAL_ADD_NOTIFICATION,
+        NOTIFY_OPERATION_PORTAL_REMOVE_NOTIFICATION,
+} NotifyOperation;
+
+/**
+ * NotifyInterval:
+ * @NOTIFY_INTERVAL_ACKNOWLEDGE: From when a notification is asked to be
+ *   shown to when the server replies that it showed it.
+ * @NOTIFY_INTERVAL_ACTION: From when the server showed a notification to
+ *   when the user invoked one of its actions.
+ * @NOTIFY_INTERVAL_CLOSE: From when the server showed a notification to
+ *   when it was closed, for any reason.
+ *
+ * The intervals of the lifecycle of the notifications whose distribution
+ * is measured by [struct@Statistics], see
+ * [method@Notification.get_timestamp].
+ *
+ * The actions and the closing of a notification are only known when it
+ * follows the signals of the server, that is when it has actions or when
+ * something watches its closing at the time it's shown, see
+ * [method@Notification.show]. The %NOTIFY_INTERVAL_ACTION and
+ * %NOTIFY_INTERVAL_CLOSE intervals of the other notifications are not
+ * measured.
+ *
+ * Since: 0.8.8
+ */
+typedef enum
+{
+        NOTIFY_INTERVAL_ACKNOWLEDGE,
+        NOTIFY_INTERVAL_ACTION,
+        NOTIFY_INTERVAL_CLOSE,
+} NotifyInterval;
+
+/**
+ * NotifyStatistics:
+ *
+ * A snapshot of the statistics of the library, returned by
+ * [func@get_statistics].
+ *
+ * The statistics cover all the clients of the process, since it started
+ * or since [func@reset_statistics] was called.
+ *
+ * Since: 0.8.8
+ */
+typedef struct _NotifyStatistics NotifyStatistics;
+
+#define NOTIFY_TYPE_STATISTICS           (notify_statistics_get_type ())
+
+GType               notify_statistics_get_type            (void) G_GNUC_CONST;
+
+NotifyStatistics   *notify_get_statistics                 (void);
+void                notify_reset_statistics               (void);
+
+NotifyStatistics   *notify_statistics_copy                (const NotifyStatistics *stats);
+void                notify_statistics_free                (NotifyStatistics       *stats);
+
+guint64             notify_statistics_get_counter         (const NotifyStatistics *stats,
+                                                           NotifyCounter           counter);
+
+guint64             notify_statistics_get_failures        (const NotifyStatistics *stats,
+                                                           GQuark                  domain,
+                                                           gint                    code);
+
+const guint64      *notify_statistics_get_latencies       (const NotifyStatistics *stats,
+                                                           NotifyOperation         operation,
+                                                           guint                  *n_buckets);
+
+gint64              notify_statistics_get_bucket_limit    (guint                   bucket);
+
+guint64             notify_statistics_get_interval_count  (const NotifyStatistics *stats,
+                                                           NotifyInterval          interval);
+
+gint64              notify_statistics_get_percentile      (const NotifyStatistics *stats,
+                                                           NotifyInterval          interval,
+                                                           gdouble                 percentile);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NotifyStatistics, notify_statistics_free)
+
+G_END_DECLS
@@ -0,0 +1,307 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "notify.h"
+#include "internal.h"
+
+struct _NotifyTemplate
+{
+        GObject         parent_instance;
+
+        /* Reference counted strings */
+        char           *app_name;
+        char           *app_icon;
+
+        char           *icon_name;
+        gint            timeout;
+
+        /* Shared with the notifications created since the last change */
+        GHashTable     *hints;
+        NotifyActionSet *actions;
+        gboolean        hints_shared;
+        gboolean        actions_shared;
+};
+
+G_DEFINE_TYPE (NotifyTemplate, notify_template, G_TYPE_OBJECT)
+
+static void
+notify_template_finalize (GObject *object)
+{
+        NotifyTemplate *tmpl = NOTIFY_TEMPLATE (object);
+
+        g_clear_pointer (&tmpl->app_name, g_ref_string_release);
+        g_clear_pointer (&tmpl->app_icon, g_ref_string_release);
+        g_free (tmpl->icon_name);
+        g_clear_pointer (&tmpl->hints, g_hash_table_unref);
+        g_clear_pointer (&tmpl->actions, _notify_action_set_unref);
+
+        G_OBJECT_CLASS (notify_template_parent_class)->finalize (object);
+}
+
+static void
+notify_template_class_init (NotifyTemplateClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = notify_template_finalize;
+}
+
+static void
+notify_template_init (NotifyTemplate *tmpl)
+{
+        tmpl->timeout = NOTIFY_EXPIRES_DEFAULT;
+}
+
+/**
+ * notify_template_new:
+ *
+ * Creates a new #NotifyTemplate.
+ *
+ * Returns: (transfer full): The new #NotifyTemplate.
+ *
+ * Since: 0.8.8
+ */
+NotifyTemplate *
+notify_template_new (void)
+{
+        return g_object_new (NOTIFY_TYPE_TEMPLATE, NULL);
+}
+
+/* Stops sharing the hints with the notifications before changing them */
+static void
+notify_template_unshare_hints (NotifyTemplate *tmpl)
+{
+        GHashTable *shared;
+
+        if (!tmpl->hints_shared) {
+                return;
+        }
+
+        shared = tmpl->hints;
+        tmpl->hints = _notify_hints_copy (shared);
+        tmpl->hints_shared = FALSE;
+        g_hash_table_unref (shared);
+}
+
+static void
+notify_template_unshare_actions (NotifyTemplate *tmpl)
+{
+        NotifyActionSet *shared;
+
+        if (!tmpl->actions_shared) {
+                return;
+        }
+
+        shared = tmpl->actions;
+        tmpl->actions = _notify_action_set_copy (shared);
+        tmpl->actions_shared = FALSE;
+        _notify_action_set_unref (shared);
+}
+
+/**
+ * notify_template_set_app_name:
+ * @tmpl: The template.
+ * @app_name: (nullable): The localised application name.
+ *
+ * Sets the application name of the notifications, see
+ * [method@Notification.set_app_name].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_template_set_app_name (NotifyTemplate *tmpl,
+                              const char     *app_name)
+{
+        g_return_if_fail (NOTIFY_IS_TEMPLATE (tmpl));
+
+        g_clear_pointer (&tmpl->app_name, g_ref_string_release);
+        tmpl->app_name = app_name ? g_ref_string_new (app_name) : NULL;
+}
+
+/**
+ * notify_template_set_app_icon:
+ * @tmpl: The template.
+ * @app_icon: (nullable): The application icon name or filename.
+ *
+ * Sets the application icon of the notifications, see
+ * [method@Notification.set_app_icon].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_template_set_app_icon (NotifyTemplate *tmpl,
+                              const char     *app_icon)
+{
+        g_return_if_fail (NOTIFY_IS_TEMPLATE (tmpl));
+
+        g_clear_pointer (&tmpl->app_icon, g_ref_string_release);
+        tmpl->app_icon = app_icon ? g_ref_string_new (app_icon) : NULL;
+}
+
+/**
+ * notify_template_set_icon_name:
+ * @tmpl: The template.
+ * @icon_name: (nullable): The icon theme icon name or filename.
+ *
+ * Sets the icon of the notifications.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_template_set_icon_name (NotifyTemplate *tmpl,
+                               const char     *icon_name)
+{
+        g_return_if_fail (NOTIFY_IS_TEMPLATE (tmpl));
+
+        if (icon_name != NULL && *icon_name == '\0') {
+                icon_name = NULL;
+        }
+
+        g_free (tmpl->icon_name);
+        tmpl->icon_name = g_strdup (icon_name);
+
+        notify_template_unshare_hints (tmpl);
+        tmpl->hints = _notify_hints_set (tmpl->hints,
+                                         NOTIFY_NOTIFICATION_HINT_IMAGE_PATH,
+                                         icon_name ?
+                                         g_variant_ref_sink (g_variant_new_string (icon_name)) : NULL);
+}
+
+/**
+ * notify_template_set_timeout:
+ * @tmpl: The template.
+ * @timeout: The timeout in milliseconds.
+ *
+ * Sets the timeout of the notifications, see
+ * [method@Notification.set_timeout].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_template_set_timeout (NotifyTemplate *tmpl,
+                             gint            timeout)
+{
+        g_return_if_fail (NOTIFY_IS_TEMPLATE (tmpl));
+
+        tmpl->timeout = timeout;
+}
+
+/**
+ * notify_template_set_hint:
+ * @tmpl: The template.
+ * @key: The hint key.
+ * @value: (nullable): The hint value.
+ *
+ * Sets a hint of the notifications, see [method@Notification.set_hint].
+ *
+ * If @value is floating, it is consumed.
+ *
+ * Since: 0.8.8
+ */
+void
+notify_template_set_hint (NotifyTemplate *tmpl,
+                          const char     *key,
+                          GVariant       *value)
+{
+        g_return_if_fail (NOTIFY_IS_TEMPLATE (tmpl));
+        g_return_if_fail (key != NULL && *key != '\0');
+
+        notify_template_unshare_hints (tmpl);
+        tmpl->hints = _notify_hints_set (tmpl->hints, key,
+                                         value ? g_variant_ref_sink (value) : NULL);
+}
+
+/**
+ * notify_template_add_action:
+ * @tmpl: The template.
+ * @action: The action ID.
+ * @label: The human-readable action label.
+ * @callback: The action's callback function.
+ * @user_data: Optional custom data to pass to @callback.
+ * @free_func: (type GLib.DestroyNotify): An optional function to free
+ *   @user_data when the template and all the notifications having the
+ *   action are destroyed.
+ *
+ * Adds an action to the notifications, see
+ * [method@Notification.add_action].
+ *
+ * Since: 0.8.8
+ */
+void
+notify_template_add_action (NotifyTemplate      *tmpl,
+                            const char          *action,
+                            const char          *label,
+                            NotifyActionCallback callback,
+                            gpointer             user_data,
+                            GFreeFunc            free_func)
+{
+        g_return_if_fail (NOTIFY_IS_TEMPLATE (tmpl));
+        g_return_if_fail (action != NULL && *action != '\0');
+        g_return_if_fail (label != NULL && *label != '\0');
+        g_return_if_fail (callback != NULL);
+
+        notify_template_unshare_actions (tmpl);
+        tmpl->actions = _notify_action_set_add (tmpl->actions, action, label,
+                                                callback, user_data, free_func);
+}
+
+/**
+ * notify_notification_new_from_template:
+ * @tmpl: The template.
+ * @summary: The required summary text.
+ * @body: (nullable): The optional body text.
+ *
+ * Creates a new #NotifyNotification with the content of @tmpl.
+ *
+ * The notification shares the hints and actions of @tmpl until either of
+ * them changes them. Later changes to @tmpl don't affect the
+ * notification.
+ *
+ * Returns: (transfer full): The new #NotifyNotification.
+ *
+ * Since: 0.8.8
+ */
+NotifyNotification *
+notify_notification_new_from_template (NotifyTemplate *tmpl,
+                                       const char     *summary,
+                                       const char     *body)
+{
+        NotifyNotification *notification;
+
+        g_return_val_if_fail (NOTIFY_IS_TEMPLATE (tmpl), NULL);
+
+        notification = g_object_new (NOTIFY_TYPE_NOTIFICATION, NULL);
+        _notify_notification_apply_template (notification,
+                                             summary,
+                                             body,
+                                             tmpl->icon_name,
+                                             tmpl->app_name,
+                                             tmpl->app_icon,
+                                             tmpl->timeout,
+                                             tmpl->hints,
+                                             tmpl->actions);
+
+        tmpl->hints_shared = tmpl->hints != NULL;
+        tmpl->actions_shared = tmpl->actions != NULL;
+
+        return notification;
+}
@@ -0,0 +1,74 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <libnotify/notification.h>
+
+G_BEGIN_DECLS
+
+#define NOTIFY_TYPE_TEMPLATE             (notify_template_get_type ())
+
+G_DECLARE_FINAL_TYPE (NotifyTemplate, notify_template, NOTIFY, TEMPLATE, GObject);
+
+/**
+ * NotifyTemplate:
+ *
+ * The parts shared by many notifications.
+ *
+ * #NotifyTemplate holds the application name and icon, icon, timeout,
+ * hints and actions of notifications that only differ by their text. The
+ * notifications created with [ctor@Notification.new_from_template] share
+ * the hints and actions of the template until either of them changes
+ * them, so that creating them doesn't copy anything but their text.
+ *
+ * Since: 0.8.8
+ */
+
+NotifyTemplate     *notify_template_new                   (void);
+
+void                notify_template_set_app_name          (NotifyTemplate      *tmpl,
+                                                           const char          *app_name);
+
+void                notify_template_set_app_icon          (NotifyTemplate      *tmpl,
+                                                           const char          *app_icon);
+
+void                notify_template_set_icon_name         (NotifyTemplate      *tmpl,
+                                                           const char          *icon_name);
+
+void                notify_template_set_timeout           (NotifyTemplate      *tmpl,
+                                                           gint                 timeout);
+
+void                notify_template_set_hint              (NotifyTemplate      *tmpl,
+                                                           const char          *key,
+                                                           GVariant            *value);
+
+void                notify_template_add_action            (NotifyTemplate      *tmpl,
+                                                           const char          *action,
+                                                           const char          *label,
+                                                           NotifyActionCallback callback,
+                                                           gpointer             user_data,
+                                                           GFreeFunc            free_func);
+
+NotifyNotification *notify_notification_new_from_template (NotifyTemplate      *tmpl,
+                                                           const char          *summary,
+                                                           const char          *body);
+
+G_END_DECLS
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * @file libnotify/trace.h Tracepoints
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+#ifndef _LIBNOTIFY_TRACE_H_
+#define _LIBNOTIFY_TRACE_H_
+
+#include <glib.h>
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#ifdef HAVE_USDT
+#include <sys/sdt.h>
+#endif
+
+/*
+ * Tracepoints around the calls to the server, the serialization of the
+ * hints, the conversion of the images and the handling of the server
+ * signals and of the actions.
+ *
+ * With the sysprof option, each traced step is a capture mark of the
+ * "libnotify" group spanning from NOTIFY_TRACE_TIME() to the
+ * NOTIFY_TRACE_MARK() ending it. With the usdt option, the steps are also
+ * surrounded by USDT probes of the "libnotify" provider, named after the
+ * step with a "__begin" or "__end" suffix, that perf or bpftrace can
+ * attach to. Without these options they compile to nothing.
+ */
+
+#ifdef HAVE_SYSPROF
+#define NOTIFY_TRACE_TIME() SYSPROF_CAPTURE_CURRENT_TIME
+#define NOTIFY_TRACE_MARK(begin, name, ...)                                 \
+        sysprof_collector_mark_printf ((begin),                             \
+                                       SYSPROF_CAPTURE_CURRENT_TIME - (begin), \
+                                       "libnotify", (name), __VA_ARGS__)
+#else
+#define NOTIFY_TRACE_TIME() G_GINT64_CONSTANT (0)
+#define NOTIFY_TRACE_MARK(begin, name, ...) G_STMT_START { (void) (begin); } G_STMT_END
+#endif
+
+#ifdef HAVE_USDT
+#define NOTIFY_PROBE1(name, a)       DTRACE_PROBE1 (libnotify, name, a)
+#define NOTIFY_PROBE2(name, a, b)    DTRACE_PROBE2 (libnotify, name, a, b)
+#define NOTIFY_PROBE3(name, a, b, c) DTRACE_PROBE3 (libnotify, name, a, b, c)
+#else
+#define NOTIFY_PROBE1(name, a)
+#define NOTIFY_PROBE2(name, a, b)
+#define NOTIFY_PROBE3(name, a, b, c)
+#endif
+
+#endif /* _LIBNOTIFY_TRACE_H_ */
@@ -0,0 +1,176 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+
+#include <gio/gio.h>
+
+/*
+ * Has the mock notification server invoke actions whose IDs differ in
+ * case from the ones added, with enough actions to use the index of the
+ * actions and with too few of them.
+ */
+
+static const char *invoked = NULL;
+
+static void
+on_action (NotifyNotification *n,
+           const char         *action,
+           gpointer            user_data)
+{
+        invoked = user_data;
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        gboolean *timed_out = user_data;
+
+        *timed_out = TRUE;
+        return G_SOURCE_REMOVE;
+}
+
+static void
+add_action (NotifyNotification *n,
+            const char         *id,
+            const char         *tag)
+{
+        notify_notification_add_action (n, id, id, on_action,
+                                        (gpointer) tag, NULL);
+}
+
+static void
+assert_invokes (NotifyNotification *n,
+                const char         *action,
+                const char         *expected)
+{
+        GDBusConnection *connection;
+        GVariantBuilder args;
+        GVariant *result;
+        GError *error = NULL;
+        gboolean timed_out = FALSE;
+        guint timeout_id;
+        gint id;
+
+        g_object_get (n, "id", &id, NULL);
+        g_assert_cmpint (id, !=, 0);
+
+        invoked = NULL;
+
+        g_variant_builder_init (&args, G_VARIANT_TYPE ("av"));
+        g_variant_builder_add (&args, "v", g_variant_new_uint32 (id));
+        g_variant_builder_add (&args, "v", g_variant_new_string (action));
+
+        connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+        g_assert_no_error (error);
+
+        result = g_dbus_connection_call_sync (connection,
+                                              "org.freedesktop.Notifications",
+                                              "/org/freedesktop/Notifications",
+                                              "org.freedesktop.DBus.Mock",
+                                              "EmitSignal",
+                                              g_variant_new ("(sssav)",
+                                                             "org.freedesktop.Notifications",
+                                                             "ActionInvoked",
+                                                             "us",
+                                                             &args),
+                                              NULL,
+                                              G_DBUS_CALL_FLAGS_NONE,
+                                              -1,
+                                              NULL,
+                                              &error);
+        g_assert_no_error (error);
+        g_variant_unref (result);
+        g_object_unref (connection);
+
+        timeout_id = g_timeout_add_seconds (5, on_timeout, &timed_out);
+        while (!timed_out && invoked == NULL) {
+                g_main_context_iteration (NULL, TRUE);
+        }
+        g_assert_false (timed_out);
+        g_source_remove (timeout_id);
+
+        g_assert_cmpstr (invoked, ==, expected);
+}
+
+static void
+show_or_die (NotifyNotification *n)
+{
+        GError *error = NULL;
+
+        if (!notify_notification_show (n, &error)) {
+                fprintf (stderr, "failed to show notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                exit (1);
+        }
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+
+        /* Unknown actions are only warned about */
+        g_log_set_always_fatal (G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL);
+
+        notify_init ("Action Lookup");
+
+        /* Enough actions to be indexed */
+        n = notify_notification_new ("Many actions", NULL, NULL);
+        add_action (n, "reply", "reply");
+        add_action (n, "Archive", "first archive");
+        add_action (n, "MARK-READ", "mark-read");
+        add_action (n, "delete", "delete");
+        add_action (n, "Snooze", "snooze");
+        /* Replaces the first one, only differing by case */
+        add_action (n, "archive", "second archive");
+        show_or_die (n);
+
+        assert_invokes (n, "REPLY", "reply");
+        assert_invokes (n, "mark-read", "mark-read");
+        assert_invokes (n, "Delete", "delete");
+        assert_invokes (n, "sNOOZE", "snooze");
+        assert_invokes (n, "ARCHIVE", "second archive");
+        assert_invokes (n, "Archive", "second archive");
+
+        notify_notification_close (n, NULL);
+        g_object_unref (n);
+
+        /* Too few actions to be indexed, looked up one after the other */
+        n = notify_notification_new ("Few actions", NULL, NULL);
+        add_action (n, "Yes", "first yes");
+        add_action (n, "no", "no");
+        add_action (n, "YES", "second yes");
+        show_or_die (n);
+
+        assert_invokes (n, "NO", "no");
+        assert_invokes (n, "yes", "second yes");
+
+        notify_notification_close (n, NULL);
+        g_object_unref (n);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,93 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+static void
+on_closed (NotifyNotification *n,
+           gpointer            user_data)
+{
+        gboolean *closed = user_data;
+
+        *closed = TRUE;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        char *path;
+        char *contents;
+        char **lines;
+        char *name;
+        gboolean closed = FALSE;
+        int fd;
+
+        fd = g_file_open_tmp ("test-backend-XXXXXX.log", &path, NULL);
+        g_assert_cmpint (fd, >=, 0);
+        close (fd);
+
+        /* The log backend doesn't need a notification server */
+        notify_set_backend (NOTIFY_BACKEND_LOG);
+        notify_set_log_file (path);
+        notify_init ("Backend");
+
+        g_assert_true (notify_get_server_info (&name, NULL, NULL, NULL));
+        g_assert_cmpstr (name, ==, "Log");
+        g_free (name);
+
+        n = notify_notification_new ("Logged", "With a \"quoted\" body", NULL);
+        g_signal_connect (n, "closed", G_CALLBACK (on_closed), &closed);
+
+        g_assert_true (notify_notification_show (n, NULL));
+        g_assert_true (notify_notification_close (n, NULL));
+        g_assert_true (closed);
+        g_assert_cmpint (notify_notification_get_closed_reason (n), ==,
+                         NOTIFY_CLOSED_REASON_API_REQUEST);
+        g_object_unref (n);
+
+        notify_uninit ();
+
+        g_assert_true (g_file_get_contents (path, &contents, NULL, NULL));
+        lines = g_strsplit (contents, "\n", -1);
+        g_assert_cmpuint (g_strv_length (lines), ==, 3);
+        g_assert_nonnull (strstr (lines[0], "\"event\":\"show\""));
+        g_assert_nonnull (strstr (lines[0], "\"body\":\"With a \\\"quoted\\\" body\""));
+        g_assert_nonnull (strstr (lines[1], "\"event\":\"close\""));
+        g_strfreev (lines);
+        g_free (contents);
+
+        g_unlink (path);
+        g_free (path);
+
+        /* The null backend drops everything */
+        notify_set_backend (NOTIFY_BACKEND_NULL);
+        notify_init ("Backend");
+
+        g_assert_true (notify_send_simple ("Dropped", NULL, NULL,
+                                           NOTIFY_URGENCY_NORMAL, NULL));
+
+        notify_uninit ();
+
+        return 0;
+}
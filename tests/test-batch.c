@@ -0,0 +1,136 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#define N_NOTIFICATIONS 50
+
+static GMainLoop *loop;
+static gboolean   failed;
+
+static void
+on_batch_done (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+        NotifyBatch *batch = NOTIFY_BATCH (source);
+        GError *error = NULL;
+
+        if (!notify_batch_submit_finish (batch, result, &error)) {
+                fprintf (stderr, "batch failed: %s\n", error->message);
+                g_error_free (error);
+                failed = TRUE;
+        }
+
+        for (guint i = 0; i < notify_batch_get_n_items (batch); ++i) {
+                const GError *item_error = notify_batch_get_error (batch, i);
+
+                if (item_error != NULL) {
+                        fprintf (stderr, "operation %u failed: %s\n",
+                                 i, item_error->message);
+                        failed = TRUE;
+                }
+        }
+
+        g_main_loop_quit (loop);
+}
+
+static void
+run_batch (NotifyBatch *batch)
+{
+        notify_batch_submit (batch, NULL, on_batch_done, NULL);
+        g_main_loop_run (loop);
+        g_object_unref (batch);
+}
+
+int
+main ()
+{
+        NotifyNotification *notifications[N_NOTIFICATIONS];
+        NotifyBatch *batch;
+        NotifyStatistics *stats;
+        guint64 hits;
+        guint64 misses;
+
+        notify_init ("Batch Test");
+
+        loop = g_main_loop_new (NULL, FALSE);
+
+        batch = notify_batch_new ();
+
+        for (guint i = 0; i < N_NOTIFICATIONS; ++i) {
+                g_autofree char *body = g_strdup_printf ("Message %u", i);
+
+                notifications[i] = notify_notification_new ("Batched", body,
+                                                             NULL);
+                notify_batch_add_show (batch, notifications[i]);
+        }
+
+        run_batch (batch);
+
+        for (guint i = 0; i < N_NOTIFICATIONS; ++i) {
+                gint id;
+
+                g_object_get (notifications[i], "id", &id, NULL);
+
+                if (id == 0) {
+                        fprintf (stderr, "notification %u got no id\n", i);
+                        failed = TRUE;
+                }
+        }
+
+        batch = notify_batch_new ();
+
+        for (guint i = 0; i < N_NOTIFICATIONS; ++i) {
+                notify_batch_add_close (batch, notifications[i]);
+        }
+
+        run_batch (batch);
+
+        for (guint i = 0; i < N_NOTIFICATIONS; ++i) {
+                g_object_unref (notifications[i]);
+        }
+
+        /* Batched notifications are deduplicated like shown ones */
+        notify_set_deduplication (NOTIFY_DEDUP_SUPPRESS, 0);
+        notify_reset_statistics ();
+
+        for (guint i = 0; i < 2; ++i) {
+                NotifyNotification *n;
+
+                n = notify_notification_new ("Batched", "Duplicated", NULL);
+                batch = notify_batch_new ();
+                notify_batch_add_show (batch, n);
+                run_batch (batch);
+                g_object_unref (n);
+        }
+
+        notify_get_deduplication_stats (&hits, &misses);
+        g_assert_cmpuint (hits, ==, 1);
+        g_assert_cmpuint (misses, ==, 1);
+
+        stats = notify_get_statistics ();
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_SHOWS), ==, 1);
+        notify_statistics_free (stats);
+
+        g_main_loop_unref (loop);
+
+        return failed ? 1 : 0;
+}
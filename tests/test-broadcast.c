@@ -0,0 +1,128 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+#include <unistd.h>
+
+/* Delivers to the real user sessions, not to the test bus */
+
+static GMainLoop *loop;
+
+static void
+on_submitted (GObject      *source,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+        GError **error = user_data;
+
+        notify_broadcast_submit_finish (NOTIFY_BROADCAST (source), result, error);
+        g_main_loop_quit (loop);
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        NotifyBroadcast *broadcast;
+        GError *error = NULL;
+        gboolean found_own = FALSE;
+        char *own_bus;
+        guint n_failed = 0;
+
+        notify_init ("Broadcast");
+
+        loop = g_main_loop_new (NULL, FALSE);
+
+        n = notify_notification_new ("Broadcast", "Shown in every session", NULL);
+        notify_notification_set_urgency (n, NOTIFY_URGENCY_LOW);
+
+        broadcast = notify_broadcast_new (n);
+        notify_broadcast_set_max_concurrent (broadcast, 2);
+
+        /* The broadcast delivers a copy */
+        notify_notification_update (n, "Changed", NULL, NULL);
+
+        notify_broadcast_submit (broadcast, NULL, on_submitted, &error);
+        g_main_loop_run (loop);
+
+        if (error != NULL && g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+                g_print ("No user sessions to deliver to\n");
+                g_error_free (error);
+                return 77;
+        }
+
+        for (guint i = 0; i < notify_broadcast_get_n_sessions (broadcast); ++i) {
+                NotifyNotification *copy = notify_broadcast_get_notification (broadcast, i);
+                const GError *session_error = notify_broadcast_get_error (broadcast, i);
+                char *summary;
+                gint id;
+
+                g_print ("%u %s: %s\n",
+                         notify_broadcast_get_uid (broadcast, i),
+                         notify_broadcast_get_address (broadcast, i),
+                         session_error ? session_error->message : "delivered");
+
+                if (i > 0) {
+                        g_assert_cmpuint (notify_broadcast_get_uid (broadcast, i - 1), <,
+                                          notify_broadcast_get_uid (broadcast, i));
+                }
+
+                if (notify_broadcast_get_uid (broadcast, i) == getuid ()) {
+                        found_own = TRUE;
+                }
+
+                if (session_error != NULL) {
+                        n_failed++;
+                        continue;
+                }
+
+                g_assert_nonnull (copy);
+                g_assert_true (notify_notification_get_client (copy) !=
+                               notify_client_get_default ());
+
+                g_object_get (copy, "summary", &summary, "id", &id, NULL);
+                g_assert_cmpstr (summary, ==, "Broadcast");
+                g_assert_cmpint (id, >, 0);
+                g_free (summary);
+
+                notify_notification_close (copy, NULL);
+        }
+
+        /* The session of the user running the test, if there's one */
+        own_bus = g_strdup_printf ("/run/user/%u/bus", (guint) getuid ());
+        g_assert_true (found_own || !g_file_test (own_bus, G_FILE_TEST_EXISTS));
+        g_free (own_bus);
+
+        if (n_failed > 0) {
+                g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+                g_clear_error (&error);
+        } else {
+                g_assert_no_error (error);
+        }
+
+        g_object_unref (broadcast);
+        g_object_unref (n);
+        g_main_loop_unref (loop);
+
+        notify_uninit ();
+
+        return 0;
+}
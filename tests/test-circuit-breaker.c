@@ -0,0 +1,263 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <gio/gio.h>
+
+#define COOLDOWN 200
+
+/*
+ * A notification server on a peer-to-peer connection that can stop
+ * answering. It then replies to every call with the error the bus sends
+ * when a server never replies, rather than making the calls wait for the
+ * D-Bus timeout.
+ */
+static GDBusServer *server;
+static GMutex       server_lock;
+static GCond        server_cond;
+static gint         unresponsive = FALSE;
+static gint         n_calls = 0;
+static guint        next_id = 1;
+
+static guint fallbacks = 0;
+
+static GDBusMessage *
+on_message (GDBusConnection *connection,
+            GDBusMessage    *message,
+            gboolean         incoming,
+            gpointer         user_data)
+{
+        GDBusMessage *reply;
+        const char *member;
+
+        if (!incoming ||
+            g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL ||
+            g_strcmp0 (g_dbus_message_get_interface (message),
+                       "org.freedesktop.Notifications") != 0) {
+                return message;
+        }
+
+        g_atomic_int_inc (&n_calls);
+        member = g_dbus_message_get_member (message);
+
+        if (g_atomic_int_get (&unresponsive)) {
+                reply = g_dbus_message_new_method_error_literal (message,
+                                                                 "org.freedesktop.DBus.Error.NoReply",
+                                                                 "The server did not reply");
+        } else if (g_str_equal (member, "GetServerInformation")) {
+                reply = g_dbus_message_new_method_reply (message);
+                g_dbus_message_set_body (reply, g_variant_new ("(ssss)", "Fake", "libnotify",
+                                                               "1.0", "1.2"));
+        } else if (g_str_equal (member, "GetCapabilities")) {
+                const char *caps[] = { "body", NULL };
+
+                reply = g_dbus_message_new_method_reply (message);
+                g_dbus_message_set_body (reply, g_variant_new ("(^as)", caps));
+        } else if (g_str_equal (member, "Notify")) {
+                reply = g_dbus_message_new_method_reply (message);
+                g_dbus_message_set_body (reply, g_variant_new ("(u)", next_id++));
+        } else if (g_str_equal (member, "CloseNotification")) {
+                reply = g_dbus_message_new_method_reply (message);
+        } else {
+                reply = g_dbus_message_new_method_error_literal (message,
+                                                                 "org.freedesktop.DBus.Error.UnknownMethod",
+                                                                 "Unknown method");
+        }
+
+        g_dbus_connection_send_message (connection, reply,
+                                        G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+                                        NULL, NULL);
+        g_object_unref (reply);
+        g_object_unref (message);
+
+        return NULL;
+}
+
+static gboolean
+on_new_connection (GDBusServer     *dbus_server,
+                   GDBusConnection *connection,
+                   gpointer         user_data)
+{
+        g_dbus_connection_add_filter (connection, on_message, NULL, NULL);
+        g_object_ref (connection);
+
+        return TRUE;
+}
+
+static gpointer
+run_server (gpointer user_data)
+{
+        GMainContext *context = g_main_context_new ();
+        GMainLoop *loop = g_main_loop_new (context, FALSE);
+        char *address;
+        char *guid;
+
+        g_main_context_push_thread_default (context);
+
+        address = g_strdup_printf ("unix:tmpdir=%s", g_get_tmp_dir ());
+        guid = g_dbus_generate_guid ();
+
+        g_mutex_lock (&server_lock);
+        server = g_dbus_server_new_sync (address, G_DBUS_SERVER_FLAGS_NONE,
+                                         guid, NULL, NULL, NULL);
+        g_assert_nonnull (server);
+        g_signal_connect (server, "new-connection",
+                          G_CALLBACK (on_new_connection), NULL);
+        g_dbus_server_start (server);
+        g_cond_signal (&server_cond);
+        g_mutex_unlock (&server_lock);
+
+        g_free (address);
+        g_free (guid);
+
+        g_main_loop_run (loop);
+
+        return NULL;
+}
+
+static void
+on_fallback (NotifyNotification *n,
+             gpointer            user_data)
+{
+        fallbacks++;
+}
+
+static void
+on_batch_done (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+        g_assert_false (notify_batch_submit_finish (NOTIFY_BATCH (source),
+                                                    result, NULL));
+        g_main_loop_quit (user_data);
+}
+
+static gboolean
+show (const char *summary,
+      GError    **error)
+{
+        NotifyNotification *n;
+        gboolean ret;
+
+        n = notify_notification_new (summary, NULL, NULL);
+        ret = notify_notification_show (n, error);
+        g_object_unref (n);
+
+        return ret;
+}
+
+int
+main ()
+{
+        GDBusConnection *connection;
+        NotifyNotification *n;
+        NotifyStatistics *stats;
+        NotifyBatch *batch;
+        GMainLoop *loop;
+        GError *error = NULL;
+        gint calls;
+
+        g_mutex_lock (&server_lock);
+        g_thread_unref (g_thread_new ("server", run_server, NULL));
+        while (server == NULL) {
+                g_cond_wait (&server_cond, &server_lock);
+        }
+        g_mutex_unlock (&server_lock);
+
+        connection = g_dbus_connection_new_for_address_sync (g_dbus_server_get_client_address (server),
+                                                             G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                                             NULL, NULL, &error);
+        g_assert_no_error (error);
+
+        g_assert_true (notify_init_with_connection ("Circuit breaker", connection));
+        notify_set_circuit_breaker (2, 0, COOLDOWN);
+        notify_set_fallback_sink (on_fallback, NULL, NULL);
+
+        g_assert_true (show ("Server running", NULL));
+        g_assert_cmpuint (fallbacks, ==, 0);
+
+        /* The server stops replying: the failures open the circuit */
+        g_atomic_int_set (&unresponsive, TRUE);
+
+        g_assert_false (show ("First failure", &error));
+        g_assert_error (error, G_DBUS_ERROR, G_DBUS_ERROR_NO_REPLY);
+        g_clear_error (&error);
+        g_assert_false (show ("Second failure", &error));
+        g_assert_error (error, G_DBUS_ERROR, G_DBUS_ERROR_NO_REPLY);
+        g_clear_error (&error);
+
+        /* Open: the server isn't called anymore, nor the other calls */
+        calls = g_atomic_int_get (&n_calls);
+        notify_reset_statistics ();
+        g_assert_true (show ("Fallen back", NULL));
+        g_assert_cmpuint (fallbacks, ==, 1);
+        g_assert_false (notify_get_server_info (NULL, NULL, NULL, NULL));
+        g_assert_cmpint (g_atomic_int_get (&n_calls), ==, calls);
+
+        /* The skipped show isn't accounted */
+        stats = notify_get_statistics ();
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_SHOWS), ==, 0);
+        notify_statistics_free (stats);
+
+        /* Nor are the closes of a batch sent */
+        n = notify_notification_new ("Closed", NULL, NULL);
+        batch = notify_batch_new ();
+        notify_batch_add_close (batch, n);
+        loop = g_main_loop_new (NULL, FALSE);
+        notify_batch_submit (batch, NULL, on_batch_done, loop);
+        g_main_loop_run (loop);
+        g_main_loop_unref (loop);
+        g_assert_error (notify_batch_get_error (batch, 0),
+                        G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED);
+        g_assert_cmpint (g_atomic_int_get (&n_calls), ==, calls);
+        g_object_unref (batch);
+        g_object_unref (n);
+
+        /* Nor is the proxy created again */
+        notify_uninit ();
+        g_assert_true (notify_init_with_connection ("Circuit breaker", connection));
+        g_assert_true (show ("Fallen back without a proxy", NULL));
+        g_assert_cmpuint (fallbacks, ==, 2);
+        g_assert_cmpint (g_atomic_int_get (&n_calls), ==, calls);
+
+        /* Half-open: a single probe, failing, so the circuit opens again */
+        g_usleep ((COOLDOWN + 50) * G_TIME_SPAN_MILLISECOND);
+        g_assert_true (show ("Failed probe", NULL));
+        g_assert_cmpuint (fallbacks, ==, 3);
+        g_assert_cmpint (g_atomic_int_get (&n_calls), ==, calls + 1);
+
+        g_assert_true (show ("Fallen back again", NULL));
+        g_assert_cmpuint (fallbacks, ==, 4);
+        g_assert_cmpint (g_atomic_int_get (&n_calls), ==, calls + 1);
+
+        /* The server is back: the probe succeeds and closes the circuit */
+        g_atomic_int_set (&unresponsive, FALSE);
+        g_usleep ((COOLDOWN + 50) * G_TIME_SPAN_MILLISECOND);
+        g_assert_true (show ("Successful probe", NULL));
+        g_assert_true (show ("Circuit closed", NULL));
+        g_assert_cmpuint (fallbacks, ==, 4);
+
+        notify_uninit ();
+        g_object_unref (connection);
+
+        return 0;
+}
@@ -0,0 +1,118 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+
+#define TEST_TIMEOUT 5
+
+static GMainLoop *loop;
+
+static void
+on_closed (NotifyNotification *n,
+           gpointer            user_data)
+{
+        guint *n_closed = user_data;
+
+        if (++*n_closed == 2) {
+                g_main_loop_quit (loop);
+        }
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        g_error ("The closed signals were not delivered");
+
+        return G_SOURCE_REMOVE;
+}
+
+int
+main ()
+{
+        NotifyClient *clients[2];
+        NotifyNotification *notifications[2];
+        GError *error = NULL;
+        char *spec_version;
+        GList *caps;
+        guint n_closed = 0;
+
+        loop = g_main_loop_new (NULL, FALSE);
+        g_timeout_add_seconds (TEST_TIMEOUT, on_timeout, NULL);
+
+        /* The clients don't need the global state */
+        g_assert_false (notify_is_initted ());
+
+        for (guint i = 0; i < G_N_ELEMENTS (clients); ++i) {
+                char *app_name = g_strdup_printf ("Client %u", i);
+
+                clients[i] = notify_client_new (app_name, NULL);
+                g_assert_true (clients[i] != notify_client_get_default ());
+                g_assert_cmpstr (notify_client_get_app_name (clients[i]), ==, app_name);
+                g_free (app_name);
+
+                if (!notify_client_get_server_info (clients[i], NULL, NULL,
+                                                    NULL, &spec_version,
+                                                    &error)) {
+                        fprintf (stderr, "failed to get the server info: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+                g_assert_nonnull (spec_version);
+                g_free (spec_version);
+
+                caps = notify_client_get_server_caps (clients[i]);
+                g_assert_nonnull (caps);
+                g_list_free_full (caps, g_free);
+
+                notifications[i] = notify_client_new_notification (clients[i],
+                                                                   "Bound to a client",
+                                                                   NULL, NULL);
+                g_assert_true (notify_notification_get_client (notifications[i]) == clients[i]);
+                g_signal_connect (notifications[i], "closed",
+                                  G_CALLBACK (on_closed), &n_closed);
+
+                if (!notify_notification_show (notifications[i], &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+
+        /* Each client routes the signals of its own server */
+        for (guint i = 0; i < G_N_ELEMENTS (clients); ++i) {
+                g_assert_true (notify_notification_close (notifications[i], NULL));
+        }
+
+        g_main_loop_run (loop);
+        g_assert_cmpuint (n_closed, ==, 2);
+
+        for (guint i = 0; i < G_N_ELEMENTS (clients); ++i) {
+                g_object_unref (notifications[i]);
+                g_object_unref (clients[i]);
+        }
+
+        g_main_loop_unref (loop);
+
+        return 0;
+}
@@ -0,0 +1,74 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+
+int
+main ()
+{
+        NotifyNotification *n;
+        GDBusConnection *connection;
+        GDBusConnection *other;
+        GError *error = NULL;
+
+        connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+        if (connection == NULL) {
+                fprintf (stderr, "failed to connect to the bus: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        /* The application connection is shared */
+        g_assert_true (notify_init_with_connection ("Connection", connection));
+        g_assert_true (notify_init_with_connection ("Connection", connection));
+
+        /* Another connection can't be used until uninitialized */
+        other = g_dbus_connection_new_for_address_sync (g_getenv ("DBUS_SESSION_BUS_ADDRESS"),
+                                                        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                        G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                        NULL, NULL, NULL);
+        if (other != NULL) {
+                g_assert_false (notify_init_with_connection ("Connection", other));
+                g_object_unref (other);
+        }
+
+        n = notify_notification_new ("Shared connection", NULL, NULL);
+
+        if (!notify_notification_show (n, &error) ||
+            !notify_notification_close (n, &error)) {
+                fprintf (stderr, "failed to show and close notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        g_object_unref (n);
+
+        notify_uninit ();
+
+        /* It's still usable by the application */
+        g_assert_false (g_dbus_connection_is_closed (connection));
+        g_object_unref (connection);
+
+        return 0;
+}
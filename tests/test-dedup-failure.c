@@ -0,0 +1,218 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+
+#include <gio/gio.h>
+
+/*
+ * A notification server on a peer-to-peer connection that can fail the
+ * next Notify call, and that records the Notify calls it gets.
+ */
+static GDBusServer *server;
+static GMutex       server_lock;
+static GCond        server_cond;
+static gint         fail_next = FALSE;
+static gint         n_notify = 0;
+static gint         last_replaces_id = 0;
+static guint        next_id = 1;
+
+static GDBusMessage *
+on_message (GDBusConnection *connection,
+            GDBusMessage    *message,
+            gpointer         user_data)
+{
+        GDBusMessage *reply;
+        const char *member;
+
+        member = g_dbus_message_get_member (message);
+
+        if (g_str_equal (member, "GetServerInformation")) {
+                reply = g_dbus_message_new_method_reply (message);
+                g_dbus_message_set_body (reply, g_variant_new ("(ssss)", "Fake", "libnotify",
+                                                               "1.0", "1.2"));
+        } else if (g_str_equal (member, "GetCapabilities")) {
+                const char *caps[] = { "body", NULL };
+
+                reply = g_dbus_message_new_method_reply (message);
+                g_dbus_message_set_body (reply, g_variant_new ("(^as)", caps));
+        } else if (g_str_equal (member, "Notify")) {
+                guint32 replaces_id;
+
+                g_atomic_int_inc (&n_notify);
+                g_variant_get_child (g_dbus_message_get_body (message), 1,
+                                     "u", &replaces_id);
+                g_atomic_int_set (&last_replaces_id, replaces_id);
+
+                if (g_atomic_int_compare_and_exchange (&fail_next, TRUE, FALSE)) {
+                        reply = g_dbus_message_new_method_error_literal (message,
+                                                                         "org.freedesktop.DBus.Error.Failed",
+                                                                         "Failed to show the notification");
+                } else {
+                        reply = g_dbus_message_new_method_reply (message);
+                        g_dbus_message_set_body (reply,
+                                                 g_variant_new ("(u)",
+                                                                replaces_id != 0 ? replaces_id : next_id++));
+                }
+        } else {
+                reply = g_dbus_message_new_method_error_literal (message,
+                                                                 "org.freedesktop.DBus.Error.UnknownMethod",
+                                                                 "Unknown method");
+        }
+
+        g_dbus_connection_send_message (connection, reply,
+                                        G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+                                        NULL, NULL);
+        g_object_unref (reply);
+
+        return NULL;
+}
+
+static GDBusMessage *
+on_filter (GDBusConnection *connection,
+           GDBusMessage    *message,
+           gboolean         incoming,
+           gpointer         user_data)
+{
+        if (!incoming ||
+            g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL ||
+            g_strcmp0 (g_dbus_message_get_interface (message),
+                       "org.freedesktop.Notifications") != 0) {
+                return message;
+        }
+
+        on_message (connection, message, user_data);
+        g_object_unref (message);
+
+        return NULL;
+}
+
+static gboolean
+on_new_connection (GDBusServer     *dbus_server,
+                   GDBusConnection *connection,
+                   gpointer         user_data)
+{
+        g_dbus_connection_add_filter (connection, on_filter, NULL, NULL);
+        g_object_ref (connection);
+
+        return TRUE;
+}
+
+static gpointer
+run_server (gpointer user_data)
+{
+        GMainContext *context = g_main_context_new ();
+        GMainLoop *loop = g_main_loop_new (context, FALSE);
+        char *address;
+        char *guid;
+
+        g_main_context_push_thread_default (context);
+
+        address = g_strdup_printf ("unix:tmpdir=%s", g_get_tmp_dir ());
+        guid = g_dbus_generate_guid ();
+
+        g_mutex_lock (&server_lock);
+        server = g_dbus_server_new_sync (address, G_DBUS_SERVER_FLAGS_NONE,
+                                         guid, NULL, NULL, NULL);
+        g_assert_nonnull (server);
+        g_signal_connect (server, "new-connection",
+                          G_CALLBACK (on_new_connection), NULL);
+        g_dbus_server_start (server);
+        g_cond_signal (&server_cond);
+        g_mutex_unlock (&server_lock);
+
+        g_free (address);
+        g_free (guid);
+
+        g_main_loop_run (loop);
+
+        return NULL;
+}
+
+static gboolean
+show (const char *body,
+      GError    **error)
+{
+        NotifyNotification *n;
+        gboolean ret;
+
+        n = notify_notification_new ("Service down", body, NULL);
+        ret = notify_notification_show (n, error);
+        g_object_unref (n);
+
+        return ret;
+}
+
+int
+main ()
+{
+        GDBusConnection *connection;
+        GError *error = NULL;
+
+        g_mutex_lock (&server_lock);
+        g_thread_unref (g_thread_new ("server", run_server, NULL));
+        while (server == NULL) {
+                g_cond_wait (&server_cond, &server_lock);
+        }
+        g_mutex_unlock (&server_lock);
+
+        connection = g_dbus_connection_new_for_address_sync (g_dbus_server_get_client_address (server),
+                                                             G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                                             NULL, NULL, &error);
+        g_assert_no_error (error);
+
+        g_assert_true (notify_init_with_connection ("Dedup failure", connection));
+
+        /* A failed show doesn't suppress the next identical one */
+        notify_set_deduplication (NOTIFY_DEDUP_SUPPRESS, 0);
+
+        g_atomic_int_set (&fail_next, TRUE);
+        g_assert_false (show ("Suppressed", &error));
+        g_assert_error (error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED);
+        g_clear_error (&error);
+        g_assert_cmpint (g_atomic_int_get (&n_notify), ==, 1);
+
+        g_assert_true (show ("Suppressed", NULL));
+        g_assert_cmpint (g_atomic_int_get (&n_notify), ==, 2);
+
+        g_assert_true (show ("Suppressed", NULL));
+        g_assert_cmpint (g_atomic_int_get (&n_notify), ==, 2);
+
+        /* Nor leaves the next identical ones without a notification to
+         * update */
+        notify_set_deduplication (NOTIFY_DEDUP_UPDATE, 0);
+
+        g_atomic_int_set (&fail_next, TRUE);
+        g_assert_false (show ("Updated", NULL));
+        g_assert_cmpint (g_atomic_int_get (&n_notify), ==, 3);
+
+        g_assert_true (show ("Updated", NULL));
+        g_assert_cmpint (g_atomic_int_get (&n_notify), ==, 4);
+        g_assert_cmpint (g_atomic_int_get (&last_replaces_id), ==, 0);
+
+        g_assert_true (show ("Updated", NULL));
+        g_assert_cmpint (g_atomic_int_get (&n_notify), ==, 5);
+        g_assert_cmpint (g_atomic_int_get (&last_replaces_id), !=, 0);
+
+        notify_uninit ();
+        g_object_unref (connection);
+
+        return 0;
+}
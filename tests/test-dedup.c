@@ -0,0 +1,58 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+int
+main ()
+{
+        GError *error = NULL;
+        guint64 hits, misses;
+
+        notify_init ("Dedup");
+        notify_set_deduplication (NOTIFY_DEDUP_UPDATE, 0);
+
+        for (int i = 0; i < 5; ++i) {
+                NotifyNotification *n;
+
+                n = notify_notification_new ("Service down",
+                                             "The service is not responding",
+                                             "dialog-warning");
+                notify_notification_set_category (n, "network.error");
+
+                if (!notify_notification_show (n, &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+
+                g_object_unref (n);
+        }
+
+        notify_get_deduplication_stats (&hits, &misses);
+        g_assert_cmpuint (hits, ==, 4);
+        g_assert_cmpuint (misses, ==, 1);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,154 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#define TEST_TIMEOUT 5
+
+static GMainLoop *loop;
+static GThread *main_thread;
+
+static gint
+get_id (NotifyNotification *n)
+{
+        gint id;
+
+        g_object_get (n, "id", &id, NULL);
+
+        return id;
+}
+
+static void
+on_finalized (gpointer  user_data,
+              GObject  *where_the_object_was)
+{
+        gboolean *finalized = user_data;
+
+        /* The notifications are never released from the pool */
+        g_assert_true (g_thread_self () == main_thread);
+
+        *finalized = TRUE;
+}
+
+static void
+on_closed_in_pool (NotifyNotification *n,
+                   gpointer            user_data)
+{
+        gboolean *closed = user_data;
+
+        g_assert_true (g_thread_self () != main_thread);
+        g_assert_cmpint (get_id (n), !=, 0);
+
+        g_atomic_int_set (closed, TRUE);
+        g_main_loop_quit (loop);
+}
+
+static void
+on_closed_in_context (NotifyNotification *n,
+                      gpointer            user_data)
+{
+        gboolean *closed = user_data;
+
+        g_assert_true (g_thread_self () == main_thread);
+        g_assert_cmpint (notify_notification_get_closed_reason (n), ==,
+                         NOTIFY_CLOSED_REASON_API_REQUEST);
+        g_assert_cmpint (get_id (n), !=, 0);
+
+        *closed = TRUE;
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        g_error ("The closed signal was not delivered");
+
+        return G_SOURCE_REMOVE;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        GMainContext *context;
+        GError *error = NULL;
+        gboolean closed = FALSE;
+        gboolean finalized = FALSE;
+
+        notify_init ("Dispatch");
+
+        main_thread = g_thread_self ();
+        loop = g_main_loop_new (NULL, FALSE);
+        g_timeout_add_seconds (TEST_TIMEOUT, on_timeout, NULL);
+
+        /* The closed signal is emitted from a thread of the pool */
+        notify_set_dispatch_thread_pool (2);
+
+        n = notify_notification_new ("Delivered in a thread", NULL, NULL);
+        g_signal_connect (n, "closed", G_CALLBACK (on_closed_in_pool), &closed);
+        g_object_weak_ref (G_OBJECT (n), on_finalized, &finalized);
+
+        if (!notify_notification_show (n, &error) ||
+            !notify_notification_close (n, &error)) {
+                fprintf (stderr, "failed to show and close notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        g_main_loop_run (loop);
+        g_assert_true (g_atomic_int_get (&closed));
+        g_object_unref (n);
+
+        /* The last reference is dropped from this context */
+        while (!finalized) {
+                g_main_context_iteration (NULL, TRUE);
+        }
+
+        /* The per-notification context takes precedence over the pool */
+        context = g_main_context_new ();
+        closed = FALSE;
+
+        n = notify_notification_new ("Delivered in a context", NULL, NULL);
+        notify_notification_set_dispatch_context (n, context);
+        g_signal_connect (n, "closed", G_CALLBACK (on_closed_in_context), &closed);
+
+        if (!notify_notification_show (n, NULL) ||
+            !notify_notification_close (n, NULL)) {
+                return 1;
+        }
+
+        while (!closed) {
+                g_main_context_iteration (context, FALSE);
+                if (!closed) {
+                        g_main_context_iteration (NULL, TRUE);
+                }
+        }
+
+        g_object_unref (n);
+        g_main_context_unref (context);
+
+        notify_set_dispatch_thread_pool (0);
+        g_main_loop_unref (loop);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,118 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+#include <glib-unix.h>
+
+#define N_NOTIFICATIONS 3
+#define TEST_TIMEOUT 5
+
+static GMainLoop *loop;
+static NotifyNotification *shown[N_NOTIFICATIONS];
+static guint n_closed = 0;
+
+static gboolean
+on_events (int          fd,
+           GIOCondition condition,
+           gpointer     user_data)
+{
+        NotifyEventChannel *channel = user_data;
+        NotifyEvent events[2];
+        guint n_events;
+
+        /* Less than the pending events, to drain them in several batches */
+        n_events = notify_event_channel_drain (channel, events,
+                                               G_N_ELEMENTS (events));
+
+        for (guint i = 0; i < n_events; ++i) {
+                g_assert_cmpint (events[i].type, ==, NOTIFY_EVENT_CLOSED);
+                g_assert_cmpint (events[i].closed_reason, ==,
+                                 NOTIFY_CLOSED_REASON_API_REQUEST);
+                g_assert_true (events[i].notification == shown[n_closed]);
+                g_assert_cmpuint (events[i].id, !=, 0);
+                n_closed++;
+
+                notify_event_clear (&events[i]);
+        }
+
+        if (n_closed == N_NOTIFICATIONS) {
+                g_main_loop_quit (loop);
+        }
+
+        return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        g_error ("Only %u events were received", n_closed);
+
+        return G_SOURCE_REMOVE;
+}
+
+int
+main ()
+{
+        NotifyEventChannel *channel;
+        GError *error = NULL;
+        guint source_id;
+
+        notify_init ("Event Channel");
+
+        loop = g_main_loop_new (NULL, FALSE);
+        channel = notify_event_channel_get_default ();
+        g_assert_true (notify_event_channel_get_default () == channel);
+        g_object_unref (channel);
+
+        /* No signal handler is connected to the notifications */
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                shown[i] = notify_notification_new ("Build finished", NULL, NULL);
+
+                if (!notify_notification_show (shown[i], &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                notify_notification_close (shown[i], NULL);
+        }
+
+        source_id = g_unix_fd_add (notify_event_channel_get_fd (channel),
+                                   G_IO_IN, on_events, channel);
+        g_timeout_add_seconds (TEST_TIMEOUT, on_timeout, NULL);
+        g_main_loop_run (loop);
+
+        g_source_remove (source_id);
+        g_object_unref (channel);
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                g_object_unref (shown[i]);
+        }
+
+        g_main_loop_unref (loop);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,235 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+/*
+ * Reports and bounds the memory used by notifications, by wrapping the C
+ * library allocator.
+ */
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#define N_NOTIFICATIONS 1000
+
+/* A summary-only notification used to keep 6 blocks and about 400 bytes,
+ * before its hints became lazy and its texts shared a single block */
+#define MAX_ALLOCATIONS 8
+#define MAX_BLOCKS 4
+#define MAX_BYTES 320
+
+#ifdef __GLIBC__
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n_members, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void  __libc_free (void *ptr);
+
+/*
+ * The blocks allocated while counting, so that freeing the ones allocated
+ * before doesn't lower the count. An open addressing table, since the
+ * allocator can't be used to track itself.
+ */
+#define MAX_COUNTED_BLOCKS (1 << 17)
+#define REMOVED_BLOCK ((void *) 1)
+
+static void *counted_blocks[MAX_COUNTED_BLOCKS];
+
+static gboolean counting = FALSE;
+static gsize n_allocations = 0;
+static gsize n_blocks = 0;
+static gsize allocated_bytes = 0;
+
+static guint
+block_slot (void *ptr)
+{
+        return (guint) (((guintptr) ptr >> 4) * 2654435761u) % MAX_COUNTED_BLOCKS;
+}
+
+static void
+add_counted_block (void *ptr)
+{
+        guint slot = block_slot (ptr);
+
+        for (guint i = 0; i < MAX_COUNTED_BLOCKS; ++i) {
+                void **block = &counted_blocks[(slot + i) % MAX_COUNTED_BLOCKS];
+
+                if (*block == NULL || *block == REMOVED_BLOCK) {
+                        *block = ptr;
+                        return;
+                }
+        }
+
+        /* Can't report it through GLib, that would allocate */
+        abort ();
+}
+
+static gboolean
+remove_counted_block (void *ptr)
+{
+        guint slot = block_slot (ptr);
+
+        for (guint i = 0; i < MAX_COUNTED_BLOCKS; ++i) {
+                void **block = &counted_blocks[(slot + i) % MAX_COUNTED_BLOCKS];
+
+                if (*block == NULL) {
+                        return FALSE;
+                }
+
+                if (*block == ptr) {
+                        *block = REMOVED_BLOCK;
+                        return TRUE;
+                }
+        }
+
+        return FALSE;
+}
+
+static void *
+account_allocation (void *ptr)
+{
+        if (counting && ptr != NULL) {
+                n_allocations++;
+                n_blocks++;
+                allocated_bytes += malloc_usable_size (ptr);
+                add_counted_block (ptr);
+        }
+
+        return ptr;
+}
+
+static void
+account_free (void *ptr)
+{
+        if (ptr != NULL && remove_counted_block (ptr)) {
+                n_blocks--;
+                allocated_bytes -= malloc_usable_size (ptr);
+        }
+}
+
+void *
+malloc (size_t size)
+{
+        return account_allocation (__libc_malloc (size));
+}
+
+void *
+calloc (size_t n_members,
+        size_t size)
+{
+        return account_allocation (__libc_calloc (n_members, size));
+}
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+        account_free (ptr);
+        return account_allocation (__libc_realloc (ptr, size));
+}
+
+void
+free (void *ptr)
+{
+        account_free (ptr);
+        __libc_free (ptr);
+}
+
+static void
+measure (const char *description,
+         const char *summary,
+         const char *body,
+         const char *icon,
+         gboolean    check)
+{
+        NotifyNotification *notifications[N_NOTIFICATIONS];
+
+        memset (counted_blocks, 0, sizeof (counted_blocks));
+        n_allocations = 0;
+        n_blocks = 0;
+        allocated_bytes = 0;
+        counting = TRUE;
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                notifications[i] = notify_notification_new (summary, body, icon);
+        }
+
+        counting = FALSE;
+
+        g_print ("%s: %" G_GSIZE_FORMAT " bytes in %.1f blocks, "
+                 "%.1f allocations per notification\n",
+                 description,
+                 allocated_bytes / N_NOTIFICATIONS,
+                 (double) n_blocks / N_NOTIFICATIONS,
+                 (double) n_allocations / N_NOTIFICATIONS);
+
+        if (check) {
+                g_assert_cmpuint (n_allocations, <=, MAX_ALLOCATIONS * N_NOTIFICATIONS);
+                g_assert_cmpuint (n_blocks, <=, MAX_BLOCKS * N_NOTIFICATIONS);
+                g_assert_cmpuint (allocated_bytes, <=, MAX_BYTES * N_NOTIFICATIONS);
+        }
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                g_object_unref (notifications[i]);
+        }
+
+        /* Everything allocated for them is freed with them */
+        if (check) {
+                g_assert_cmpuint (n_blocks, ==, 0);
+                g_assert_cmpuint (allocated_bytes, ==, 0);
+        }
+}
+
+int
+main ()
+{
+        g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+        notify_init ("Footprint");
+
+        /* Initialize the type outside of the measures */
+        g_object_unref (notify_notification_new ("Warm up", NULL, NULL));
+
+        measure ("Summary only", "Message received", NULL, NULL, TRUE);
+        measure ("Summary and body", "Message received",
+                 "You have a new message from Alice", NULL, FALSE);
+        measure ("Summary, body and icon", "Message received",
+                 "You have a new message from Alice", "mail-unread", FALSE);
+
+        notify_uninit ();
+
+        return 0;
+}
+
+#else /* __GLIBC__ */
+
+int
+main ()
+{
+        g_print ("Measuring the footprint requires the GNU C library\n");
+
+        /* Skipped */
+        return 77;
+}
+
+#endif /* __GLIBC__ */
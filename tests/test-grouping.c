@@ -0,0 +1,190 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <gio/gio.h>
+
+/*
+ * Only the first notification should be shown right away, then replaced
+ * once by the digest of the other ones. Critical notifications are never
+ * grouped.
+ */
+
+#define N_NOTIFICATIONS 20
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        g_main_loop_quit (user_data);
+        return G_SOURCE_REMOVE;
+}
+
+/* Gets the arguments of the calls to Notify recorded by the mock server */
+static GVariant *
+get_notify_calls (void)
+{
+        GDBusConnection *connection;
+        GVariant *result;
+        GVariant *calls;
+        GError *error = NULL;
+
+        connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+        g_assert_no_error (error);
+
+        result = g_dbus_connection_call_sync (connection,
+                                              "org.freedesktop.Notifications",
+                                              "/org/freedesktop/Notifications",
+                                              "org.freedesktop.DBus.Mock",
+                                              "GetMethodCalls",
+                                              g_variant_new ("(s)", "Notify"),
+                                              G_VARIANT_TYPE ("(a(tav))"),
+                                              G_DBUS_CALL_FLAGS_NONE,
+                                              -1,
+                                              NULL,
+                                              &error);
+        g_assert_no_error (error);
+
+        calls = g_variant_get_child_value (result, 0);
+        g_variant_unref (result);
+        g_object_unref (connection);
+
+        return calls;
+}
+
+static GVariant *
+get_call_argument (GVariant *calls,
+                   gsize     index,
+                   gsize     argument)
+{
+        GVariant *call;
+        GVariant *args;
+        GVariant *boxed;
+        GVariant *value;
+
+        call = g_variant_get_child_value (calls, index);
+        args = g_variant_get_child_value (call, 1);
+        g_assert_cmpuint (g_variant_n_children (args), ==, 8);
+
+        boxed = g_variant_get_child_value (args, argument);
+        value = g_variant_get_variant (boxed);
+
+        g_variant_unref (boxed);
+        g_variant_unref (args);
+        g_variant_unref (call);
+
+        return value;
+}
+
+static void
+assert_call (GVariant   *calls,
+             gsize       index,
+             guint32     replaces_id,
+             const char *summary,
+             const char *body)
+{
+        GVariant *value;
+
+        value = get_call_argument (calls, index, 1);
+        g_assert_cmpuint (g_variant_get_uint32 (value), ==, replaces_id);
+        g_variant_unref (value);
+
+        value = get_call_argument (calls, index, 3);
+        g_assert_cmpstr (g_variant_get_string (value, NULL), ==, summary);
+        g_variant_unref (value);
+
+        value = get_call_argument (calls, index, 4);
+        g_assert_cmpstr (g_variant_get_string (value, NULL), ==, body);
+        g_variant_unref (value);
+}
+
+int
+main ()
+{
+        NotifyNotification *first = NULL;
+        NotifyNotification *n;
+        GMainLoop *loop;
+        GVariant *calls;
+        GError *error = NULL;
+        char *summary;
+        char *body;
+        gint first_id;
+
+        notify_init ("Grouping");
+        notify_set_grouping (NOTIFY_GROUP_BY_CATEGORY, 1000);
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                body = g_strdup_printf ("Build %d finished", i + 1);
+
+                n = notify_notification_new ("Build finished", body, NULL);
+                notify_notification_set_category (n, "transfer.complete");
+                g_free (body);
+
+                if (!notify_notification_show (n, &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+
+                if (first == NULL) {
+                        first = g_object_ref (n);
+                }
+
+                g_object_unref (n);
+        }
+
+        /* Shown right away, despite being in the same group */
+        n = notify_notification_new ("Build failed", "Build 21 failed", NULL);
+        notify_notification_set_category (n, "transfer.complete");
+        notify_notification_set_urgency (n, NOTIFY_URGENCY_CRITICAL);
+        g_assert_true (notify_notification_show (n, &error));
+        g_assert_no_error (error);
+        g_object_unref (n);
+
+        loop = g_main_loop_new (NULL, FALSE);
+        g_timeout_add_seconds (3, on_timeout, loop);
+        g_main_loop_run (loop);
+        g_main_loop_unref (loop);
+
+        g_object_get (first, "id", &first_id, NULL);
+        g_assert_cmpint (first_id, >, 0);
+
+        /* The first notification, the critical one, then the digest */
+        calls = get_notify_calls ();
+        g_assert_cmpuint (g_variant_n_children (calls), ==, 3);
+
+        assert_call (calls, 0, 0, "Build finished", "Build 1 finished");
+        assert_call (calls, 1, 0, "Build failed", "Build 21 failed");
+
+        summary = g_strdup_printf ("Build finished (%d)", N_NOTIFICATIONS);
+        body = g_strdup_printf ("Build %d finished", N_NOTIFICATIONS);
+        assert_call (calls, 2, first_id, summary, body);
+        g_free (summary);
+        g_free (body);
+
+        g_variant_unref (calls);
+        g_object_unref (first);
+
+        notify_uninit ();
+
+        return 0;
+}
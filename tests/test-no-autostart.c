@@ -0,0 +1,199 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+/* How long the fake server takes to fail its activation, in seconds */
+#define ACTIVATION_TIME 10
+
+/* Well below the activation time: the calls must not wait for it */
+#define MAX_CALL_TIME (2 * G_USEC_PER_SEC)
+
+/*
+ * Runs a message bus on which the notification server can be activated,
+ * but never owns its name: it leaves a marker file, then exits after a
+ * while. Calls waiting for the activation would block all that time.
+ */
+static GSubprocess *
+start_bus (const char *tmp_dir,
+           const char *marker)
+{
+        GSubprocess *bus;
+        GDataInputStream *output;
+        char *services_dir;
+        char *config;
+        char *path;
+        char *address;
+
+        services_dir = g_build_filename (tmp_dir, "services", NULL);
+        g_assert_cmpint (g_mkdir (services_dir, 0700), ==, 0);
+
+        config = g_strdup_printf ("[D-BUS Service]\n"
+                                  "Name=org.freedesktop.Notifications\n"
+                                  "Exec=/bin/sh -c 'touch %s && exec sleep %d'\n",
+                                  marker, ACTIVATION_TIME);
+        path = g_build_filename (services_dir,
+                                 "org.freedesktop.Notifications.service",
+                                 NULL);
+        g_assert_true (g_file_set_contents (path, config, -1, NULL));
+        g_free (path);
+        g_free (config);
+
+        config = g_strdup_printf ("<!DOCTYPE busconfig PUBLIC \"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\"\n"
+                                  " \"http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd\">\n"
+                                  "<busconfig>\n"
+                                  "  <type>session</type>\n"
+                                  "  <listen>unix:path=%s/bus</listen>\n"
+                                  "  <servicedir>%s</servicedir>\n"
+                                  "  <policy context=\"default\">\n"
+                                  "    <allow send_destination=\"*\" eavesdrop=\"true\"/>\n"
+                                  "    <allow eavesdrop=\"true\"/>\n"
+                                  "    <allow own=\"*\"/>\n"
+                                  "  </policy>\n"
+                                  "</busconfig>\n",
+                                  tmp_dir, services_dir);
+        path = g_build_filename (tmp_dir, "bus.conf", NULL);
+        g_assert_true (g_file_set_contents (path, config, -1, NULL));
+        g_free (config);
+        g_free (services_dir);
+
+        bus = g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE, NULL,
+                                "dbus-daemon", "--nofork", "--print-address",
+                                "--config-file", path, NULL);
+        g_assert_nonnull (bus);
+        g_free (path);
+
+        output = g_data_input_stream_new (g_subprocess_get_stdout_pipe (bus));
+        address = g_data_input_stream_read_line (output, NULL, NULL, NULL);
+        g_assert_nonnull (address);
+        g_object_unref (output);
+
+        g_setenv ("DBUS_SESSION_BUS_ADDRESS", g_strstrip (address), TRUE);
+        g_unsetenv ("NOTIFY_BUS_ADDRESS");
+        g_free (address);
+
+        return bus;
+}
+
+static gboolean
+wait_for_file (const char *path)
+{
+        gint64 end_time = g_get_monotonic_time () + MAX_CALL_TIME;
+
+        while (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+                if (g_get_monotonic_time () > end_time) {
+                        return FALSE;
+                }
+
+                g_main_context_iteration (NULL, FALSE);
+                g_usleep (10000);
+        }
+
+        return TRUE;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        GSubprocess *bus;
+        GError *error = NULL;
+        char *tmp_dir;
+        char *marker;
+        char *path;
+        gint64 start_time;
+
+        path = g_find_program_in_path ("dbus-daemon");
+        if (path == NULL) {
+                return 77;
+        }
+        g_free (path);
+
+        tmp_dir = g_dir_make_tmp ("test-no-autostart-XXXXXX", NULL);
+        g_assert_nonnull (tmp_dir);
+        marker = g_build_filename (tmp_dir, "activated", NULL);
+
+        bus = start_bus (tmp_dir, marker);
+
+        /* The spool queues the notification without waiting for the
+         * server, and starts it in the background */
+        notify_init ("No autostart");
+        notify_set_offline_spool_size (4);
+
+        n = notify_notification_new ("Spooled", NULL, NULL);
+
+        start_time = g_get_monotonic_time ();
+        g_assert_true (notify_notification_show (n, &error));
+        g_assert_no_error (error);
+        g_assert_cmpint (g_get_monotonic_time () - start_time, <, MAX_CALL_TIME);
+
+        g_assert_true (wait_for_file (marker));
+
+        g_object_unref (n);
+        notify_uninit ();
+
+        /* Without the spool nor the auto start, showing fails right away
+         * and nothing gets activated */
+        g_remove (marker);
+
+        notify_init ("No autostart");
+        notify_set_offline_spool_size (0);
+        notify_set_auto_start (FALSE);
+
+        n = notify_notification_new ("Not shown", NULL, NULL);
+
+        start_time = g_get_monotonic_time ();
+        g_assert_false (notify_notification_show (n, &error));
+        g_assert_error (error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN);
+        g_assert_cmpint (g_get_monotonic_time () - start_time, <, MAX_CALL_TIME);
+        g_clear_error (&error);
+
+        g_assert_false (wait_for_file (marker));
+
+        g_object_unref (n);
+        notify_uninit ();
+
+        g_subprocess_force_exit (bus);
+        g_subprocess_wait (bus, NULL, NULL);
+        g_object_unref (bus);
+
+        path = g_build_filename (tmp_dir, "services",
+                                 "org.freedesktop.Notifications.service",
+                                 NULL);
+        g_remove (path);
+        g_free (path);
+        path = g_build_filename (tmp_dir, "services", NULL);
+        g_rmdir (path);
+        g_free (path);
+        path = g_build_filename (tmp_dir, "bus.conf", NULL);
+        g_remove (path);
+        g_free (path);
+        path = g_build_filename (tmp_dir, "bus", NULL);
+        g_remove (path);
+        g_free (path);
+        g_rmdir (tmp_dir);
+        g_free (marker);
+        g_free (tmp_dir);
+
+        return 0;
+}
@@ -0,0 +1,134 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <glib/gstdio.h>
+
+/*
+ * Fills the outbox with expired notifications of a given size, then
+ * drops them, so that their records wrap around at various offsets.
+ */
+static void
+fill_and_drop (guint body_length)
+{
+        NotifyNotification *n;
+        char *body;
+        GError *error = NULL;
+        guint n_appended = 0;
+
+        body = g_strnfill (body_length, 'x');
+        n = notify_notification_new ("Outbox wrap-around", body, NULL);
+        notify_notification_set_timeout (n, 1);
+        g_free (body);
+
+        while (notify_outbox_append (n, &error)) {
+                n_appended++;
+        }
+
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+        g_clear_error (&error);
+        g_assert_cmpuint (n_appended, >, 0);
+
+        /* Expired, so dropped rather than sent */
+        g_usleep (2 * G_TIME_SPAN_MILLISECOND);
+        g_assert_cmpuint (notify_outbox_flush (&error), ==, 0);
+        g_assert_no_error (error);
+
+        g_object_unref (n);
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        GError *error = NULL;
+        const char *runtime_dir;
+        char *outbox_dir;
+        char *path;
+        char *tmp_dir;
+        guint n_sent;
+
+        /* Don't touch the outbox of the user, but keep finding the bus */
+        runtime_dir = g_getenv ("XDG_RUNTIME_DIR");
+        if (runtime_dir != NULL && g_getenv ("DBUS_SESSION_BUS_ADDRESS") == NULL) {
+                char *address = g_strdup_printf ("unix:path=%s/bus", runtime_dir);
+
+                g_setenv ("DBUS_SESSION_BUS_ADDRESS", address, TRUE);
+                g_free (address);
+        }
+
+        tmp_dir = g_dir_make_tmp ("test-outbox-XXXXXX", NULL);
+        g_assert_nonnull (tmp_dir);
+        g_setenv ("XDG_RUNTIME_DIR", tmp_dir, TRUE);
+
+        /* The outbox warns when it drops its content as corrupted */
+        g_log_set_always_fatal (G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL);
+
+        notify_init ("Outbox");
+
+        for (int i = 0; i < 3; ++i) {
+                char *summary = g_strdup_printf ("Outbox notification %d", i + 1);
+
+                n = notify_notification_new (summary,
+                                             "Sent through the outbox",
+                                             NULL);
+                g_free (summary);
+
+                if (!notify_outbox_append (n, &error)) {
+                        fprintf (stderr, "failed to append notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+
+                g_object_unref (n);
+        }
+
+        n_sent = notify_outbox_flush (&error);
+        if (error != NULL) {
+                fprintf (stderr, "failed to flush the outbox: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        g_assert_cmpuint (n_sent, ==, 3);
+
+        /* Records of many sizes end up leaving the end of the buffer too
+         * short for a record header */
+        for (guint body_length = 0; body_length < 256; ++body_length) {
+                fill_and_drop (body_length);
+        }
+
+        notify_uninit ();
+
+        outbox_dir = g_build_filename (tmp_dir, "libnotify", NULL);
+        path = g_build_filename (outbox_dir, "outbox", NULL);
+        g_remove (path);
+        g_rmdir (outbox_dir);
+        g_rmdir (tmp_dir);
+        g_free (path);
+        g_free (outbox_dir);
+        g_free (tmp_dir);
+
+        return 0;
+}
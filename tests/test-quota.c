@@ -0,0 +1,154 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <gio/gio.h>
+
+#define MAX_ACTIVE 2
+#define N_NOTIFICATIONS 5
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        gboolean *timed_out = user_data;
+
+        *timed_out = TRUE;
+        return G_SOURCE_REMOVE;
+}
+
+static void
+close_from_server (NotifyNotification *n)
+{
+        GDBusConnection *connection;
+        GVariant *result;
+        GError *error = NULL;
+        gint id;
+
+        g_object_get (n, "id", &id, NULL);
+        g_assert_cmpint (id, !=, 0);
+
+        connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+        g_assert_no_error (error);
+
+        result = g_dbus_connection_call_sync (connection,
+                                              "org.freedesktop.Notifications",
+                                              "/org/freedesktop/Notifications",
+                                              "org.freedesktop.Notifications",
+                                              "CloseNotification",
+                                              g_variant_new ("(u)", id),
+                                              NULL,
+                                              G_DBUS_CALL_FLAGS_NONE,
+                                              -1,
+                                              NULL,
+                                              &error);
+        g_assert_no_error (error);
+        g_variant_unref (result);
+        g_object_unref (connection);
+}
+
+static void
+on_evicted (NotifyNotification *n,
+            gpointer            user_data)
+{
+        GPtrArray *evicted = user_data;
+
+        g_ptr_array_add (evicted, g_object_ref (n));
+}
+
+int
+main ()
+{
+        NotifyNotification *shown[N_NOTIFICATIONS];
+        NotifyNotification *n;
+        GPtrArray *evicted;
+        GError *error = NULL;
+        gboolean timed_out = FALSE;
+        guint timeout_id;
+
+        notify_init ("Quota");
+
+        evicted = g_ptr_array_new_with_free_func (g_object_unref);
+        notify_set_active_quota (MAX_ACTIVE, FALSE, NOTIFY_EVICT_OLDEST);
+        notify_set_eviction_callback (on_evicted, evicted, NULL);
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                char *summary = g_strdup_printf ("Download %d finished", i);
+
+                shown[i] = notify_notification_new (summary, NULL, NULL);
+                notify_notification_set_timeout (shown[i], NOTIFY_EXPIRES_NEVER);
+                g_free (summary);
+
+                if (!notify_notification_show (shown[i], &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+
+        /* The first ones shown were closed */
+        g_assert_cmpuint (evicted->len, ==, N_NOTIFICATIONS - MAX_ACTIVE);
+        for (guint i = 0; i < evicted->len; ++i) {
+                g_assert_true (g_ptr_array_index (evicted, i) == shown[i]);
+        }
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                g_object_unref (shown[i]);
+        }
+
+        /* A notification nobody watches is released once the server
+         * closes it, and stops counting */
+        notify_set_active_quota (0, FALSE, NOTIFY_EVICT_OLDEST);
+        notify_set_active_quota (1, FALSE, NOTIFY_EVICT_OLDEST);
+        g_ptr_array_set_size (evicted, 0);
+
+        n = notify_notification_new ("Closed by the server", NULL, NULL);
+        notify_notification_set_timeout (n, NOTIFY_EXPIRES_NEVER);
+        g_assert_true (notify_notification_show (n, &error));
+        g_assert_no_error (error);
+
+        close_from_server (n);
+
+        g_object_add_weak_pointer (G_OBJECT (n), (gpointer *) &n);
+        g_object_unref (n);
+
+        timeout_id = g_timeout_add_seconds (5, on_timeout, &timed_out);
+        while (!timed_out && n != NULL) {
+                g_main_context_iteration (NULL, TRUE);
+        }
+        g_assert_false (timed_out);
+        g_source_remove (timeout_id);
+
+        n = notify_notification_new ("Shown afterwards", NULL, NULL);
+        notify_notification_set_timeout (n, NOTIFY_EXPIRES_NEVER);
+        g_assert_true (notify_notification_show (n, &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (evicted->len, ==, 0);
+        g_object_unref (n);
+
+        notify_set_eviction_callback (NULL, NULL, NULL);
+        g_ptr_array_unref (evicted);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+int
+main ()
+{
+        GError *error = NULL;
+
+        notify_init ("Send Simple");
+
+        if (!notify_send_simple ("Fire and forget",
+                                 "This notification has no object",
+                                 "dialog-information",
+                                 NOTIFY_URGENCY_LOW,
+                                 &error)) {
+                fprintf (stderr, "failed to send notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        if (!notify_send_simple ("Summary only", NULL, NULL,
+                                 NOTIFY_URGENCY_CRITICAL, &error)) {
+                fprintf (stderr, "failed to send notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        /* Flushes the messages that don't expect a reply */
+        notify_uninit ();
+
+        return 0;
+}
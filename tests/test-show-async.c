@@ -0,0 +1,97 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#define N_LOW 40
+
+static GMainLoop *loop;
+static guint n_pending = 0;
+static guint n_low_done = 0;
+static guint n_low_done_before_critical = 0;
+
+static void
+on_shown (GObject      *source,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+        NotifyNotification *n = NOTIFY_NOTIFICATION (source);
+        gboolean critical = GPOINTER_TO_INT (user_data);
+        GError *error = NULL;
+
+        if (!notify_notification_show_finish (n, result, &error)) {
+                fprintf (stderr, "failed to show notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                exit (1);
+        }
+
+        if (critical) {
+                n_low_done_before_critical = n_low_done;
+        } else {
+                n_low_done++;
+        }
+
+        if (--n_pending == 0) {
+                g_main_loop_quit (loop);
+        }
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+
+        notify_init ("Show Async");
+
+        for (int i = 0; i < N_LOW; ++i) {
+                char *body = g_strdup_printf ("Low urgency notification %d", i + 1);
+
+                n = notify_notification_new ("Low urgency", body, NULL);
+                notify_notification_set_urgency (n, NOTIFY_URGENCY_LOW);
+                notify_notification_set_timeout (n, 1000);
+                notify_notification_show_async (n, NULL, on_shown,
+                                                GINT_TO_POINTER (FALSE));
+                n_pending++;
+                g_object_unref (n);
+                g_free (body);
+        }
+
+        n = notify_notification_new ("Critical", "Sent ahead of the others", NULL);
+        notify_notification_set_urgency (n, NOTIFY_URGENCY_CRITICAL);
+        notify_notification_show_async (n, NULL, on_shown,
+                                        GINT_TO_POINTER (TRUE));
+        n_pending++;
+        g_object_unref (n);
+
+        loop = g_main_loop_new (NULL, FALSE);
+        g_main_loop_run (loop);
+        g_main_loop_unref (loop);
+
+        printf ("Critical notification shown after %u of %u low urgency ones\n",
+                n_low_done_before_critical, N_LOW);
+        g_assert_cmpuint (n_low_done_before_critical, <, N_LOW);
+
+        notify_uninit ();
+
+        return 0;
+}
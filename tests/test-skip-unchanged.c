@@ -0,0 +1,104 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+static void
+on_closed (NotifyNotification *n,
+           gpointer            user_data)
+{
+}
+
+static guint64
+get_counter (NotifyCounter counter)
+{
+        NotifyStatistics *stats = notify_get_statistics ();
+        guint64 value;
+
+        value = notify_statistics_get_counter (stats, counter);
+        notify_statistics_free (stats);
+
+        return value;
+}
+
+static void
+show_or_die (NotifyNotification *n)
+{
+        GError *error = NULL;
+
+        if (!notify_notification_show (n, &error)) {
+                fprintf (stderr, "failed to show notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                exit (1);
+        }
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        gboolean skip_unchanged;
+        gint id, new_id;
+
+        notify_init ("Skip Unchanged");
+        notify_reset_statistics ();
+
+        n = notify_notification_new ("Backup running", "12% done", NULL);
+        g_signal_connect (n, "closed", G_CALLBACK (on_closed), NULL);
+
+        /* Opt-in: by default every show is sent */
+        g_object_get (n, "skip-unchanged", &skip_unchanged, NULL);
+        g_assert_false (skip_unchanged);
+
+        show_or_die (n);
+        show_or_die (n);
+        g_assert_cmpuint (get_counter (NOTIFY_COUNTER_SHOWS), ==, 1);
+        g_assert_cmpuint (get_counter (NOTIFY_COUNTER_UPDATES), ==, 1);
+
+        g_object_set (n, "skip-unchanged", TRUE, NULL);
+        g_object_get (n, "id", &id, NULL);
+
+        /* Nothing changed, so nothing is sent */
+        show_or_die (n);
+        show_or_die (n);
+        g_object_get (n, "id", &new_id, NULL);
+        g_assert_cmpint (id, ==, new_id);
+        g_assert_cmpuint (get_counter (NOTIFY_COUNTER_UPDATES), ==, 1);
+
+        notify_notification_update (n, "Backup running", "57% done", NULL);
+        show_or_die (n);
+        g_assert_cmpuint (get_counter (NOTIFY_COUNTER_UPDATES), ==, 2);
+
+        g_object_set (n, "skip-unchanged", FALSE, NULL);
+        show_or_die (n);
+        g_assert_cmpuint (get_counter (NOTIFY_COUNTER_UPDATES), ==, 3);
+
+        g_assert_cmpuint (get_counter (NOTIFY_COUNTER_SHOWS), ==, 1);
+
+        notify_notification_close (n, NULL);
+        g_object_unref (n);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,81 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+/*
+ * Run this while the notification server is not running, then start it:
+ * only the last update of the notification and the summary-only one are
+ * expected to be shown.
+ */
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+        g_main_loop_quit (user_data);
+        return G_SOURCE_REMOVE;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        GMainLoop *loop;
+        GError *error = NULL;
+
+        notify_init ("Spool");
+        notify_set_offline_spool_size (4);
+
+        g_assert (notify_get_offline_spool_size () == 4);
+
+        n = notify_notification_new ("Spooled", "First version", NULL);
+
+        for (int i = 0; i < 3; ++i) {
+                char *body = g_strdup_printf ("Version %d", i + 1);
+
+                notify_notification_update (n, "Spooled", body, NULL);
+                g_free (body);
+
+                if (!notify_notification_show (n, &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+
+        if (!notify_send_simple ("Summary only", NULL, NULL,
+                                 NOTIFY_URGENCY_NORMAL, &error)) {
+                fprintf (stderr, "failed to send notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        loop = g_main_loop_new (NULL, FALSE);
+        g_timeout_add_seconds (30, on_timeout, loop);
+        g_main_loop_run (loop);
+        g_main_loop_unref (loop);
+
+        g_object_unref (n);
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,107 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+
+static guint64
+count_calls (NotifyStatistics *stats,
+             NotifyOperation   operation)
+{
+        const guint64 *buckets;
+        guint n_buckets;
+        guint64 total = 0;
+
+        buckets = notify_statistics_get_latencies (stats, operation, &n_buckets);
+        for (guint i = 0; i < n_buckets; ++i) {
+                total += buckets[i];
+        }
+
+        return total;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        NotifyStatistics *stats;
+        g_autoptr(NotifyStatistics) copy = NULL;
+        GError *error = NULL;
+
+        notify_init ("Statistics");
+        notify_reset_statistics ();
+
+        g_assert_cmpint (notify_statistics_get_bucket_limit (0), ==, 16);
+        g_assert_cmpint (notify_statistics_get_bucket_limit (1), ==, 32);
+        g_assert_cmpint (notify_statistics_get_bucket_limit (G_MAXUINT), ==, G_MAXINT64);
+
+        g_assert_true (notify_get_server_info (NULL, NULL, NULL, NULL));
+
+        n = notify_notification_new ("Statistics", "Counting", NULL);
+        notify_notification_set_hint_string (n, "x-test", "value");
+
+        if (!notify_notification_show (n, &error)) {
+                fprintf (stderr, "failed to show notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        notify_notification_update (n, "Statistics", "Counted", NULL);
+        g_assert_true (notify_notification_show (n, NULL));
+        g_assert_true (notify_notification_close (n, NULL));
+
+        stats = notify_get_statistics ();
+
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_SHOWS), ==, 1);
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_UPDATES), ==, 1);
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_CLOSES), ==, 1);
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_FAILURES), ==, 0);
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_HINT_BYTES), >, 0);
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_IMAGE_BYTES), ==, 0);
+        g_assert_cmpuint (notify_statistics_get_failures (stats, G_DBUS_ERROR,
+                                                          G_DBUS_ERROR_SERVICE_UNKNOWN), ==, 0);
+
+        g_assert_cmpuint (count_calls (stats, NOTIFY_OPERATION_NOTIFY), ==, 2);
+        g_assert_cmpuint (count_calls (stats, NOTIFY_OPERATION_CLOSE_NOTIFICATION), ==, 1);
+        g_assert_cmpuint (count_calls (stats, NOTIFY_OPERATION_GET_SERVER_INFORMATION), >=, 1);
+        g_assert_cmpuint (count_calls (stats, NOTIFY_OPERATION_PORTAL_ADD_NOTIFICATION), ==, 0);
+
+        /* A snapshot doesn't change */
+        copy = notify_statistics_copy (stats);
+        g_assert_true (notify_notification_show (n, NULL));
+        g_assert_cmpuint (count_calls (copy, NOTIFY_OPERATION_NOTIFY), ==, 2);
+        notify_statistics_free (stats);
+
+        notify_reset_statistics ();
+        stats = notify_get_statistics ();
+        g_assert_cmpuint (notify_statistics_get_counter (stats, NOTIFY_COUNTER_SHOWS), ==, 0);
+        g_assert_cmpuint (count_calls (stats, NOTIFY_OPERATION_NOTIFY), ==, 0);
+        notify_statistics_free (stats);
+
+        g_object_unref (n);
+
+        /* Dumped to stderr */
+        g_setenv ("NOTIFY_STATS", "1", TRUE);
+        notify_uninit ();
+
+        return 0;
+}
@@ -0,0 +1,217 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <gio/gio.h>
+
+static void
+on_reply (NotifyNotification *n,
+          const char         *action,
+          gpointer            user_data)
+{
+}
+
+/* Gets the arguments of the calls to Notify recorded by the mock server */
+static GVariant *
+get_notify_calls (void)
+{
+        GDBusConnection *connection;
+        GVariant *result;
+        GVariant *calls;
+        GError *error = NULL;
+
+        connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+        g_assert_no_error (error);
+
+        result = g_dbus_connection_call_sync (connection,
+                                              "org.freedesktop.Notifications",
+                                              "/org/freedesktop/Notifications",
+                                              "org.freedesktop.DBus.Mock",
+                                              "GetMethodCalls",
+                                              g_variant_new ("(s)", "Notify"),
+                                              G_VARIANT_TYPE ("(a(tav))"),
+                                              G_DBUS_CALL_FLAGS_NONE,
+                                              -1,
+                                              NULL,
+                                              &error);
+        g_assert_no_error (error);
+
+        calls = g_variant_get_child_value (result, 0);
+        g_variant_unref (result);
+        g_object_unref (connection);
+
+        return calls;
+}
+
+static GVariant *
+get_call_argument (GVariant *calls,
+                   gsize     index,
+                   gsize     argument)
+{
+        GVariant *call;
+        GVariant *args;
+        GVariant *boxed;
+        GVariant *value;
+
+        call = g_variant_get_child_value (calls, index);
+        args = g_variant_get_child_value (call, 1);
+        g_assert_cmpuint (g_variant_n_children (args), ==, 8);
+
+        boxed = g_variant_get_child_value (args, argument);
+        value = g_variant_get_variant (boxed);
+
+        g_variant_unref (boxed);
+        g_variant_unref (args);
+        g_variant_unref (call);
+
+        return value;
+}
+
+static void
+assert_call (GVariant   *calls,
+             gsize       index,
+             gboolean    has_reply,
+             guchar      urgency,
+             gboolean    transient,
+             gint        timeout)
+{
+        GVariant *actions;
+        GVariant *hints;
+        GVariant *value;
+        GVariant *timeout_value;
+        const char *category;
+
+        actions = get_call_argument (calls, index, 5);
+        if (has_reply) {
+                const char **strv = g_variant_get_strv (actions, NULL);
+
+                g_assert_cmpuint (g_variant_n_children (actions), ==, 2);
+                g_assert_cmpstr (strv[0], ==, "reply");
+                g_assert_cmpstr (strv[1], ==, "Reply");
+                g_free (strv);
+        } else {
+                g_assert_cmpuint (g_variant_n_children (actions), ==, 0);
+        }
+        g_variant_unref (actions);
+
+        hints = get_call_argument (calls, index, 6);
+
+        g_assert_true (g_variant_lookup (hints, "category", "&s", &category));
+        g_assert_cmpstr (category, ==, "im.received");
+
+        value = g_variant_lookup_value (hints, "urgency", G_VARIANT_TYPE_BYTE);
+        g_assert_cmpuint (value != NULL ? g_variant_get_byte (value)
+                                        : NOTIFY_URGENCY_NORMAL, ==, urgency);
+        g_clear_pointer (&value, g_variant_unref);
+
+        value = g_variant_lookup_value (hints, "transient", G_VARIANT_TYPE_BOOLEAN);
+        g_assert_cmpint (value != NULL && g_variant_get_boolean (value), ==, transient);
+        g_clear_pointer (&value, g_variant_unref);
+
+        g_variant_unref (hints);
+
+        timeout_value = get_call_argument (calls, index, 7);
+        g_assert_cmpint (g_variant_get_int32 (timeout_value), ==, timeout);
+        g_variant_unref (timeout_value);
+}
+
+int
+main ()
+{
+        NotifyTemplate *tmpl;
+        NotifyNotification *notifications[4];
+        GVariant *calls;
+        GError *error = NULL;
+        char *summary, *body, *icon_name;
+
+        notify_init ("Template");
+
+        tmpl = notify_template_new ();
+        notify_template_set_icon_name (tmpl, "mail-unread");
+        notify_template_set_hint (tmpl, NOTIFY_NOTIFICATION_HINT_CATEGORY,
+                                  g_variant_new_string ("im.received"));
+        notify_template_add_action (tmpl, "reply", "Reply", on_reply, NULL, NULL);
+
+        for (int i = 0; i < G_N_ELEMENTS (notifications) - 1; ++i) {
+                char *text = g_strdup_printf ("Message number %d", i);
+
+                notifications[i] = notify_notification_new_from_template (tmpl,
+                                                                          "New message",
+                                                                          text);
+                g_free (text);
+        }
+
+        g_object_get (notifications[1],
+                      "summary", &summary,
+                      "body", &body,
+                      "icon-name", &icon_name,
+                      NULL);
+        g_assert_cmpstr (summary, ==, "New message");
+        g_assert_cmpstr (body, ==, "Message number 1");
+        g_assert_cmpstr (icon_name, ==, "mail-unread");
+        g_free (summary);
+        g_free (body);
+        g_free (icon_name);
+
+        /* Changes only apply to the notification or the template changed */
+        notify_notification_set_urgency (notifications[0], NOTIFY_URGENCY_CRITICAL);
+        notify_notification_clear_actions (notifications[2]);
+        notify_template_set_timeout (tmpl, NOTIFY_EXPIRES_NEVER);
+        notify_template_set_hint (tmpl, NOTIFY_NOTIFICATION_HINT_TRANSIENT,
+                                  g_variant_new_boolean (TRUE));
+
+        notifications[3] = notify_notification_new_from_template (tmpl,
+                                                                  "New message",
+                                                                  "Message number 3");
+
+        for (int i = 0; i < G_N_ELEMENTS (notifications); ++i) {
+                if (!notify_notification_show (notifications[i], &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+
+                g_object_unref (notifications[i]);
+        }
+
+        calls = get_notify_calls ();
+        g_assert_cmpuint (g_variant_n_children (calls), ==, G_N_ELEMENTS (notifications));
+
+        /* The changed notifications have the new values... */
+        assert_call (calls, 0, TRUE, NOTIFY_URGENCY_CRITICAL, FALSE, NOTIFY_EXPIRES_DEFAULT);
+        assert_call (calls, 2, FALSE, NOTIFY_URGENCY_NORMAL, FALSE, NOTIFY_EXPIRES_DEFAULT);
+
+        /* ...while their siblings keep the values of the template when
+         * they were created */
+        assert_call (calls, 1, TRUE, NOTIFY_URGENCY_NORMAL, FALSE, NOTIFY_EXPIRES_DEFAULT);
+
+        /* The template got none of the changes of its notifications */
+        assert_call (calls, 3, TRUE, NOTIFY_URGENCY_NORMAL, TRUE, NOTIFY_EXPIRES_NEVER);
+
+        g_variant_unref (calls);
+        g_object_unref (tmpl);
+
+        notify_uninit ();
+
+        return 0;
+}
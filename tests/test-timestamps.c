@@ -0,0 +1,109 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+static void
+on_closed (NotifyNotification *n,
+           gpointer            user_data)
+{
+        gboolean *closed = user_data;
+
+        *closed = TRUE;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        NotifyNotification *unrouted;
+        NotifyStatistics *stats;
+        GError *error = NULL;
+        gint64 requested, acknowledged;
+        gboolean closed = FALSE;
+
+        notify_init ("Timestamps");
+        notify_reset_statistics ();
+
+        n = notify_notification_new ("Timestamps", "Measuring", NULL);
+        g_signal_connect (n, "closed", G_CALLBACK (on_closed), &closed);
+
+        g_assert_cmpint (notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_SHOW_REQUESTED), ==, 0);
+        g_assert_cmpint (notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_ACKNOWLEDGED), ==, 0);
+
+        if (!notify_notification_show (n, &error)) {
+                fprintf (stderr, "failed to show notification: %s\n",
+                         error->message);
+                g_error_free (error);
+                return 1;
+        }
+
+        requested = notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_SHOW_REQUESTED);
+        acknowledged = notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_ACKNOWLEDGED);
+        g_assert_cmpint (requested, >, 0);
+        g_assert_cmpint (acknowledged, >=, requested);
+        g_assert_cmpint (notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_ACTION_INVOKED), ==, 0);
+        g_assert_cmpint (notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_CLOSED), ==, 0);
+
+        /* Showing it again starts a new lifecycle */
+        notify_notification_update (n, "Timestamps", "Measured", NULL);
+        g_assert_true (notify_notification_show (n, NULL));
+        g_assert_cmpint (notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_SHOW_REQUESTED), >=, acknowledged);
+
+        /* Nothing watches the closing of this one, so it's not known */
+        unrouted = notify_notification_new ("Timestamps", "Unobserved", NULL);
+        g_assert_true (notify_notification_show (unrouted, NULL));
+        g_assert_true (notify_notification_close (unrouted, NULL));
+
+        g_assert_true (notify_notification_close (n, NULL));
+
+        /* The closing is only known from the signal of the server */
+        while (!closed) {
+                g_main_context_iteration (NULL, TRUE);
+        }
+
+        g_assert_cmpint (notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_CLOSED), >=,
+                         notify_notification_get_timestamp (n, NOTIFY_TIMESTAMP_ACKNOWLEDGED));
+
+        /* Its closing signal came first, and was not routed to it */
+        g_assert_cmpint (notify_notification_get_timestamp (unrouted, NOTIFY_TIMESTAMP_ACKNOWLEDGED), >, 0);
+        g_assert_cmpint (notify_notification_get_timestamp (unrouted, NOTIFY_TIMESTAMP_CLOSED), ==, 0);
+
+        stats = notify_get_statistics ();
+
+        g_assert_cmpuint (notify_statistics_get_interval_count (stats, NOTIFY_INTERVAL_ACKNOWLEDGE), ==, 3);
+        g_assert_cmpuint (notify_statistics_get_interval_count (stats, NOTIFY_INTERVAL_ACTION), ==, 0);
+        g_assert_cmpuint (notify_statistics_get_interval_count (stats, NOTIFY_INTERVAL_CLOSE), ==, 1);
+
+        g_assert_cmpint (notify_statistics_get_percentile (stats, NOTIFY_INTERVAL_ACKNOWLEDGE, 100), >,
+                         acknowledged - requested);
+        g_assert_cmpint (notify_statistics_get_percentile (stats, NOTIFY_INTERVAL_ACKNOWLEDGE, 50), <=,
+                         notify_statistics_get_percentile (stats, NOTIFY_INTERVAL_ACKNOWLEDGE, 100));
+        g_assert_cmpint (notify_statistics_get_percentile (stats, NOTIFY_INTERVAL_ACTION, 50), ==, 0);
+
+        notify_statistics_free (stats);
+        g_object_unref (unrouted);
+        g_object_unref (n);
+
+        notify_uninit ();
+
+        return 0;
+}
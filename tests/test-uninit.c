@@ -0,0 +1,66 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <stdio.h>
+#include <glib.h>
+
+#define N_NOTIFICATIONS 50
+#define UNINIT_TIMEOUT 500
+
+int
+main ()
+{
+        NotifyNotification *shown[N_NOTIFICATIONS];
+        GError *error = NULL;
+        gint64 start;
+
+        notify_init ("Uninit");
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                char *summary = g_strdup_printf ("Resident notification %d", i);
+
+                shown[i] = notify_notification_new (summary, NULL, NULL);
+                notify_notification_set_timeout (shown[i], NOTIFY_EXPIRES_NEVER);
+                g_free (summary);
+
+                if (!notify_notification_show (shown[i], &error)) {
+                        fprintf (stderr, "failed to show notification: %s\n",
+                                 error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+
+        /* All the notifications are closed at once, within the timeout */
+        notify_set_uninit_timeout (UNINIT_TIMEOUT);
+
+        start = g_get_monotonic_time ();
+        notify_uninit ();
+        g_assert_cmpint (g_get_monotonic_time () - start, <,
+                         2 * UNINIT_TIMEOUT * G_TIME_SPAN_MILLISECOND);
+
+        g_assert_false (notify_is_initted ());
+
+        for (int i = 0; i < N_NOTIFICATIONS; ++i) {
+                g_object_unref (shown[i]);
+        }
+
+        return 0;
+}
@@ -0,0 +1,85 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA  02111-1307, USA.
+ */
+
+
+#include <libnotify/notify.h>
+#include <glib.h>
+
+static void
+on_notify (GObject    *object,
+           GParamSpec *pspec,
+           gpointer    user_data)
+{
+        guint *n_notifies = user_data;
+
+        (*n_notifies)++;
+}
+
+int
+main ()
+{
+        NotifyNotification *n;
+        GVariantDict hints;
+        guint n_notifies = 0;
+        char *summary, *body, *icon_name;
+
+        notify_init ("Update Full");
+
+        n = notify_notification_new ("Downloading", "0%", NULL);
+        g_signal_connect (n, "notify", G_CALLBACK (on_notify), &n_notifies);
+
+        g_variant_dict_init (&hints, NULL);
+        g_variant_dict_insert (&hints, NOTIFY_NOTIFICATION_HINT_CATEGORY,
+                               "s", "transfer");
+        g_variant_dict_insert (&hints, NOTIFY_NOTIFICATION_HINT_TRANSIENT,
+                               "b", TRUE);
+
+        g_assert_true (notify_notification_update_full (n,
+                                                        "Downloaded",
+                                                        "100%",
+                                                        "emblem-default",
+                                                        NOTIFY_EXPIRES_DEFAULT,
+                                                        NOTIFY_URGENCY_LOW,
+                                                        g_variant_dict_end (&hints)));
+
+        /* One notification per changed property */
+        g_assert_cmpuint (n_notifies, ==, 3);
+
+        g_object_get (n,
+                      "summary", &summary,
+                      "body", &body,
+                      "icon-name", &icon_name,
+                      NULL);
+        g_assert_cmpstr (summary, ==, "Downloaded");
+        g_assert_cmpstr (body, ==, "100%");
+        g_assert_cmpstr (icon_name, ==, "emblem-default");
+
+        g_free (summary);
+        g_free (body);
+        g_free (icon_name);
+
+        n_notifies = 0;
+        notify_notification_set_hints (n, g_variant_new_parsed ("{'resident': <true>}"));
+        g_assert_cmpuint (n_notifies, ==, 0);
+
+        g_object_unref (n);
+
+        notify_uninit ();
+
+        return 0;
+}
@@ -233,6 +233,59 @@ server_has_capability (const gchar *capability)
         return supported;
 }
 
+static void
+on_broadcast_done (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+        GError **error = user_data;
+
+        notify_broadcast_submit_finish (NOTIFY_BROADCAST (source), result, error);
+        g_main_loop_quit (loop);
+}
+
+static gboolean
+show_in_all_sessions (NotifyNotification *notify,
+                      gboolean            print_id,
+                      GError            **error)
+{
+        NotifyBroadcast *broadcast;
+        GError *local_error = NULL;
+
+        broadcast = notify_broadcast_new (notify);
+
+        loop = g_main_loop_new (NULL, FALSE);
+        notify_broadcast_submit (broadcast, NULL, on_broadcast_done, &local_error);
+        g_main_loop_run (loop);
+        g_main_loop_unref (loop);
+        loop = NULL;
+
+        for (guint i = 0; i < notify_broadcast_get_n_sessions (broadcast); i++) {
+                const GError *session_error = notify_broadcast_get_error (broadcast, i);
+                guint uid = notify_broadcast_get_uid (broadcast, i);
+
+                if (session_error != NULL) {
+                        g_printerr ("%u: %s\n", uid, session_error->message);
+                } else if (print_id) {
+                        gint id;
+
+                        g_object_get (notify_broadcast_get_notification (broadcast, i),
+                                      "id", &id, NULL);
+                        g_printf ("%u: %d\n", uid, id);
+                }
+        }
+
+        fflush (stdout);
+        g_object_unref (broadcast);
+
+        if (local_error != NULL) {
+                g_propagate_error (error, local_error);
+                return FALSE;
+        }
+
+        return TRUE;
+}
+
 /* The XDG Desktop Notifications Specification requires valid UTF-8 for certain
  * strings. Given the stability/security implications by accepting console
  * input, we will insist upon valid UTF-8 being provided for these strings, and
@@ -277,6 +330,9 @@ main (int argc, char *argv[])
         static gboolean     hint_error = FALSE, show_error = FALSE;
         static gboolean     transient = FALSE;
         static gboolean     wait = FALSE;
+        static gboolean     outbox = FALSE;
+        static gboolean     flush_outbox = FALSE;
+        static gboolean     all_sessions = FALSE;
         static int          expire_timeout = NOTIFY_EXPIRES_DEFAULT;
         GOptionContext     *opt_ctx;
         NotifyNotification *notify;
@@ -329,6 +385,18 @@ main (int argc, char *argv[])
                  N_ ("File descriptor where to write the action chosen by the user."), NULL},
                 {"activation-token-fd", 0, 0, G_OPTION_ARG_INT, &activation_token_fd    ,
                  N_ ("File descriptor where to write the action activation token. The daemon must support it."), NULL},
+                {"outbox", 0, 0, G_OPTION_ARG_NONE, &outbox,
+                 N_("Append the notification to the outbox instead of sending it. "
+                    "It will be sent by the next program showing a notification."),
+                 NULL},
+                {"flush-outbox", 0, 0, G_OPTION_ARG_NONE, &flush_outbox,
+                 N_("Send the notifications waiting in the outbox and exit."),
+                 NULL},
+                {"all-sessions", 0, 0, G_OPTION_ARG_NONE, &all_sessions,
+                 N_("Show the notification in every user session the caller may "
+                    "connect to. With --print-id, the ID is printed for each "
+                    "user ID."),
+                 NULL},
                 {"version", 'v', 0, G_OPTION_ARG_NONE, &do_version,
                  N_("Version of the package."),
                  NULL},
@@ -362,6 +430,41 @@ main (int argc, char *argv[])
                 exit (0);
         }
 
+        if (flush_outbox) {
+                guint n_sent;
+
+                if (!notify_init ("notify-send"))
+                        exit (1);
+
+                n_sent = notify_outbox_flush (&error);
+                notify_uninit ();
+
+                if (error != NULL) {
+                        fprintf (stderr, "%s\n", error->message);
+                        g_error_free (error);
+                        exit (1);
+                }
+
+                g_debug ("Sent %u notifications from the outbox", n_sent);
+                exit (0);
+        }
+
+        if (outbox && (wait || actions || print_id || id_fd >= 0)) {
+                fprintf (stderr, "%s\n",
+                         N_("--outbox can't be used with options that need "
+                            "the notification server."));
+                exit (1);
+        }
+
+        if (all_sessions && (outbox || wait || actions || id_fd >= 0 ||
+                             notification_id != 0)) {
+                fprintf (stderr, "%s\n",
+                         N_("--all-sessions can't be used with --outbox, or "
+                            "with options that wait for or replace a "
+                            "notification."));
+                exit (1);
+        }
+
         if (n_text != NULL && n_text[0] != NULL)
         {
                 summary = n_text[0];
@@ -394,17 +497,19 @@ main (int argc, char *argv[])
         if (!notify_init ("notify-send"))
                 exit (1);
 
-        notify_get_server_info (&server_name,
-                                &server_vendor,
-                                &server_version,
-                                &server_spec_version);
-
-        g_debug ("Using server %s %s, v%s - Supporting Notification Spec %s",
-                 server_name, server_vendor, server_version, server_spec_version);
-        g_free (server_name);
-        g_free (server_vendor);
-        g_free (server_version);
-        g_free (server_spec_version);
+        if (!outbox && !all_sessions) {
+                notify_get_server_info (&server_name,
+                                        &server_vendor,
+                                        &server_version,
+                                        &server_spec_version);
+
+                g_debug ("Using server %s %s, v%s - Supporting Notification Spec %s",
+                         server_name, server_vendor, server_version, server_spec_version);
+                g_free (server_name);
+                g_free (server_vendor);
+                g_free (server_version);
+                g_free (server_spec_version);
+        }
 
         notify = g_object_new (NOTIFY_TYPE_NOTIFICATION,
                                "summary", summary,
@@ -424,7 +529,8 @@ main (int argc, char *argv[])
                                               NOTIFY_NOTIFICATION_HINT_TRANSIENT,
                                               g_variant_new_boolean (TRUE));
 
-                if (!server_has_capability ("persistence")) {
+                if (!outbox && !all_sessions &&
+                    !server_has_capability ("persistence")) {
                         g_debug ("Persistence is not supported by the "
                                  "notifications server. "
                                  "All notifications are transient.");
@@ -531,7 +637,13 @@ main (int argc, char *argv[])
         }
 
         if (!hint_error) {
-                retval = notify_notification_show (notify, &error);
+                if (outbox) {
+                        retval = notify_outbox_append (notify, &error);
+                } else if (all_sessions) {
+                        retval = show_in_all_sessions (notify, print_id, &error);
+                } else {
+                        retval = notify_notification_show (notify, &error);
+                }
 
                 if (!retval) {
                         fprintf (stderr, "%s\n", error->message);
@@ -540,7 +652,7 @@ main (int argc, char *argv[])
                 }
         }
 
-        if (print_id) {
+        if (print_id && !all_sessions) {
                 g_object_get (notify, "id", &notification_id, NULL);
                 g_printf ("%d\n", notification_id);
                 fflush (stdout);